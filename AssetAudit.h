@@ -0,0 +1,503 @@
+#ifndef ASSET_AUDIT_H
+#define ASSET_AUDIT_H
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <nlohmann/json.hpp>
+#include <stb/stb_image.h>
+
+#include "Mesh.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Cost of the content in an asset directory, checked against budgets: what every model and image
+// would take once loaded the way Model and TextureFromFile load them, and what it carries that the
+// renderer never reads. Nothing is uploaded, so the audit runs without a GL context.
+namespace AssetAudit {
+
+    // a limit of 0 is off
+    struct Budgets {
+        size_t maxTriangles = 100000;
+        int maxTextureSize = 4096;  // largest side in pixels
+        double maxGpuMB = 64.0;  // geometry and textures of one asset
+        double maxAcmr = 0.0;  // cache misses per triangle
+        double maxDuplication = 0.0;  // vertices per distinct position
+        bool allowNonPowerOfTwo = true;
+        bool allowUnusedChannels = true;
+    };
+
+    struct TextureInfo {
+        std::string path;
+        std::string format;  // from the file signature
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        bool found = false;
+
+        // the estimate UploadTexture reports, mip chain included
+        size_t gpuBytes() const { return static_cast<size_t>(width) * height * components * 4 / 3; }
+    };
+
+    struct Report {
+        std::string path;
+        std::string kind;  // "model" or "texture"
+        std::string error;  // the file couldn't be read
+        size_t meshes = 0;
+        size_t vertices = 0;
+        size_t triangles = 0;
+        size_t uniquePositions = 0;
+        double duplication = 0.0;  // vertices / distinct positions, 1 means no seams at all
+        double acmr = 0.0;  // simulated post-transform cache misses per triangle, 0.5 is about the best
+        double atvr = 0.0;  // misses per vertex, 1 is the best
+        std::vector<std::string> unusedChannels;
+        std::vector<TextureInfo> textures;  // of a model, its material textures
+        size_t geometryBytes = 0;
+        size_t textureBytes = 0;
+        std::vector<std::string> warnings;
+        std::vector<std::string> failures;  // budgets it is over
+        double auditMs = 0.0;
+
+        size_t gpuBytes() const { return geometryBytes + textureBytes; }
+        bool failed() const { return !error.empty() || !failures.empty(); }
+    };
+
+    // the cache of the vertex stage, modelled the way mesh optimizers usually analyze it
+    const int VertexCacheSize = 16;
+
+    inline bool IsPowerOfTwo(int value) { return value > 0 && (value & (value - 1)) == 0; }
+
+    inline std::string Extension(const std::string& path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos)
+            return "";
+        std::string extension = path.substr(dot + 1);
+        for (char& c : extension)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return extension;
+    }
+
+    inline bool IsImage(const std::string& path)
+    {
+        static const char* const extensions[] = { "jpg", "jpeg", "png", "bmp", "tga", "gif", "hdr", "psd" };
+        std::string extension = Extension(path);
+        return std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions);
+    }
+
+    // the format the bytes are in, whatever the file is called
+    inline std::string ImageFormat(const std::string& path)
+    {
+        unsigned char head[8] = {};
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char*>(head), sizeof(head));
+        if (head[0] == 0xFF && head[1] == 0xD8)
+            return "jpeg";
+        if (head[0] == 0x89 && head[1] == 'P' && head[2] == 'N' && head[3] == 'G')
+            return "png";
+        if (head[0] == 'B' && head[1] == 'M')
+            return "bmp";
+        if (head[0] == 'G' && head[1] == 'I' && head[2] == 'F')
+            return "gif";
+        if (head[0] == 'D' && head[1] == 'D' && head[2] == 'S')
+            return "dds";
+        if (head[0] == 0xAB && head[1] == 'K' && head[2] == 'T' && head[3] == 'X')
+            return "ktx";
+        return Extension(path);
+    }
+
+    // dimensions from the header, the pixels aren't decoded
+    inline TextureInfo InspectTexture(const std::string& path)
+    {
+        TextureInfo info;
+        info.path = path;
+        info.found = stbi_info(path.c_str(), &info.width, &info.height, &info.components) != 0;
+        if (info.found)
+            info.format = ImageFormat(path);
+        return info;
+    }
+
+    // misses of a FIFO cache of cacheSize vertices over the index buffer
+    inline size_t CacheMisses(const unsigned int* indices, size_t count, size_t vertexCount, int cacheSize = VertexCacheSize)
+    {
+        // a vertex is in the cache while fewer than cacheSize misses happened since its own
+        std::vector<size_t> loadedAt(vertexCount, 0);
+        size_t misses = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t& loaded = loadedAt[indices[i]];
+            if (loaded == 0 || misses - loaded >= static_cast<size_t>(cacheSize))
+                loaded = ++misses;
+        }
+        return misses;
+    }
+
+    inline size_t UniquePositions(const aiMesh* mesh)
+    {
+        std::vector<std::array<float, 3>> positions(mesh->mNumVertices);
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+            positions[i] = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+        std::sort(positions.begin(), positions.end());
+        return std::unique(positions.begin(), positions.end()) - positions.begin();
+    }
+
+    // the texture types Model::processMesh resolves, only the diffuse one is sampled by the shaders
+    struct MaterialSlot {
+        aiTextureType type;
+        bool sampled;
+    };
+    const MaterialSlot MaterialSlots[] = {
+        { aiTextureType_DIFFUSE, true },
+        { aiTextureType_SPECULAR, false },
+        { aiTextureType_HEIGHT, false },
+        { aiTextureType_AMBIENT, false },
+    };
+
+    inline void AuditMesh(const aiMesh* mesh, const aiScene* scene, const std::string& directory, Report& report, std::vector<std::string>& unsampled)
+    {
+        report.meshes++;
+        report.vertices += mesh->mNumVertices;
+        report.uniquePositions += UniquePositions(mesh);
+
+        std::vector<unsigned int> indices;
+        indices.reserve(mesh->mNumFaces * 3);
+        for (unsigned int f = 0; f < mesh->mNumFaces; f++)
+        {
+            const aiFace& face = mesh->mFaces[f];
+            // Model keeps points and lines in the index buffer too, they just aren't triangles
+            indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+            report.triangles += face.mNumIndices == 3;
+        }
+        report.acmr += static_cast<double>(CacheMisses(indices.data(), indices.size(), mesh->mNumVertices));
+        report.geometryBytes += mesh->mNumVertices * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+
+        // what the file brings along that default.vert doesn't read, Vertex has no room for most of it
+        auto unused = [&](const std::string& channel) {
+            if (std::find(report.unusedChannels.begin(), report.unusedChannels.end(), channel) == report.unusedChannels.end())
+                report.unusedChannels.push_back(channel);
+        };
+        for (unsigned int set = 1; set < AI_MAX_NUMBER_OF_TEXTURECOORDS; set++)
+            if (mesh->HasTextureCoords(set))
+                unused("uv" + std::to_string(set));
+        if (mesh->HasVertexColors(0))
+            unused("colors");
+        if (mesh->HasTangentsAndBitangents())
+            unused("tangents");
+        if (mesh->HasBones())
+            unused("bones");
+
+        const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        for (const MaterialSlot& slot : MaterialSlots)
+        {
+            for (unsigned int t = 0; t < material->GetTextureCount(slot.type); t++)
+            {
+                aiString file;
+                material->GetTexture(slot.type, t, &file);
+                std::string path = file.C_Str()[0] == '*' ? std::string(file.C_Str()) : ImagePath(file.C_Str(), directory);
+                if (!slot.sampled && std::find(unsampled.begin(), unsampled.end(), path) == unsampled.end())
+                    unsampled.push_back(path);
+                bool seen = false;
+                for (const TextureInfo& texture : report.textures)
+                    seen = seen || texture.path == path;
+                if (seen)
+                    continue;
+                TextureInfo info;
+                if (file.C_Str()[0] == '*')
+                {
+                    // embedded, in the file itself
+                    info.path = path;
+                    info.format = "embedded";
+                }
+                else
+                    info = InspectTexture(path);
+                report.textures.push_back(info);
+            }
+        }
+        if (!mesh->HasTextureCoords(0) && material->GetTextureCount(aiTextureType_DIFFUSE) > 0)
+            report.warnings.push_back("textured mesh without texture coordinates");
+    }
+
+    // the meshes as Model::collectMeshes finds them, a mesh referenced by two nodes is loaded twice
+    inline void AuditNode(const aiNode* node, const aiScene* scene, const std::string& directory, Report& report, std::vector<std::string>& unsampled)
+    {
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            AuditMesh(scene->mMeshes[node->mMeshes[i]], scene, directory, report, unsampled);
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            AuditNode(node->mChildren[i], scene, directory, report, unsampled);
+    }
+
+    inline void AuditModel(Report& report)
+    {
+        // only triangulated: the other import steps don't change the counts and generating
+        // tangents would hide whether the file carries its own
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(report.path, aiProcess_Triangulate);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            report.error = importer.GetErrorString();
+            return;
+        }
+        std::string directory = report.path.substr(0, report.path.find_last_of("/\\"));
+        std::vector<std::string> unsampled;
+        AuditNode(scene->mRootNode, scene, directory, report, unsampled);
+
+        if (report.triangles > 0)
+            report.acmr /= report.triangles;
+        report.atvr = report.vertices > 0 ? report.acmr * report.triangles / report.vertices : 0.0;
+        report.duplication = report.uniquePositions > 0 ? static_cast<double>(report.vertices) / report.uniquePositions : 0.0;
+        for (const TextureInfo& texture : report.textures)
+        {
+            report.textureBytes += texture.gpuBytes();
+            if (!texture.found && texture.format != "embedded")
+                report.warnings.push_back("missing texture " + texture.path);
+        }
+        for (const std::string& path : unsampled)
+            report.warnings.push_back("texture never sampled by the shaders: " + path);
+    }
+
+    inline void AuditTexture(Report& report)
+    {
+        TextureInfo info = InspectTexture(report.path);
+        if (!info.found)
+        {
+            report.error = stbi_failure_reason() ? stbi_failure_reason() : "unreadable image";
+            return;
+        }
+        report.textures.push_back(info);
+        report.textureBytes = info.gpuBytes();
+    }
+
+    // fills failures (over a budget) and the warnings that don't depend on the file's own contents
+    inline void Check(Report& report, const Budgets& budgets)
+    {
+        if (!report.error.empty())
+            return;
+        char text[160];
+        if (budgets.maxTriangles > 0 && report.triangles > budgets.maxTriangles)
+        {
+            snprintf(text, sizeof(text), "%zu triangles, budget %zu", report.triangles, budgets.maxTriangles);
+            report.failures.push_back(text);
+        }
+        if (budgets.maxAcmr > 0.0 && report.acmr > budgets.maxAcmr)
+        {
+            snprintf(text, sizeof(text), "ACMR %.2f, budget %.2f", report.acmr, budgets.maxAcmr);
+            report.failures.push_back(text);
+        }
+        if (budgets.maxDuplication > 0.0 && report.duplication > budgets.maxDuplication)
+        {
+            snprintf(text, sizeof(text), "%.2f vertices per position, budget %.2f", report.duplication, budgets.maxDuplication);
+            report.failures.push_back(text);
+        }
+        if (budgets.maxGpuMB > 0.0 && report.gpuBytes() > budgets.maxGpuMB * 1024 * 1024)
+        {
+            snprintf(text, sizeof(text), "%.1f MB of GPU memory, budget %.1f MB", report.gpuBytes() / (1024.0 * 1024.0), budgets.maxGpuMB);
+            report.failures.push_back(text);
+        }
+        for (const TextureInfo& texture : report.textures)
+        {
+            if (!texture.found)
+                continue;
+            if (budgets.maxTextureSize > 0 && std::max(texture.width, texture.height) > budgets.maxTextureSize)
+            {
+                snprintf(text, sizeof(text), "%dx%d texture, budget %d: ", texture.width, texture.height, budgets.maxTextureSize);
+                report.failures.push_back(text + texture.path);
+            }
+            if (!IsPowerOfTwo(texture.width) || !IsPowerOfTwo(texture.height))
+            {
+                snprintf(text, sizeof(text), "non-power-of-two %dx%d texture: ", texture.width, texture.height);
+                (budgets.allowNonPowerOfTwo ? report.warnings : report.failures).push_back(text + texture.path);
+            }
+        }
+        if (!report.unusedChannels.empty())
+        {
+            std::string channels;
+            for (const std::string& channel : report.unusedChannels)
+                channels += (channels.empty() ? "" : ", ") + channel;
+            (budgets.allowUnusedChannels ? report.warnings : report.failures).push_back("unused channels: " + channels);
+        }
+    }
+
+    inline Report Audit(const std::string& path, const Budgets& budgets)
+    {
+        TRACE_SCOPE("Audit asset", "audit");
+        double start = TraceRecorder::Now();
+        Report report;
+        report.path = path;
+        report.kind = IsImage(path) ? "texture" : "model";
+        if (report.kind == "texture")
+            AuditTexture(report);
+        else
+            AuditModel(report);
+        Check(report, budgets);
+        report.auditMs = (TraceRecorder::Now() - start) * 1e-3;
+        return report;
+    }
+
+    // every file assimp or stb_image can read in the directory, sorted
+    inline std::vector<std::string> ListAssets(const std::string& directory)
+    {
+        std::vector<std::string> names;
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &entry);
+        if (find != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                    names.push_back(entry.cFileName);
+            } while (FindNextFileA(find, &entry));
+            FindClose(find);
+        }
+#else
+        DIR* dir = opendir(directory.c_str());
+        if (dir)
+        {
+            while (dirent* entry = readdir(dir))
+            {
+                struct stat info;
+                std::string path = directory + "/" + entry->d_name;
+                if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                    names.push_back(entry->d_name);
+            }
+            closedir(dir);
+        }
+#endif
+        Assimp::Importer importer;
+        std::vector<std::string> paths;
+        for (const std::string& name : names)
+        {
+            std::string extension = Extension(name);
+            if (IsImage(name) || (!extension.empty() && importer.IsExtensionSupported("." + extension)))
+                paths.push_back(directory + "/" + name);
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    // one report per file, in the order of paths. Each job has its own importer, so the files are
+    // audited in parallel on the shared pool.
+    inline std::vector<Report> Run(const std::vector<std::string>& paths, const Budgets& budgets)
+    {
+        std::vector<Report> reports(paths.size());
+        ThreadPool::Shared().parallelFor(paths.size(), [&](size_t i) {
+            reports[i] = Audit(paths[i], budgets);
+        });
+        return reports;
+    }
+
+    // {"max_triangles": 100000, "max_texture_size": 4096, "max_gpu_mb": 64, "max_acmr": 0,
+    //  "max_duplication": 0, "allow_npot": true, "allow_unused_channels": true}, missing keys keep
+    // their current value
+    inline bool LoadBudgets(const std::string& path, Budgets& budgets, std::string& error)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        try
+        {
+            nlohmann::json json = nlohmann::json::parse(in);
+            Budgets loaded = budgets;
+            loaded.maxTriangles = json.value("max_triangles", loaded.maxTriangles);
+            loaded.maxTextureSize = json.value("max_texture_size", loaded.maxTextureSize);
+            loaded.maxGpuMB = json.value("max_gpu_mb", loaded.maxGpuMB);
+            loaded.maxAcmr = json.value("max_acmr", loaded.maxAcmr);
+            loaded.maxDuplication = json.value("max_duplication", loaded.maxDuplication);
+            loaded.allowNonPowerOfTwo = json.value("allow_npot", loaded.allowNonPowerOfTwo);
+            loaded.allowUnusedChannels = json.value("allow_unused_channels", loaded.allowUnusedChannels);
+            budgets = loaded;
+            return true;
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            error = e.what();
+            return false;
+        }
+    }
+
+    inline bool WriteJson(const std::string& path, const std::vector<Report>& reports, const Budgets& budgets)
+    {
+        nlohmann::json json;
+        json["budgets"] = {
+            { "max_triangles", budgets.maxTriangles }, { "max_texture_size", budgets.maxTextureSize },
+            { "max_gpu_mb", budgets.maxGpuMB }, { "max_acmr", budgets.maxAcmr }, { "max_duplication", budgets.maxDuplication },
+            { "allow_npot", budgets.allowNonPowerOfTwo }, { "allow_unused_channels", budgets.allowUnusedChannels },
+        };
+        json["assets"] = nlohmann::json::array();
+        for (const Report& report : reports)
+        {
+            nlohmann::json asset = {
+                { "path", report.path }, { "kind", report.kind }, { "failed", report.failed() },
+                { "meshes", report.meshes }, { "vertices", report.vertices }, { "triangles", report.triangles },
+                { "vertex_duplication", report.duplication }, { "acmr", report.acmr }, { "atvr", report.atvr },
+                { "unused_channels", report.unusedChannels }, { "geometry_bytes", report.geometryBytes },
+                { "texture_bytes", report.textureBytes }, { "gpu_bytes", report.gpuBytes() },
+                { "warnings", report.warnings }, { "failures", report.failures }, { "audit_ms", report.auditMs },
+            };
+            if (!report.error.empty())
+                asset["error"] = report.error;
+            asset["textures"] = nlohmann::json::array();
+            for (const TextureInfo& texture : report.textures)
+            {
+                asset["textures"].push_back({
+                    { "path", texture.path }, { "format", texture.format }, { "found", texture.found },
+                    { "width", texture.width }, { "height", texture.height }, { "components", texture.components },
+                    { "power_of_two", IsPowerOfTwo(texture.width) && IsPowerOfTwo(texture.height) },
+                });
+            }
+            json["assets"].push_back(asset);
+        }
+        std::ofstream out(path);
+        out << json.dump(2) << std::endl;
+        return static_cast<bool>(out);
+    }
+
+    // a line per asset, then its failures and warnings indented
+    inline void Print(std::ostream& os, const std::vector<Report>& reports)
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "%-6s %-36s %9s %9s %6s %6s %9s  %s", "", "asset", "tris", "verts", "dup", "acmr", "GPU MB", "textures");
+        os << line << "\n";
+        for (const Report& report : reports)
+        {
+            std::string textures;
+            for (const TextureInfo& texture : report.textures)
+                textures += (textures.empty() ? "" : " ") + (texture.found ? std::to_string(texture.width) + "x" + std::to_string(texture.height) + " " + texture.format : texture.format.empty() ? "missing" : texture.format);
+            snprintf(line, sizeof(line), "%-6s %-36s %9zu %9zu %6.2f %6.2f %9.2f  ", report.failed() ? "FAIL" : report.warnings.empty() ? "ok" : "warn",
+                report.path.c_str(), report.triangles, report.vertices, report.duplication, report.acmr, report.gpuBytes() / (1024.0 * 1024.0));
+            os << line << textures << "\n";
+            if (!report.error.empty())
+                os << "         error: " << report.error << "\n";
+            for (const std::string& failure : report.failures)
+                os << "         over budget: " << failure << "\n";
+            for (const std::string& warning : report.warnings)
+                os << "         " << warning << "\n";
+        }
+        os.flush();
+    }
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include "Mesh.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Baked mesh files: the converted vertex and index buffers of a model and the textures of every
+// mesh, stored next to nothing but the size and modification time of the source file. Reading one
+// back is a couple of bulk reads: Residency::OnDemand rebuilds CPU copies from it, and a model whose
+// file is fresh is loaded from it without going through assimp at all.
+// Several processes may share the directory (batch renders), a file is written under a temporary
+// name and renamed into place so readers never see half of it.
+namespace AssetCache {
+
+    const char* const Directory = "cache";
+    const uint32_t Magic = 0x4853454D; // "MESH"
+    const uint32_t Version = 2;
+
+    // a mesh as stored in the file, the textures have no GL id yet
+    struct BakedMesh {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<Texture> textures;
+    };
+
+    struct SourceStamp {
+        uint64_t size = 0;
+        int64_t modified = 0;
+    };
+
+    inline bool GetSourceStamp(const std::string& sourcePath, SourceStamp& stamp)
+    {
+#ifdef _WIN32
+        struct _stat64 info;
+        if (_stat64(sourcePath.c_str(), &info) != 0)
+            return false;
+#else
+        struct stat info;
+        if (stat(sourcePath.c_str(), &info) != 0)
+            return false;
+#endif
+        stamp.size = static_cast<uint64_t>(info.st_size);
+        stamp.modified = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
+
+    // forward slashes without "." or empty segments, so ./resources//a.jpg and resources\a.jpg
+    // name the same file as resources/a.jpg
+    inline std::string NormalPath(const std::string& path)
+    {
+        std::string normal;
+        if (!path.empty() && (path[0] == '/' || path[0] == '\\'))
+            normal = "/";
+        size_t start = 0;
+        while (start <= path.size())
+        {
+            size_t end = path.find_first_of("/\\", start);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string segment = path.substr(start, end - start);
+            if (!segment.empty() && segment != ".")
+                normal += (normal.empty() || normal.back() == '/' ? "" : "/") + segment;
+            start = end + 1;
+        }
+        return normal;
+    }
+
+    // cache/<source path with separators flattened><extension>
+    inline std::string CachePath(const std::string& sourcePath, const std::string& extension)
+    {
+        std::string name = NormalPath(sourcePath);
+        for (char& c : name)
+            if (c == '/' || c == '\\' || c == ':')
+                c = '_';
+        return std::string(Directory) + "/" + name + extension;
+    }
+
+    inline std::string BakedPath(const std::string& sourcePath)
+    {
+        return CachePath(sourcePath, ".mesh");
+    }
+
+    // reads the header of the baked file and checks it against the current source file
+    inline bool IsFresh(const std::string& sourcePath)
+    {
+        SourceStamp stamp;
+        if (!GetSourceStamp(sourcePath, stamp))
+            return false;
+        std::ifstream in(BakedPath(sourcePath), std::ios::binary);
+        uint32_t magic = 0, version = 0;
+        SourceStamp baked;
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&baked.size), sizeof(baked.size));
+        in.read(reinterpret_cast<char*>(&baked.modified), sizeof(baked.modified));
+        return in && magic == Magic && version == Version && baked.size == stamp.size && baked.modified == stamp.modified;
+    }
+
+    inline void WriteString(std::ofstream& out, const std::string& text)
+    {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(text.data(), length);
+    }
+
+    inline bool ReadString(std::ifstream& in, std::string& text)
+    {
+        uint32_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!in || length > 4096)
+            return false;
+        text.resize(length);
+        in.read(&text[0], length);
+        return static_cast<bool>(in);
+    }
+
+    // skips the texture references of a mesh
+    inline bool SkipTextures(std::ifstream& in)
+    {
+        uint32_t textureCount = 0;
+        in.read(reinterpret_cast<char*>(&textureCount), sizeof(textureCount));
+        std::string ignored;
+        for (uint32_t t = 0; in && t < textureCount * 2; t++)
+            ReadString(in, ignored);
+        return static_cast<bool>(in);
+    }
+
+    // writes the CPU copies of the meshes, they must not have been released yet
+    inline bool Write(const std::string& sourcePath, const std::vector<Mesh>& meshes)
+    {
+        SourceStamp stamp;
+        if (!GetSourceStamp(sourcePath, stamp))
+            return false;
+#ifdef _WIN32
+        _mkdir(Directory);
+        int processId = _getpid();
+#else
+        mkdir(Directory, 0755);
+        int processId = static_cast<int>(getpid());
+#endif
+        std::string path = BakedPath(sourcePath);
+        std::string temporaryPath = path + "." + std::to_string(processId) + ".tmp";
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        uint64_t meshCount = meshes.size();
+        out.write(reinterpret_cast<const char*>(&Magic), sizeof(Magic));
+        out.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+        out.write(reinterpret_cast<const char*>(&stamp.size), sizeof(stamp.size));
+        out.write(reinterpret_cast<const char*>(&stamp.modified), sizeof(stamp.modified));
+        out.write(reinterpret_cast<const char*>(&meshCount), sizeof(meshCount));
+        for (const Mesh& mesh : meshes)
+        {
+            uint64_t vertexCount = mesh.vertices.size();
+            uint64_t indexCount = mesh.indices.size();
+            out.write(reinterpret_cast<const char*>(&vertexCount), sizeof(vertexCount));
+            out.write(reinterpret_cast<const char*>(mesh.vertices.data()), vertexCount * sizeof(Vertex));
+            out.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+            out.write(reinterpret_cast<const char*>(mesh.indices.data()), indexCount * sizeof(unsigned int));
+            uint32_t textureCount = static_cast<uint32_t>(mesh.textures.size());
+            out.write(reinterpret_cast<const char*>(&textureCount), sizeof(textureCount));
+            for (const Texture& texture : mesh.textures)
+            {
+                WriteString(out, texture.type);
+                WriteString(out, texture.path);
+            }
+        }
+        out.close();
+        if (!out)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        // rename doesn't replace an existing file on Windows. Another process may bake the same
+        // file at the same time, whichever rename lands last wins and both results are equal.
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // refills the CPU copies of already uploaded meshes, fails if the file doesn't match them
+    inline bool Read(const std::string& sourcePath, std::vector<Mesh>& meshes)
+    {
+        if (!IsFresh(sourcePath))
+            return false;
+        std::ifstream in(BakedPath(sourcePath), std::ios::binary);
+        in.seekg(sizeof(uint32_t) * 2 + sizeof(uint64_t) + sizeof(int64_t));
+        uint64_t meshCount = 0;
+        in.read(reinterpret_cast<char*>(&meshCount), sizeof(meshCount));
+        if (!in || meshCount != meshes.size())
+            return false;
+        for (Mesh& mesh : meshes)
+        {
+            uint64_t vertexCount = 0, indexCount = 0;
+            in.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount));
+            if (!in || vertexCount != mesh.vertexCount)
+                return false;
+            mesh.vertices.resize(vertexCount);
+            in.read(reinterpret_cast<char*>(mesh.vertices.data()), vertexCount * sizeof(Vertex));
+            in.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
+            if (!in || indexCount != mesh.indexCount)
+                return false;
+            mesh.indices.resize(indexCount);
+            in.read(reinterpret_cast<char*>(mesh.indices.data()), indexCount * sizeof(unsigned int));
+            if (!SkipTextures(in))
+                return false;
+        }
+        return static_cast<bool>(in);
+    }
+
+    // reads every mesh of a fresh baked file, fails if it is missing, stale or damaged
+    inline bool ReadBaked(const std::string& sourcePath, std::vector<BakedMesh>& meshes)
+    {
+        if (!IsFresh(sourcePath))
+            return false;
+        std::ifstream in(BakedPath(sourcePath), std::ios::binary);
+        in.seekg(sizeof(uint32_t) * 2 + sizeof(uint64_t) + sizeof(int64_t));
+        uint64_t meshCount = 0;
+        in.read(reinterpret_cast<char*>(&meshCount), sizeof(meshCount));
+        if (!in || meshCount > (1u << 20))
+            return false;
+        meshes.resize(static_cast<size_t>(meshCount));
+        for (BakedMesh& mesh : meshes)
+        {
+            uint64_t vertexCount = 0, indexCount = 0;
+            in.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount));
+            if (!in || vertexCount > (1u << 28))
+                return false;
+            mesh.vertices.resize(static_cast<size_t>(vertexCount));
+            in.read(reinterpret_cast<char*>(mesh.vertices.data()), vertexCount * sizeof(Vertex));
+            in.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
+            if (!in || indexCount > (1u << 30))
+                return false;
+            mesh.indices.resize(static_cast<size_t>(indexCount));
+            in.read(reinterpret_cast<char*>(mesh.indices.data()), indexCount * sizeof(unsigned int));
+            uint32_t textureCount = 0;
+            in.read(reinterpret_cast<char*>(&textureCount), sizeof(textureCount));
+            if (!in || textureCount > 64)
+                return false;
+            mesh.textures.resize(textureCount);
+            for (Texture& texture : mesh.textures)
+            {
+                texture.id = 0;
+                if (!ReadString(in, texture.type) || !ReadString(in, texture.path))
+                    return false;
+            }
+        }
+        return static_cast<bool>(in);
+    }
+}
+
+#endif
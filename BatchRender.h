@@ -0,0 +1,227 @@
+#ifndef BATCH_RENDER_H
+#define BATCH_RENDER_H
+
+#include "Offscreen.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One saved scene of a batch and the poses it is rendered from.
+struct RenderJob {
+    std::string scenePath;
+    std::vector<CameraPose> poses;
+};
+
+// Inputs and bookkeeping of batch renders: manifests, scene directories, worker shards and the
+// CSV report. The rendering itself lives with the scene code in main.cpp.
+namespace BatchRender {
+
+    // *.bin files of a directory, sorted so every run renders in the same order
+    inline std::vector<std::string> ListSceneFiles(const std::string& directory)
+    {
+        std::vector<std::string> paths;
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        HANDLE find = FindFirstFileA((directory + "\\*.bin").c_str(), &entry);
+        if (find != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                    paths.push_back(directory + "/" + entry.cFileName);
+            } while (FindNextFileA(find, &entry));
+            FindClose(find);
+        }
+#else
+        DIR* dir = opendir(directory.c_str());
+        if (dir)
+        {
+            while (dirent* entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0)
+                    paths.push_back(directory + "/" + name);
+            }
+            closedir(dir);
+        }
+#endif
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    inline bool IsDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        DWORD attributes = GetFileAttributesA(path.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+        DIR* dir = opendir(path.c_str());
+        if (dir)
+            closedir(dir);
+        return dir != nullptr;
+#endif
+    }
+
+    // creates one directory level, an existing directory is fine
+    inline void MakeDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+    }
+
+    // One scene per line: the path (in quotes if it has spaces), then its poses as x,y,z[,yaw[,pitch]]
+    // separated by spaces. Scenes without poses get defaultPoses. Empty lines and # comments are
+    // skipped, paths are relative to the working directory. False on a line that doesn't parse.
+    inline bool ReadManifest(const std::string& path, const std::vector<CameraPose>& defaultPoses, std::vector<RenderJob>& jobs, std::string& error)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        std::string line;
+        for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+        {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#')
+                continue;
+            RenderJob job;
+            size_t end;
+            if (line[start] == '"')
+            {
+                end = line.find('"', start + 1);
+                if (end == std::string::npos)
+                {
+                    error = path + ":" + std::to_string(lineNumber) + ": unterminated quote";
+                    return false;
+                }
+                job.scenePath = line.substr(start + 1, end - start - 1);
+                end++;
+            }
+            else
+            {
+                end = line.find_first_of(" \t\r", start);
+                job.scenePath = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            }
+            std::istringstream rest(end == std::string::npos ? std::string() : line.substr(end));
+            std::string token;
+            while (rest >> token)
+            {
+                CameraPose pose;
+                if (!CameraPose::Parse(token, pose))
+                {
+                    error = path + ":" + std::to_string(lineNumber) + ": bad pose " + token;
+                    return false;
+                }
+                job.poses.push_back(pose);
+            }
+            if (job.poses.empty())
+                job.poses = defaultPoses;
+            jobs.push_back(job);
+        }
+        return true;
+    }
+
+    inline bool WriteManifest(const std::string& path, const std::vector<RenderJob>& jobs)
+    {
+        std::ofstream out(path);
+        for (const RenderJob& job : jobs)
+        {
+            out << '"' << job.scenePath << '"';
+            for (const CameraPose& pose : job.poses)
+                out << ' ' << pose.position.x << ',' << pose.position.y << ',' << pose.position.z << ',' << pose.yaw << ',' << pose.pitch;
+            out << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+
+    // every count-th job starting at first, so workers get a similar mix of scenes
+    inline std::vector<RenderJob> Shard(const std::vector<RenderJob>& jobs, size_t first, size_t count)
+    {
+        std::vector<RenderJob> shard;
+        for (size_t i = first; i < jobs.size(); i += count)
+            shard.push_back(jobs[i]);
+        return shard;
+    }
+
+    inline std::string CsvField(const std::string& text)
+    {
+        if (text.find_first_of(",\"\n") == std::string::npos)
+            return text;
+        std::string quoted = "\"";
+        for (char c : text)
+            quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+        return quoted + "\"";
+    }
+
+    const char* const CsvHeader = "scene,status,images,load_ms,render_ms,write_ms,worker,renderer";
+
+    // appends the rows of the worker reports to out, without their headers
+    inline size_t AppendCsvRows(const std::string& path, std::ostream& out)
+    {
+        std::ifstream in(path);
+        std::string line;
+        size_t rows = 0;
+        for (bool header = true; std::getline(in, line); header = false)
+        {
+            if (header || line.empty())
+                continue;
+            out << line << '\n';
+            rows++;
+        }
+        return rows;
+    }
+
+    // one argument of a command line for RunCommand
+    inline std::string ShellQuote(const std::string& text)
+    {
+#ifdef _WIN32
+        return "\"" + text + "\"";
+#else
+        // sh expands $ and backticks inside double quotes, nothing inside single ones
+        std::string quoted = "'";
+        for (char c : text)
+            quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        return quoted + "'";
+#endif
+    }
+
+    // runs a command line and waits for it, returns its exit code
+    inline int RunCommand(const std::string& command)
+    {
+#ifdef _WIN32
+        // cmd /c strips the first and last quote of the line
+        return std::system(("\"" + command + "\"").c_str());
+#else
+        // system returns a wait status, a killed command reports 128 + the signal like sh does
+        int status = std::system(command.c_str());
+        if (status == -1)
+            return -1;
+        if (WIFEXITED(status))
+            return WEXITSTATUS(status);
+        return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : status;
+#endif
+    }
+}
+
+#endif
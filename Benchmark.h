@@ -0,0 +1,821 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Model.h"
+#include "MeshConversion.h"
+#include "Meshlet.h"
+#include "NameRegistry.h"
+#include "Outliner.h"
+#include "Picking.h"
+#include "SceneBVH.h"
+#include "SceneStore.h"
+#include "FramePacer.h"
+#include "ProcessStats.h"
+#include "ThreadPool.h"
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Command line micro-benchmarks, they run before any window or GL context is created.
+namespace Benchmark {
+
+    inline double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Measures the aiMesh -> Vertex/index conversion done by Model::processMesh.
+    // The assimp parse is timed once and reported separately since it is not part of the conversion.
+    inline int RunImport(const std::string& path, int iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            return 1;
+        }
+        double parseMs = ElapsedMs(start);
+
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+        {
+            vertexCount += scene->mMeshes[m]->mNumVertices;
+            indexCount += scene->mMeshes[m]->mNumFaces * 3;
+        }
+
+        // serial: one pair of buffers reused for every mesh, like the old processNode recursion
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        double bestMs = 1e30;
+        double totalMs = 0.0;
+        for (int it = 0; it < iterations; it++)
+        {
+            start = std::chrono::steady_clock::now();
+            for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+            {
+                // fresh buffers every time, the allocation is part of what processMesh pays for
+                std::vector<Vertex>().swap(vertices);
+                std::vector<unsigned int>().swap(indices);
+                ConvertVertices(scene->mMeshes[m], vertices);
+                ConvertIndices(scene->mMeshes[m], indices);
+            }
+            double ms = ElapsedMs(start);
+            bestMs = std::min(bestMs, ms);
+            totalMs += ms;
+        }
+        double meanMs = totalMs / iterations;
+
+        // parallel: one job per mesh on the shared pool, the way Model::loadModel runs it
+        ThreadPool& pool = ThreadPool::Shared();
+        std::vector<std::vector<Vertex>> meshVertices(scene->mNumMeshes);
+        std::vector<std::vector<unsigned int>> meshIndices(scene->mNumMeshes);
+        double bestParallelMs = 1e30;
+        for (int it = 0; it < iterations; it++)
+        {
+            for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+            {
+                std::vector<Vertex>().swap(meshVertices[m]);
+                std::vector<unsigned int>().swap(meshIndices[m]);
+            }
+            start = std::chrono::steady_clock::now();
+            pool.parallelFor(scene->mNumMeshes, [&](size_t m) {
+                ConvertVertices(scene->mMeshes[m], meshVertices[m]);
+                ConvertIndices(scene->mMeshes[m], meshIndices[m]);
+            });
+            bestParallelMs = std::min(bestParallelMs, ElapsedMs(start));
+        }
+
+        std::cout << "import benchmark: " << path << "\n"
+            << "  meshes: " << scene->mNumMeshes << ", vertices: " << vertexCount << ", indices: " << indexCount << "\n"
+            << "  assimp parse + postprocess: " << parseMs << " ms\n"
+            << "  conversion (" << iterations << " iterations): mean " << meanMs << " ms, best " << bestMs << " ms\n"
+            << "  throughput: " << (vertexCount / (bestMs / 1000.0)) / 1e6 << " Mvertices/s\n"
+            << "  parallel conversion (" << pool.size() + 1 << " threads): best " << bestParallelMs << " ms, "
+            << bestMs / bestParallelMs << "x" << std::endl;
+        return 0;
+    }
+
+    // Measures how many triangles of a room survive meshlet culling compared to submitting the whole mesh.
+    // The camera stands at a few points inside the room bounds and looks around in 8 directions.
+    inline int RunMeshlets(const std::string& path)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            return 1;
+        }
+
+        std::vector<std::vector<Vertex>> vertices(scene->mNumMeshes);
+        std::vector<std::vector<unsigned int>> indices(scene->mNumMeshes);
+        std::vector<std::vector<Meshlet>> meshlets(scene->mNumMeshes);
+        AABB bounds;
+        size_t meshletCount = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+        {
+            ConvertVertices(scene->mMeshes[m], vertices[m]);
+            ConvertIndices(scene->mMeshes[m], indices[m]);
+            meshlets[m] = BuildMeshlets(&vertices[m][0].Position.x, sizeof(Vertex), vertices[m].size(), indices[m]);
+            meshletCount += meshlets[m].size();
+            for (const Vertex& vertex : vertices[m])
+                bounds.expand(vertex.Position);
+        }
+        double buildMs = ElapsedMs(start);
+        if (meshletCount == 0)
+        {
+            std::cout << "ERROR::MESHLETS:: " << path << " has no triangles" << std::endl;
+            return 1;
+        }
+
+        const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        const glm::vec3 center = bounds.center();
+        const glm::vec3 extents = bounds.extents();
+        const glm::vec3 viewpoints[] = {
+            center,
+            center + glm::vec3(extents.x * 0.5f, 0.0f, extents.z * 0.5f),
+            center - glm::vec3(extents.x * 0.5f, 0.0f, extents.z * 0.5f)
+        };
+        const char* modes[] = { "frustum", "cone", "frustum + cone" };
+        std::cout << "meshlet benchmark: " << path << "\n"
+            << "  meshlets: " << meshletCount << " (max " << MESHLET_MAX_VERTICES << " vertices / " << MESHLET_MAX_TRIANGLES
+            << " triangles), built in " << buildMs << " ms\n";
+        for (int mode = 0; mode < 3; mode++)
+        {
+            MeshletCullContext context;
+            context.frustumCulling = mode != 1;
+            context.coneCulling = mode != 0;
+            MeshletStats stats;
+            std::vector<int> counts;
+            std::vector<const void*> offsets;
+            start = std::chrono::steady_clock::now();
+            for (const glm::vec3& eye : viewpoints)
+            {
+                for (int direction = 0; direction < 8; direction++)
+                {
+                    float yaw = glm::radians(45.0f * direction);
+                    glm::vec3 forward(std::sin(yaw), 0.0f, -std::cos(yaw));
+                    context.frustum = Frustum::FromMatrix(projection * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+                    context.cameraPosition = eye;
+                    for (const std::vector<Meshlet>& meshMeshlets : meshlets)
+                        CullMeshlets(meshMeshlets, context, counts, offsets, stats);
+                }
+            }
+            double cullMs = ElapsedMs(start);
+            size_t views = 3 * 8;
+            std::cout << "  " << modes[mode] << ": " << stats.trianglesDrawn / views << " / " << stats.triangles / views
+                << " triangles per view (" << 100.0 * (1.0 - double(stats.trianglesDrawn) / stats.triangles) << "% culled), "
+                << double(stats.drawRanges) / views << " draw ranges, " << cullMs / views * 1000.0 << " us per view\n";
+        }
+        std::cout << std::flush;
+        return 0;
+    }
+
+    // Build, refit and query costs of SceneBVH for growing scenes, against a linear walk over the boxes.
+    // Objects are 0.2 - 2 m boxes spread at a constant density, about one per 8 cubic meters.
+    inline int RunBVH()
+    {
+        const size_t sizes[] = { 100, 1000, 10000, 100000 };
+        const int queries = 1000;
+        std::cout << "BVH benchmark (" << queries << " queries per kind, times per operation)\n"
+            << std::setw(8) << "objects" << std::setw(12) << "build ms" << std::setw(14) << "jitter us"
+            << std::setw(14) << "relocate us" << std::setw(12) << "refit ms" << std::setw(14) << "frustum us"
+            << std::setw(14) << "linear us" << std::setw(12) << "ray us" << std::setw(14) << "linear us"
+            << std::setw(12) << "radius us" << std::setw(10) << "height" << "\n";
+        for (size_t count : sizes)
+        {
+            std::mt19937 random(42);
+            float side = 2.0f * std::cbrt(static_cast<float>(count));
+            std::uniform_real_distribution<float> coordinate(-side * 0.5f, side * 0.5f);
+            std::uniform_real_distribution<float> halfSize(0.1f, 1.0f);
+            std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+            auto randomBox = [&]() {
+                glm::vec3 center(coordinate(random), coordinate(random), coordinate(random));
+                glm::vec3 half(halfSize(random), halfSize(random), halfSize(random));
+                return AABB(center - half, center + half);
+            };
+            auto offset = [](const AABB& box, const glm::vec3& delta) { return AABB(box.min + delta, box.max + delta); };
+
+            std::vector<AABB> boxes(count);
+            for (AABB& box : boxes)
+                box = randomBox();
+
+            SceneBVH bvh;
+            std::vector<int> proxies(count);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+                proxies[i] = bvh.createProxy(boxes[i], static_cast<int>(i));
+            double buildMs = ElapsedMs(start);
+
+            // small moves stay inside the enlarged leaf boxes
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+            {
+                boxes[i] = offset(boxes[i], glm::vec3(jitter(random), jitter(random), jitter(random)));
+                bvh.moveProxy(proxies[i], boxes[i]);
+            }
+            double jitterUs = ElapsedMs(start) * 1000.0 / count;
+
+            // a tenth of the objects is moved somewhere else
+            size_t relocated = std::max<size_t>(1, count / 10);
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < relocated; i++)
+            {
+                size_t index = random() % count;
+                boxes[index] = randomBox();
+                bvh.moveProxy(proxies[index], boxes[index]);
+            }
+            double relocateUs = ElapsedMs(start) * 1000.0 / relocated;
+
+            // the whole scene shifted at once, refit without reinserting
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+            {
+                boxes[i] = offset(boxes[i], glm::vec3(0.5f, 0.0f, 0.0f));
+                bvh.setProxyBox(proxies[i], boxes[i]);
+            }
+            bvh.refit();
+            double refitMs = ElapsedMs(start);
+
+            // cameras inside the scene looking in random directions
+            std::vector<glm::vec3> origins(queries), directions(queries);
+            for (int q = 0; q < queries; q++)
+            {
+                origins[q] = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+                directions[q] = glm::normalize(glm::vec3(jitter(random), jitter(random), jitter(random)) + glm::vec3(1e-4f));
+            }
+            const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+            std::vector<Frustum> frustums(queries);
+            for (int q = 0; q < queries; q++)
+                frustums[q] = Frustum::FromMatrix(projection * glm::lookAt(origins[q], origins[q] + directions[q], glm::vec3(0.0f, 1.0f, 0.0f)));
+
+            // the visible counts are summed so the loops can't be optimized away
+            size_t visibleTree = 0, visibleLinear = 0;
+            start = std::chrono::steady_clock::now();
+            for (const Frustum& frustum : frustums)
+                bvh.queryFrustum(frustum, [&](int index) { visibleTree += frustum.intersectsAABB(boxes[index]) ? 1 : 0; });
+            double frustumUs = ElapsedMs(start) * 1000.0 / queries;
+            start = std::chrono::steady_clock::now();
+            for (const Frustum& frustum : frustums)
+                for (const AABB& box : boxes)
+                    visibleLinear += frustum.intersectsAABB(box) ? 1 : 0;
+            double frustumLinearUs = ElapsedMs(start) * 1000.0 / queries;
+
+            // nearest box along each ray
+            size_t hitsTree = 0, hitsLinear = 0;
+            start = std::chrono::steady_clock::now();
+            for (int q = 0; q < queries; q++)
+            {
+                glm::vec3 inverseDirection = 1.0f / directions[q];
+                float nearest = FLT_MAX;
+                bvh.queryRay(origins[q], directions[q], FLT_MAX, [&](int index, float) {
+                    float t;
+                    if (boxes[index].intersectsRay(origins[q], inverseDirection, nearest, t))
+                        nearest = t;
+                    return nearest;
+                });
+                hitsTree += nearest < FLT_MAX ? 1 : 0;
+            }
+            double rayUs = ElapsedMs(start) * 1000.0 / queries;
+            start = std::chrono::steady_clock::now();
+            for (int q = 0; q < queries; q++)
+            {
+                glm::vec3 inverseDirection = 1.0f / directions[q];
+                float nearest = FLT_MAX;
+                for (const AABB& box : boxes)
+                {
+                    float t;
+                    if (box.intersectsRay(origins[q], inverseDirection, nearest, t))
+                        nearest = t;
+                }
+                hitsLinear += nearest < FLT_MAX ? 1 : 0;
+            }
+            double rayLinearUs = ElapsedMs(start) * 1000.0 / queries;
+
+            size_t nearby = 0;
+            start = std::chrono::steady_clock::now();
+            for (int q = 0; q < queries; q++)
+                bvh.queryRadius(origins[q], 3.0f, [&](int index) { nearby += boxes[index].distanceSquared(origins[q]) <= 9.0f ? 1 : 0; });
+            double radiusUs = ElapsedMs(start) * 1000.0 / queries;
+
+            if (visibleTree != visibleLinear || hitsTree != hitsLinear)
+                std::cout << "  mismatch: frustum " << visibleTree << " / " << visibleLinear << ", rays " << hitsTree << " / " << hitsLinear << "\n";
+
+            std::cout << std::fixed << std::setprecision(3)
+                << std::setw(8) << count << std::setw(12) << buildMs << std::setw(14) << jitterUs
+                << std::setw(14) << relocateUs << std::setw(12) << refitMs << std::setw(14) << frustumUs
+                << std::setw(14) << frustumLinearUs << std::setw(12) << rayUs << std::setw(14) << rayLinearUs
+                << std::setw(12) << radiusUs << std::setw(10) << bvh.height() << "\n";
+            (void)nearby;
+        }
+        std::cout << std::flush;
+        return 0;
+    }
+
+    // Mouse picking cost on a large scene: instances of one asset on a grid, rays through random
+    // pixels of a 1920x1080 view looking over the scene. Picks go through the object BVH and the
+    // triangle BVH of the asset, a walk over every instance is timed for comparison on a few rays.
+    inline int RunPick(const std::string& path, size_t instanceCount)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            return 1;
+        }
+        std::vector<Triangle> triangles;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+        {
+            ConvertVertices(scene->mMeshes[m], vertices);
+            ConvertIndices(scene->mMeshes[m], indices);
+            if (!vertices.empty())
+                AppendTriangles(&vertices[0].Position.x, sizeof(Vertex), indices.data(), indices.size(), triangles);
+        }
+        size_t triangleCount = triangles.size();
+        auto start = std::chrono::steady_clock::now();
+        TriangleBVH asset(std::move(triangles));
+        double buildMs = ElapsedMs(start);
+
+        // scale the asset to about 1 m and lay the instances out 2 m apart with random yaw
+        AABB local = asset.bounds();
+        glm::vec3 dimensions = local.max - local.min;
+        float size = std::max(dimensions.x, std::max(dimensions.y, dimensions.z));
+        float scale = size > 0.0f ? 1.0f / size : 1.0f;
+        size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+        std::vector<glm::mat4> inverses(instanceCount);
+        SceneBVH bvh;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < instanceCount; i++)
+        {
+            glm::vec3 position(2.0f * (i % side) - side, 0.0f, 2.0f * (i / side) - side);
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+            transform = glm::rotate(transform, glm::radians(angle(random)), glm::vec3(0.0f, 1.0f, 0.0f));
+            transform = glm::scale(transform, glm::vec3(scale));
+            transform = glm::translate(transform, -local.center());
+            inverses[i] = glm::inverse(transform);
+            bvh.createProxy(local.transformed(transform), static_cast<int>(i));
+        }
+        double sceneMs = ElapsedMs(start);
+
+        // camera above the edge of the grid looking at its middle
+        float extent = static_cast<float>(side);
+        glm::vec3 eye(0.0f, extent * 0.3f + 2.0f, extent + 2.0f);
+        glm::mat4 cameraMatrix = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 10.0f * extent + 100.0f)
+            * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        std::uniform_real_distribution<double> pixelX(0.0, 1920.0), pixelY(0.0, 1080.0);
+        const int picks = 10000;
+        std::vector<Ray> rays(picks);
+        for (Ray& ray : rays)
+            ray = ScreenPointToRay(pixelX(random), pixelY(random), 1920, 1080, cameraMatrix);
+
+        auto pick = [&](const Ray& ray, float& closest) {
+            int picked = -1;
+            closest = FLT_MAX;
+            bvh.queryRay(ray.origin, ray.direction, FLT_MAX, [&](int index, float) {
+                float t;
+                if (IntersectInstance(asset, inverses[index], ray, closest, t))
+                {
+                    closest = t;
+                    picked = index;
+                }
+                return closest;
+            });
+            return picked;
+        };
+
+        std::vector<double> times(picks);
+        std::vector<int> picked(picks);
+        std::vector<float> distances(picks);
+        for (int i = 0; i < picks; i++)
+        {
+            start = std::chrono::steady_clock::now();
+            picked[i] = pick(rays[i], distances[i]);
+            times[i] = ElapsedMs(start) * 1000.0;
+        }
+        size_t hits = std::count_if(picked.begin(), picked.end(), [](int index) { return index >= 0; });
+
+        // reference: every instance tested on its own, only on a few rays
+        const int referencePicks = 20;
+        int mismatches = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < referencePicks; i++)
+        {
+            int best = -1;
+            float closest = FLT_MAX;
+            for (size_t index = 0; index < instanceCount; index++)
+            {
+                float t;
+                if (IntersectInstance(asset, inverses[index], rays[i], closest, t))
+                {
+                    closest = t;
+                    best = static_cast<int>(index);
+                }
+            }
+            if (best >= 0 ? std::abs(closest - distances[i]) > 1e-4f * closest : picked[i] >= 0)
+                mismatches++;
+        }
+        double referenceUs = ElapsedMs(start) * 1000.0 / referencePicks;
+
+        std::sort(times.begin(), times.end());
+        double total = 0.0;
+        for (double time : times)
+            total += time;
+        std::cout << "pick benchmark: " << path << "\n"
+            << "  asset: " << triangleCount << " triangles, triangle BVH built in " << buildMs << " ms (" << asset.bytes() / 1024 << " KB)\n"
+            << "  scene: " << instanceCount << " instances, " << static_cast<double>(triangleCount) * instanceCount / 1e6
+            << " M triangles, object BVH built in " << sceneMs << " ms\n"
+            << "  " << picks << " picks, " << hits << " hits: mean " << total / picks << " us, p50 " << times[picks / 2]
+            << " us, p99 " << times[picks * 99 / 100] << " us, max " << times.back() << " us\n"
+            << "  without the object BVH: " << referenceUs << " us per pick"
+            << (mismatches ? ", " + std::to_string(mismatches) + " different results!" : std::string()) << std::endl;
+        return mismatches ? 1 : 0;
+    }
+
+    // Cost of keeping the object matrices current: rebuilding every matrix with glm like
+    // Model::GetTransformMatrix did each frame, against TransformStore with all, 1% and no objects dirty.
+    inline int RunTransforms()
+    {
+        const size_t counts[] = { 10000, 100000 };
+        const int iterations = 20;
+        std::cout << "transform benchmark (best of " << iterations << " frames, ns per object)\n";
+        for (size_t count : counts)
+        {
+            std::mt19937 random(11);
+            std::uniform_real_distribution<float> coordinate(-30.0f, 30.0f), angle(-180.0f, 180.0f), size(0.1f, 2.0f);
+            std::vector<Model> models(count);
+            TransformStore store;
+            for (Model& model : models)
+            {
+                model.position = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+                model.rotation = glm::vec3(angle(random), angle(random), angle(random));
+                model.scale = glm::vec3(size(random));
+                store.add(model.position, model.rotation, model.scale);
+            }
+
+            // the matrices are summed so the loops can't be optimized away
+            std::vector<glm::mat4> matrices(count);
+            double glmBest = 1e30;
+            for (int iteration = 0; iteration < iterations; iteration++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < count; i++)
+                    matrices[i] = models[i].GetTransformMatrix();
+                glmBest = std::min(glmBest, ElapsedMs(start));
+            }
+
+            auto timeUpdate = [&](size_t dirtyCount) {
+                double best = 1e30;
+                for (int iteration = 0; iteration < iterations; iteration++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    for (size_t i = 0; i < dirtyCount; i++)
+                    {
+                        size_t index = i * (count / dirtyCount);
+                        store.setPosition(index, models[index].position);
+                    }
+                    store.update();
+                    best = std::min(best, ElapsedMs(start));
+                }
+                return best;
+            };
+            double allBest = timeUpdate(count);
+            double fewBest = timeUpdate(count / 100);
+            double noneBest = timeUpdate(0);
+
+            float maxError = 0.0f;
+            for (size_t i = 0; i < count; i++)
+                for (int column = 0; column < 4; column++)
+                    for (int row = 0; row < 4; row++)
+                        maxError = std::max(maxError, std::abs(store.world(i)[column][row] - matrices[i][column][row]));
+
+            double toNs = 1e6 / count;
+            std::cout << "  " << count << " objects: glm every frame " << glmBest * toNs << " ns, store all dirty " << allBest * toNs
+                << " ns, 1% dirty " << fewBest * toNs << " ns, none dirty " << noneBest * toNs << " ns"
+                << " (max difference " << maxError << ")\n";
+        }
+        std::cout << std::flush;
+        return 0;
+    }
+
+    // Adding and deleting objects in random order: SceneStore (slot map, swap-remove, handles)
+    // against the vectors it replaced, where erase shifts every later object and renumbers its BVH leaf.
+    inline int RunSceneStore()
+    {
+        std::cout << "scene store benchmark (objects added, then deleted in random order)\n";
+        // one mesh-less asset shared by every object, like placing the same file many times
+        std::shared_ptr<Model> asset = std::make_shared<Model>();
+        int failures = 0;
+
+        const size_t storeCounts[] = { 10000, 100000 };
+        for (size_t count : storeCounts)
+        {
+            std::mt19937 random(5);
+            std::uniform_real_distribution<float> coordinate(-30.0f, 30.0f);
+            SceneStore scene;
+            std::vector<SceneHandle> handles;
+            handles.reserve(count);
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+            {
+                glm::vec3 position(coordinate(random), coordinate(random), coordinate(random));
+                handles.push_back(scene.add(asset, "Object" + std::to_string(i), position, glm::vec3(0.0f), glm::vec3(1.0f)));
+            }
+            double addMs = ElapsedMs(start);
+
+            std::shuffle(handles.begin(), handles.end(), random);
+            start = std::chrono::steady_clock::now();
+            for (const SceneHandle& handle : handles)
+                scene.remove(handle);
+            double removeMs = ElapsedMs(start);
+
+            // removed objects must stay unreachable even after their slots are reused
+            scene.add(asset, "Reused", glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+            size_t stale = 0;
+            for (const SceneHandle& handle : handles)
+                stale += scene.contains(handle) ? 1 : 0;
+            failures += stale != 0 || scene.size() != 1 || scene.bvhHeight() != 0;
+
+            std::cout << "  SceneStore " << count << " objects: add " << addMs << " ms (" << count / addMs * 1e3 << " /s), delete "
+                << removeMs << " ms (" << count / removeMs * 1e3 << " /s), stale handles resolving: " << stale << "\n";
+        }
+
+        // the previous layout is quadratic, it is only run on the smaller counts
+        const size_t vectorCounts[] = { 10000, 20000 };
+        for (size_t count : vectorCounts)
+        {
+            std::mt19937 random(5);
+            std::uniform_real_distribution<float> coordinate(-30.0f, 30.0f);
+            std::vector<Model> models;
+            std::vector<std::string> names;
+            std::vector<int> proxies;
+            SceneBVH bvh;
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+            {
+                glm::vec3 position(coordinate(random), coordinate(random), coordinate(random));
+                models.emplace_back();
+                models.back().position = position;
+                names.push_back("Object" + std::to_string(i));
+                proxies.push_back(bvh.createProxy(AABB(position, position), static_cast<int>(i)));
+            }
+            double addMs = ElapsedMs(start);
+
+            start = std::chrono::steady_clock::now();
+            while (!models.empty())
+            {
+                int id = static_cast<int>(random() % models.size());
+                bvh.destroyProxy(proxies[id]);
+                models.erase(models.begin() + id);
+                names.erase(names.begin() + id);
+                proxies.erase(proxies.begin() + id);
+                for (int i = id; i < static_cast<int>(models.size()); i++)
+                    bvh.setUserData(proxies[i], i);
+            }
+            double removeMs = ElapsedMs(start);
+
+            std::cout << "  vectors    " << count << " objects: add " << addMs << " ms (" << count / addMs * 1e3 << " /s), delete "
+                << removeMs << " ms (" << count / removeMs * 1e3 << " /s)\n";
+        }
+        std::cout << std::flush;
+        return failures ? 1 : 0;
+    }
+
+    // Naming N objects placed from the same menu entry: NameRegistry against the linear search
+    // GenerateUniqueName used to do, which retried every counter over every existing name.
+    inline int RunNames()
+    {
+        std::cout << "unique name benchmark (objects of one type)\n";
+        int failures = 0;
+
+        const size_t registryCounts[] = { 10000, 50000 };
+        for (size_t count : registryCounts)
+        {
+            NameRegistry registry;
+            std::vector<std::string> names;
+            names.reserve(count);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+            {
+                names.push_back(registry.unique("Chair"));
+                registry.insert(names.back());
+            }
+            double ms = ElapsedMs(start);
+
+            // after deleting every other object and loading the rest again the names must still be unique
+            std::unordered_set<std::string> live;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (i % 2 == 0)
+                    registry.release(names[i]);
+                else
+                    live.insert(names[i]);
+            }
+            for (size_t i = 0; i < count / 2; i++)
+            {
+                std::string name = registry.unique("Chair");
+                failures += !registry.insert(name) || !live.insert(name).second;
+            }
+            registry.clear();
+            for (size_t i = 1; i < count; i += 2)
+                failures += !registry.insert(names[i]);
+            for (size_t i = 0; i < count / 2; i++)
+            {
+                std::string name = registry.unique("Chair");
+                failures += !registry.insert(name);
+            }
+            failures += registry.size() != count;
+
+            std::cout << "  NameRegistry " << count << " objects: " << ms << " ms (" << ms * 1e6 / count << " ns per name)\n";
+        }
+
+        // the previous search is cubic (every counter from 0 is checked against every name), it only
+        // runs on a few thousand objects
+        const size_t linearCounts[] = { 500, 1000, 2000 };
+        for (size_t count : linearCounts)
+        {
+            std::vector<std::string> names;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++)
+            {
+                int cnt = 0;
+                std::string newName = "Chair";
+                while (std::find(names.begin(), names.end(), newName) != names.end())
+                {
+                    newName = "Chair" + std::to_string(cnt);
+                    cnt++;
+                }
+                names.push_back(newName);
+            }
+            double ms = ElapsedMs(start);
+            std::cout << "  linear search " << count << " objects: " << ms << " ms (" << ms * 1e6 / count << " ns per name)\n";
+        }
+        std::cout << std::flush;
+        return failures ? 1 : 0;
+    }
+
+    // CPU time of the outliner window per frame (ImGui without a renderer, the draw lists are built
+    // but not submitted), after an edit of the scene and while typing a query letter by letter.
+    inline int RunOutliner()
+    {
+        const char* types[] = { "Chair1", "Dresser", "Table", "Dresser2", "Desk", "Table2", "couch1", "couch2", "Chair2" };
+        std::vector<std::shared_ptr<Model>> assets;
+        for (const char* type : types)
+        {
+            assets.push_back(std::make_shared<Model>());
+            assets.back()->objectName = type;
+        }
+
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(1280.0f, 720.0f);
+        io.DeltaTime = 1.0f / 60.0f;
+        io.IniFilename = nullptr;
+        unsigned char* pixels;
+        int atlasWidth, atlasHeight;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &atlasWidth, &atlasHeight);
+
+        const size_t counts[] = { 10, 1000, 10000, 100000 };
+        const int frames = 200;
+        std::cout << "outliner benchmark (median of " << frames << " frames)\n";
+        for (size_t count : counts)
+        {
+            std::mt19937 random(3);
+            SceneStore scene;
+            for (size_t i = 0; i < count; i++)
+            {
+                const std::shared_ptr<Model>& asset = assets[random() % assets.size()];
+                scene.add(asset, asset->objectName, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+            }
+            Outliner outliner;
+            SceneHandle selected = scene.handleAt(count / 2);
+
+            std::vector<double> times;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                ImGui::NewFrame();
+                ImGui::SetNextWindowSize(ImVec2(300, 400));
+                ImGui::Begin("Outliner");
+                outliner.draw(scene, selected);
+                ImGui::End();
+                ImGui::Render();
+                times.push_back(ElapsedMs(start));
+            }
+            std::sort(times.begin(), times.end());
+
+            // an edit regroups the objects, the first query afterwards builds the search index
+            scene.remove(scene.handleAt(0));
+            auto start = std::chrono::steady_clock::now();
+            outliner.index.update(scene, "", false);
+            double editMs = ElapsedMs(start);
+            start = std::chrono::steady_clock::now();
+            outliner.index.update(scene, "c", false);
+            double indexMs = ElapsedMs(start);
+
+            const std::string query = "chair17";
+            double typingMs = 0.0;
+            for (size_t length = 2; length <= query.size(); length++)
+            {
+                start = std::chrono::steady_clock::now();
+                outliner.index.update(scene, query.substr(0, length), false);
+                typingMs = std::max(typingMs, ElapsedMs(start));
+            }
+            size_t found = outliner.index.matchCount();
+            start = std::chrono::steady_clock::now();
+            outliner.index.update(scene, "chair2", true);
+            double prefixMs = ElapsedMs(start);
+
+            std::cout << "  " << count << " objects: frame " << times[frames / 2] * 1e3 << " us, after an edit " << editMs
+                << " ms, first query " << indexMs << " ms, slowest keystroke after it " << typingMs << " ms (" << found << " matches for \"" << query
+                << "\"), prefix \"chair2\" " << prefixMs << " ms\n";
+        }
+        ImGui::DestroyContext();
+        std::cout << std::flush;
+        return 0;
+    }
+
+    // Frame pacing at 60 Hz with 2-8 ms of simulated work per frame: the busy check of the old main
+    // loop, a plain sleep until the deadline, and FramePacer's sleep then spin. Reports the frame
+    // interval percentiles and the CPU time spent per second.
+    inline int RunPacing()
+    {
+        const double period = 1.0 / 60.0;
+        const int frames = 300;
+        std::cout << "frame pacing benchmark (" << frames << " frames at 60 Hz, intervals in ms)\n";
+
+        auto run = [&](const char* name, int mode) {
+            std::mt19937 random(9);
+            std::uniform_real_distribution<double> workTime(0.002, 0.008);
+            FramePacer pacer(period);
+            pacer.setFineTimer(true);
+            FrameTimeStats intervals(frames);
+            double cpuStart = ProcessCpuSeconds();
+            double start = FramePacer::Now();
+            double lastFrame = -1.0;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                if (mode == 0)
+                {
+                    // the old loop: poll until a period has passed since the last frame
+                    while (lastFrame >= 0.0 && FramePacer::Now() - lastFrame < period) {
+                    }
+                }
+                else if (mode == 1)
+                {
+                    double sleep = pacer.deadline() - FramePacer::Now();
+                    if (sleep > 0.0)
+                        std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+                }
+                else
+                {
+                    pacer.wait();
+                }
+                pacer.frameStarted();
+                double now = FramePacer::Now();
+                if (lastFrame >= 0.0)
+                    intervals.add(now - lastFrame);
+                lastFrame = now;
+
+                double work = workTime(random);
+                while (FramePacer::Now() - now < work) {
+                }
+            }
+            double seconds = FramePacer::Now() - start;
+            double cpu = (ProcessCpuSeconds() - cpuStart) / seconds;
+            std::cout << "  " << std::left << std::setw(12) << name << std::right << " p50 " << intervals.percentile(0.5) * 1e3
+                << "  p99 " << intervals.percentile(0.99) * 1e3 << "  max " << intervals.max() * 1e3
+                << "  CPU " << cpu * 100.0 << "% of a core\n";
+        };
+        run("busy check", 0);
+        run("sleep", 1);
+        run("sleep + spin", 2);
+        std::cout << std::flush;
+        return 0;
+    }
+}
+
+#endif
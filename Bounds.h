@@ -0,0 +1,162 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// axis aligned bounding box, an empty box has min > max
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    AABB() = default;
+    AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    bool empty() const { return min.x > max.x; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    void expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    bool contains(const AABB& box) const
+    {
+        return glm::all(glm::lessThanEqual(min, box.min)) && glm::all(glm::greaterThanEqual(max, box.max));
+    }
+
+    bool overlaps(const AABB& box) const
+    {
+        return glm::all(glm::lessThanEqual(min, box.max)) && glm::all(glm::greaterThanEqual(max, box.min));
+    }
+
+    // half the surface area, the cost metric of the BVH
+    float area() const
+    {
+        glm::vec3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    // squared distance from a point to the box, 0 inside
+    float distanceSquared(const glm::vec3& point) const
+    {
+        glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    // bounds of the box after an affine transform (Arvo's method, no corner loop)
+    AABB transformed(const glm::mat4& m) const
+    {
+        if (empty())
+            return *this;
+        glm::vec3 center = glm::vec3(m * glm::vec4(this->center(), 1.0f));
+        glm::vec3 half = extents();
+        glm::vec3 radius(
+            std::abs(m[0][0]) * half.x + std::abs(m[1][0]) * half.y + std::abs(m[2][0]) * half.z,
+            std::abs(m[0][1]) * half.x + std::abs(m[1][1]) * half.y + std::abs(m[2][1]) * half.z,
+            std::abs(m[0][2]) * half.x + std::abs(m[1][2]) * half.y + std::abs(m[2][2]) * half.z);
+        return AABB(center - radius, center + radius);
+    }
+
+    // slab test, returns the entry distance along the ray in t or false when the ray misses within maxT.
+    // inverseDirection is 1 / direction, infinite components are fine.
+    bool intersectsRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxT, float& t) const
+    {
+        glm::vec3 t0 = (min - origin) * inverseDirection;
+        glm::vec3 t1 = (max - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+        t = enter;
+        return enter <= exit;
+    }
+};
+
+struct Plane {
+    glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+    float d = 0.0f;
+
+    float distance(const glm::vec3& point) const { return glm::dot(normal, point) + d; }
+};
+
+// The six clip planes of a projection matrix, normals pointing inside. Built from
+// projection * view the planes are in world space, from projection * view * model in object space.
+struct Frustum {
+    Plane planes[6];
+
+    static Frustum FromMatrix(const glm::mat4& m)
+    {
+        // rows of the column-major glm matrix
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        const glm::vec4 equations[6] = {
+            row3 + row0, row3 - row0,   // left, right
+            row3 + row1, row3 - row1,   // bottom, top
+            row3 + row2, row3 - row2    // near, far
+        };
+        Frustum frustum;
+        for (int i = 0; i < 6; i++)
+        {
+            float length = glm::length(glm::vec3(equations[i]));
+            frustum.planes[i].normal = glm::vec3(equations[i]) / length;
+            frustum.planes[i].d = equations[i].w / length;
+        }
+        return frustum;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const Plane& plane : planes)
+            if (plane.distance(center) < -radius)
+                return false;
+        return true;
+    }
+
+    // 0 outside, 1 intersecting, 2 completely inside
+    int classifyAABB(const AABB& box) const
+    {
+        glm::vec3 center = box.center();
+        glm::vec3 extents = box.extents();
+        int result = 2;
+        for (const Plane& plane : planes)
+        {
+            float radius = glm::dot(extents, glm::abs(plane.normal));
+            float distance = plane.distance(center);
+            if (distance < -radius)
+                return 0;
+            if (distance < radius)
+                result = 1;
+        }
+        return result;
+    }
+
+    bool intersectsAABB(const AABB& box) const
+    {
+        glm::vec3 center = box.center();
+        glm::vec3 extents = box.extents();
+        for (const Plane& plane : planes)
+        {
+            // projected radius of the box on the plane normal
+            float radius = glm::dot(extents, glm::abs(plane.normal));
+            if (plane.distance(center) < -radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
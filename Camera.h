@@ -23,15 +23,19 @@ class Camera
         int width;
         int height;
         float zoom = 45.0f;
-        float speed = 2.5f;
+        float speed = 6.0f;  // units per second, Shift moves 4 times faster
         float sensitivity = 20.0f;
 
         Camera(int width, int height,float zoom, glm::vec3 position);
 
         // Updates and exports the camera matrix to the Vertex Shader
         void updateMatrix(float FOVdeg, float nearPlane, float farPlane);
-        // Handles camera inputs
-        void Inputs(GLFWwindow* window);
+        // Moves the camera for deltaTime seconds with the held keys
+        void Move(GLFWwindow* window, float deltaTime);
+        // Rotates the camera while the left mouse button is held, once per frame
+        void Look(GLFWwindow* window);
+        // True while a key that moves the camera is held
+        bool MoveKeysHeld(GLFWwindow* window) const;
         void ProcessMouseScroll(float yoffset);
 
 };
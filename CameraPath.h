@@ -0,0 +1,122 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+#include <nlohmann/json.hpp>
+
+#include "Offscreen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct CameraKeyframe {
+    double time;  // seconds from the start of the path
+    CameraPose pose;
+};
+
+// A recorded camera flight: keyframes in time order, positions interpolated with a Catmull-Rom
+// spline through them and yaw/pitch linearly. Sampling only depends on the time, so a benchmark
+// that samples frame i at i / frames * duration sees the same views on every run.
+class CameraPath
+{
+public:
+    std::vector<CameraKeyframe> keyframes;
+
+    double duration() const { return keyframes.empty() ? 0.0 : keyframes.back().time; }
+
+    CameraPose sample(double time) const
+    {
+        if (keyframes.empty())
+            return CameraPose();
+        if (time <= keyframes.front().time || keyframes.size() == 1)
+            return keyframes.front().pose;
+        if (time >= keyframes.back().time)
+            return keyframes.back().pose;
+
+        size_t next = 1;
+        while (keyframes[next].time < time)
+            next++;
+        const CameraKeyframe& a = keyframes[next - 1];
+        const CameraKeyframe& b = keyframes[next];
+        float t = b.time > a.time ? static_cast<float>((time - a.time) / (b.time - a.time)) : 1.0f;
+        // the neighbours shape the tangents, the ends repeat their keyframe
+        const glm::vec3& before = keyframes[next >= 2 ? next - 2 : next - 1].pose.position;
+        const glm::vec3& after = keyframes[std::min(next + 1, keyframes.size() - 1)].pose.position;
+
+        CameraPose pose;
+        float t2 = t * t, t3 = t2 * t;
+        pose.position = 0.5f * (2.0f * a.pose.position + (b.pose.position - before) * t +
+            (2.0f * before - 5.0f * a.pose.position + 4.0f * b.pose.position - after) * t2 +
+            (3.0f * a.pose.position - before - 3.0f * b.pose.position + after) * t3);
+        pose.yaw = a.pose.yaw + (b.pose.yaw - a.pose.yaw) * t;
+        pose.pitch = a.pose.pitch + (b.pose.pitch - a.pose.pitch) * t;
+        return pose;
+    }
+
+    // {"keyframes": [{"time": 0.0, "position": [x, y, z], "yaw": 0.0, "pitch": 0.0}, ...]},
+    // yaw and pitch in degrees like CameraPose
+    static bool Load(const std::string& path, CameraPath& cameraPath, std::string& error)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        try
+        {
+            nlohmann::json json = nlohmann::json::parse(in);
+            CameraPath loaded;
+            for (const nlohmann::json& key : json.at("keyframes"))
+            {
+                CameraKeyframe keyframe;
+                keyframe.time = key.at("time").get<double>();
+                const nlohmann::json& position = key.at("position");
+                keyframe.pose.position = glm::vec3(position.at(0).get<float>(), position.at(1).get<float>(), position.at(2).get<float>());
+                keyframe.pose.yaw = key.value("yaw", 0.0f);
+                keyframe.pose.pitch = key.value("pitch", 0.0f);
+                if (!loaded.keyframes.empty() && keyframe.time < loaded.keyframes.back().time)
+                {
+                    error = "keyframes are not in time order";
+                    return false;
+                }
+                loaded.keyframes.push_back(keyframe);
+            }
+            if (loaded.keyframes.empty())
+            {
+                error = "no keyframes";
+                return false;
+            }
+            cameraPath = loaded;
+            return true;
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            error = e.what();
+            return false;
+        }
+    }
+
+    // one turn around center at the given radius and height, always looking at the center
+    static CameraPath Orbit(const glm::vec3& center, float radius, float height, double duration, int steps = 16)
+    {
+        CameraPath path;
+        for (int i = 0; i <= steps; i++)
+        {
+            float angle = 2.0f * 3.14159265f * i / steps;
+            CameraKeyframe keyframe;
+            keyframe.time = duration * i / steps;
+            keyframe.pose.position = center + glm::vec3(std::sin(angle) * radius, height, std::cos(angle) * radius);
+            // yaw turns right from -Z, facing the center from this side means turning by the angle
+            keyframe.pose.yaw = glm::degrees(-angle);
+            keyframe.pose.pitch = glm::degrees(std::atan2(-height, radius));
+            path.keyframes.push_back(keyframe);
+        }
+        return path;
+    }
+};
+
+#endif
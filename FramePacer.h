@@ -0,0 +1,167 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// The last frame times, for the p50/p99/max report.
+class FrameTimeStats
+{
+public:
+    explicit FrameTimeStats(size_t capacity = 1000) : capacity(capacity) {}
+
+    void add(double seconds)
+    {
+        if (samples.size() < capacity)
+            samples.push_back(static_cast<float>(seconds));
+        else
+            samples[next] = static_cast<float>(seconds);
+        next = (next + 1) % capacity;
+    }
+
+    void clear()
+    {
+        samples.clear();
+        next = 0;
+    }
+
+    size_t count() const { return samples.size(); }
+
+    // p in [0, 1], 0 without samples
+    double percentile(double p) const
+    {
+        if (samples.empty())
+            return 0.0;
+        std::vector<float> sorted = samples;
+        size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    double max() const { return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end()); }
+
+    // samples in a ring, oldest at offset(), the way ImGui::PlotLines takes them
+    const std::vector<float>& values() const { return samples; }
+    size_t offset() const { return samples.size() < capacity ? 0 : next; }
+
+private:
+    size_t capacity;
+    size_t next = 0;
+    std::vector<float> samples;
+};
+
+// Frame deadlines with low jitter. Sleeping alone overshoots by the timer granularity (1 ms at best,
+// 15.6 ms on Windows without timeBeginPeriod), so the caller sleeps until spinMargin before the
+// deadline and spin() covers the rest. Deadlines advance by exactly one period so the rate doesn't
+// drift, a frame that is more than a period late starts a new schedule instead of catching up.
+class FramePacer
+{
+public:
+    double period;
+#ifdef _WIN32
+    double spinMargin = 0.002;
+#else
+    // nanosleep wakes within tens of microseconds
+    double spinMargin = 0.0005;
+#endif
+
+    explicit FramePacer(double period) : period(period) {}
+
+    ~FramePacer()
+    {
+        setFineTimer(false);
+    }
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // seconds on a monotonic clock
+    static double Now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    double deadline() const { return next; }
+
+    // 1 ms sleeps on Windows while frames are paced, the system timer costs power so it is released
+    // while idle
+    void setFineTimer(bool on)
+    {
+        if (on == fineTimer)
+            return;
+        fineTimer = on;
+#ifdef _WIN32
+        if (on)
+            timeBeginPeriod(1);
+        else
+            timeEndPeriod(1);
+#endif
+    }
+
+    // how long the caller may sleep before it has to spin, <= 0 when it is time to spin
+    double sleepTime() const { return next - spinMargin - Now(); }
+
+    void spin() const
+    {
+        while (Now() < next)
+            std::this_thread::yield();
+    }
+
+    // waits for the deadline with a plain sleep for the coarse part
+    void wait() const
+    {
+        double sleep = sleepTime();
+        if (sleep > 0.0)
+            std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+        spin();
+    }
+
+    // call when a frame starts, schedules the next one
+    void frameStarted()
+    {
+        double now = Now();
+        next = now - next > period ? now + period : next + period;
+    }
+
+private:
+    double next = 0.0;
+    bool fineTimer = false;
+};
+
+// Simulation steps of a fixed length for frames of any length, so the result doesn't depend on the
+// frame rate. A long frame is clamped rather than simulated in one burst.
+class FixedTimestep
+{
+public:
+    double step;
+    double maxFrameTime = 0.25;
+
+    explicit FixedTimestep(double step) : step(step) {}
+
+    // number of steps to run for a frame that took frameTime seconds
+    int advance(double frameTime)
+    {
+        accumulator += std::min(frameTime, maxFrameTime);
+        int steps = static_cast<int>(accumulator / step);
+        accumulator -= steps * step;
+        return steps;
+    }
+
+    void reset() { accumulator = 0.0; }
+
+private:
+    double accumulator = 0.0;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <GLFW/glfw3.h>
+
+#include "FramePacer.h"
+#include "ProcessStats.h"
+
+#include <atomic>
+
+// Decides when the main loop draws. On demand (the default) the loop sleeps in glfwWaitEvents until
+// something needs a new frame: an input or window event, a camera that is still moving, or
+// invalidate() from any thread (e.g. a load finishing on a worker). Continuous mode draws at the
+// target rate whether anything changed or not, for benchmarks and profiling. Frames that follow each
+// other are paced by FramePacer and their intervals end up in frameTimes.
+class FrameScheduler
+{
+public:
+    // ImGui needs a few frames after an event to settle hover and popup state
+    static const int FramesPerEvent = 3;
+
+    bool continuous;
+    FramePacer pacer;
+    // start to start intervals of frames drawn back to back, idle waits are left out
+    FrameTimeStats frameTimes;
+    // time from the start of a frame until its buffers were swapped
+    FrameTimeStats workTimes;
+
+    FrameScheduler(double targetFrameTime, bool continuous)
+        : continuous(continuous), pacer(targetFrameTime) {
+    }
+
+    // installs the callbacks that request redraws, call it before ImGui_ImplGlfw_InitForOpenGL so
+    // ImGui chains them instead of replacing them
+    void attach(GLFWwindow* window)
+    {
+        this->window = window;
+        glfwSetWindowUserPointer(window, this);
+        glfwSetCursorPosCallback(window, [](GLFWwindow* w, double, double) { From(w).invalidate(); });
+        glfwSetMouseButtonCallback(window, [](GLFWwindow* w, int, int, int) { From(w).invalidate(); });
+        glfwSetScrollCallback(window, [](GLFWwindow* w, double, double) { From(w).invalidate(); });
+        glfwSetKeyCallback(window, [](GLFWwindow* w, int, int, int, int) { From(w).invalidate(); });
+        glfwSetCharCallback(window, [](GLFWwindow* w, unsigned int) { From(w).invalidate(); });
+        glfwSetCursorEnterCallback(window, [](GLFWwindow* w, int) { From(w).invalidate(); });
+        glfwSetWindowFocusCallback(window, [](GLFWwindow* w, int) { From(w).invalidate(); });
+        glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int, int) { From(w).invalidate(); });
+        glfwSetWindowRefreshCallback(window, [](GLFWwindow* w) { From(w).invalidate(); });
+        glfwSetWindowCloseCallback(window, [](GLFWwindow* w) { From(w).invalidate(); });
+    }
+
+    // thread safe, the next frames are drawn even when no event arrives
+    void invalidate(int frames = FramesPerEvent)
+    {
+        int current = pending.load();
+        while (current < frames && !pending.compare_exchange_weak(current, frames)) {
+        }
+        glfwPostEmptyEvent();
+    }
+
+    // processes events until the next frame is due, then returns
+    void waitForFrame()
+    {
+        while (!glfwWindowShouldClose(window))
+        {
+            if (continuous || pending.load() > 0)
+            {
+                // events still wake the sleep, the last stretch before the deadline is spun
+                pacer.setFineTimer(true);
+                double sleep = pacer.sleepTime();
+                if (sleep > 0.0)
+                {
+                    glfwWaitEventsTimeout(sleep);
+                    continue;
+                }
+                pacer.spin();
+                glfwPollEvents();
+                break;
+            }
+            pacer.setFineTimer(false);
+            glfwWaitEvents();
+        }
+        pacer.frameStarted();
+        double now = FramePacer::Now();
+        if (backToBack)
+            frameTimes.add(now - frameStart);
+        frameStart = now;
+    }
+
+    // call after the buffers were swapped
+    void frameDrawn()
+    {
+        int current = pending.load();
+        while (current > 0 && !pending.compare_exchange_weak(current, current - 1)) {
+        }
+        workTimes.add(FramePacer::Now() - frameStart);
+        backToBack = continuous || current > 1;
+
+        framesInSample++;
+        double now = FramePacer::Now();
+        if (sampleStart < 0.0)
+        {
+            sampleStart = now;
+            sampleCpu = ProcessCpuSeconds();
+            framesInSample = 0;
+        }
+        else if (now - sampleStart >= 1.0)
+        {
+            // an idle stretch ends with the first frame after it, so it is part of this sample
+            double cpu = ProcessCpuSeconds();
+            framesPerSecond = framesInSample / (now - sampleStart);
+            cpuUsage = (cpu - sampleCpu) / (now - sampleStart);
+            sampleStart = now;
+            sampleCpu = cpu;
+            framesInSample = 0;
+        }
+    }
+
+    // averages over the last sample of at least a second
+    double fps() const { return framesPerSecond; }
+    // process CPU time per wall clock second, 1.0 is one busy core
+    double cpu() const { return cpuUsage; }
+
+private:
+    GLFWwindow* window = nullptr;
+    std::atomic<int> pending{ FramesPerEvent };
+    double frameStart = 0.0;
+    bool backToBack = false;
+
+    double sampleStart = -1.0;
+    double sampleCpu = 0.0;
+    int framesInSample = 0;
+    double framesPerSecond = 0.0;
+    double cpuUsage = 0.0;
+
+    static FrameScheduler& From(GLFWwindow* window)
+    {
+        return *static_cast<FrameScheduler*>(glfwGetWindowUserPointer(window));
+    }
+};
+
+#endif
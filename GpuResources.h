@@ -0,0 +1,223 @@
+#ifndef GPU_RESOURCES_H
+#define GPU_RESOURCES_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+
+enum class GpuResourceKind { Buffer, VertexArray, Texture, Program, Query, Framebuffer, Renderbuffer };
+
+inline const char* GpuResourceKindName(GpuResourceKind kind)
+{
+    switch (kind)
+    {
+    case GpuResourceKind::Buffer: return "buffer";
+    case GpuResourceKind::VertexArray: return "vertex array";
+    case GpuResourceKind::Texture: return "texture";
+    case GpuResourceKind::Program: return "program";
+    case GpuResourceKind::Query: return "query";
+    case GpuResourceKind::Framebuffer: return "framebuffer";
+    case GpuResourceKind::Renderbuffer: return "renderbuffer";
+    }
+    return "";
+}
+
+// Book-keeping of every live GL object created through a GpuHandle: who owns it and roughly how
+// many bytes of video memory it holds. GL objects are only created on the GL thread so it isn't locked.
+class GpuResourceRegistry
+{
+public:
+    struct OwnerStats {
+        size_t objects = 0;
+        size_t bytes = 0;
+    };
+
+    static GpuResourceRegistry& Get()
+    {
+        static GpuResourceRegistry registry;
+        return registry;
+    }
+
+    void add(GpuResourceKind kind, GLuint id, const std::string& owner)
+    {
+        Entry& entry = entries[Key(kind, id)];
+        entry.owner = owner;
+        total -= entry.bytes;
+        entry.bytes = 0;
+    }
+
+    void setBytes(GpuResourceKind kind, GLuint id, size_t bytes)
+    {
+        auto it = entries.find(Key(kind, id));
+        if (it == entries.end())
+            return;
+        total += bytes - it->second.bytes;
+        it->second.bytes = bytes;
+        peak = std::max(peak, total);
+    }
+
+    void remove(GpuResourceKind kind, GLuint id)
+    {
+        auto it = entries.find(Key(kind, id));
+        if (it == entries.end())
+            return;
+        total -= it->second.bytes;
+        entries.erase(it);
+    }
+
+    size_t liveObjects() const { return entries.size(); }
+    size_t liveBytes() const { return total; }
+
+    // high-water mark of liveBytes since the start or the last resetPeak
+    size_t peakBytes() const { return peak; }
+    void resetPeak() { peak = total; }
+
+    // estimate of a single object, 0 for one that isn't alive
+    size_t bytes(GpuResourceKind kind, GLuint id) const
+    {
+        auto it = entries.find(Key(kind, id));
+        return it != entries.end() ? it->second.bytes : 0;
+    }
+
+    std::map<std::string, OwnerStats> byOwner() const
+    {
+        std::map<std::string, OwnerStats> owners;
+        for (const auto& entry : entries)
+        {
+            OwnerStats& stats = owners[entry.second.owner];
+            stats.objects++;
+            stats.bytes += entry.second.bytes;
+        }
+        return owners;
+    }
+
+    // lists every object that is still alive, meant to run at shutdown once the scene has been released
+    void reportLeaks(std::ostream& os) const
+    {
+        if (entries.empty())
+        {
+            os << "GPU resources: no leaks" << std::endl;
+            return;
+        }
+        os << "GPU resources: " << entries.size() << " objects (" << liveBytes() << " bytes) still alive" << std::endl;
+        for (const auto& entry : entries)
+        {
+            os << "  " << GpuResourceKindName(static_cast<GpuResourceKind>(entry.first.first)) << " " << entry.first.second
+                << " owner: " << entry.second.owner << ", " << entry.second.bytes << " bytes" << std::endl;
+        }
+    }
+
+private:
+    struct Entry {
+        std::string owner;
+        size_t bytes = 0;
+    };
+    typedef std::pair<int, GLuint> Key_t;
+    std::map<Key_t, Entry> entries;
+    size_t total = 0;
+    size_t peak = 0;
+
+    static Key_t Key(GpuResourceKind kind, GLuint id) { return Key_t(static_cast<int>(kind), id); }
+};
+
+// glGen*/glDelete* for every kind of handle
+template <GpuResourceKind Kind> struct GpuResourceTraits;
+
+template <> struct GpuResourceTraits<GpuResourceKind::Buffer> {
+    static GLuint Create() { GLuint id = 0; glGenBuffers(1, &id); return id; }
+    static void Destroy(GLuint id) { glDeleteBuffers(1, &id); }
+};
+template <> struct GpuResourceTraits<GpuResourceKind::VertexArray> {
+    static GLuint Create() { GLuint id = 0; glGenVertexArrays(1, &id); return id; }
+    static void Destroy(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+template <> struct GpuResourceTraits<GpuResourceKind::Texture> {
+    static GLuint Create() { GLuint id = 0; glGenTextures(1, &id); return id; }
+    static void Destroy(GLuint id) { glDeleteTextures(1, &id); }
+};
+template <> struct GpuResourceTraits<GpuResourceKind::Program> {
+    static GLuint Create() { return glCreateProgram(); }
+    static void Destroy(GLuint id) { glDeleteProgram(id); }
+};
+template <> struct GpuResourceTraits<GpuResourceKind::Query> {
+    static GLuint Create() { GLuint id = 0; glGenQueries(1, &id); return id; }
+    static void Destroy(GLuint id) { glDeleteQueries(1, &id); }
+};
+template <> struct GpuResourceTraits<GpuResourceKind::Framebuffer> {
+    static GLuint Create() { GLuint id = 0; glGenFramebuffers(1, &id); return id; }
+    static void Destroy(GLuint id) { glDeleteFramebuffers(1, &id); }
+};
+template <> struct GpuResourceTraits<GpuResourceKind::Renderbuffer> {
+    static GLuint Create() { GLuint id = 0; glGenRenderbuffers(1, &id); return id; }
+    static void Destroy(GLuint id) { glDeleteRenderbuffers(1, &id); }
+};
+
+// Move-only owner of a single GL object, deleted when the handle goes away.
+// A default constructed handle holds 0 and never calls into GL, so handles may outlive the context
+// as long as they have been reset before it is destroyed.
+template <GpuResourceKind Kind>
+class GpuHandle
+{
+public:
+    GpuHandle() : id(0) {}
+    ~GpuHandle() { reset(); }
+
+    GpuHandle(const GpuHandle&) = delete;
+    GpuHandle& operator=(const GpuHandle&) = delete;
+
+    GpuHandle(GpuHandle&& other) noexcept : id(other.id) { other.id = 0; }
+    GpuHandle& operator=(GpuHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    static GpuHandle Create(const std::string& owner)
+    {
+        GpuHandle handle;
+        handle.id = GpuResourceTraits<Kind>::Create();
+        GpuResourceRegistry::Get().add(Kind, handle.id, owner);
+        return handle;
+    }
+
+    GLuint get() const { return id; }
+    explicit operator bool() const { return id != 0; }
+
+    // estimated video memory held by the object, shown in the resource report
+    void setBytes(size_t bytes) const
+    {
+        GpuResourceRegistry::Get().setBytes(Kind, id, bytes);
+    }
+
+    void reset()
+    {
+        if (id == 0)
+            return;
+        GpuResourceRegistry::Get().remove(Kind, id);
+        GpuResourceTraits<Kind>::Destroy(id);
+        id = 0;
+    }
+
+private:
+    GLuint id;
+};
+
+typedef GpuHandle<GpuResourceKind::Buffer> GLBuffer;
+typedef GpuHandle<GpuResourceKind::VertexArray> GLVertexArray;
+typedef GpuHandle<GpuResourceKind::Texture> GLTexture;
+typedef GpuHandle<GpuResourceKind::Program> GLProgram;
+typedef GpuHandle<GpuResourceKind::Query> GLQuery;
+typedef GpuHandle<GpuResourceKind::Framebuffer> GLFramebuffer;
+typedef GpuHandle<GpuResourceKind::Renderbuffer> GLRenderbuffer;
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef KTX2_H
+#define KTX2_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Reader and writer for the KTX2 container (khronos.org/ktx), limited to what the texture cache
+// stores: one 2D image with its mip chain, no supercompression, no array layers or cube faces.
+namespace Ktx2 {
+
+    const unsigned char Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Image {
+        uint32_t vkFormat = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint32_t> dfd;  // data format descriptor, without the total size in front
+        std::vector<std::pair<std::string, std::string>> keyValues;
+        std::vector<std::vector<unsigned char>> levels;  // level 0 is the full size image
+
+        std::string value(const std::string& key) const
+        {
+            for (const auto& keyValue : keyValues)
+                if (keyValue.first == key)
+                    return keyValue.second;
+            return "";
+        }
+    };
+
+    // the basic descriptor of a block compressed format: 4x4 texels in blockBytes, with one
+    // sample per (channel, bit range)
+    struct Sample {
+        uint32_t channel;
+        uint32_t bitOffset;
+        uint32_t bitLength;
+    };
+
+    inline std::vector<uint32_t> BlockDescriptor(uint32_t colorModel, uint32_t blockBytes, const std::vector<Sample>& samples)
+    {
+        const uint32_t primariesBT709 = 1;
+        const uint32_t transferLinear = 1;
+        std::vector<uint32_t> dfd;
+        dfd.push_back(0);  // vendor 0 (Khronos), descriptor type 0 (basic)
+        dfd.push_back(2 | static_cast<uint32_t>(24 + 16 * samples.size()) << 16);  // version 2, block size
+        dfd.push_back(colorModel | primariesBT709 << 8 | transferLinear << 16);
+        dfd.push_back(3 | 3 << 8);  // texel block dimensions minus one
+        dfd.push_back(blockBytes);
+        dfd.push_back(0);
+        for (const Sample& sample : samples)
+        {
+            dfd.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+            dfd.push_back(0);
+            dfd.push_back(0);
+            dfd.push_back(0xFFFFFFFFu);
+        }
+        return dfd;
+    }
+
+    inline void Put32(std::vector<unsigned char>& out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    inline void Put64(std::vector<unsigned char>& out, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    inline uint64_t Get(const std::vector<unsigned char>& in, size_t offset, int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = bytes - 1; i >= 0; i--)
+            value = value << 8 | in[offset + i];
+        return value;
+    }
+
+    inline void Pad(std::vector<unsigned char>& out, size_t alignment)
+    {
+        while (out.size() % alignment)
+            out.push_back(0);
+    }
+
+    // levels are aligned to the block size, blockBytes must be 8 or 16
+    inline std::vector<unsigned char> Serialize(const Image& image, uint32_t blockBytes)
+    {
+        uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+        std::vector<unsigned char> out(Identifier, Identifier + sizeof(Identifier));
+        Put32(out, image.vkFormat);
+        Put32(out, 1);  // typeSize of block compressed formats
+        Put32(out, image.width);
+        Put32(out, image.height);
+        Put32(out, 0);  // depth
+        Put32(out, 0);  // layers
+        Put32(out, 1);  // faces
+        Put32(out, levelCount);
+        Put32(out, 0);  // supercompression
+
+        // the key/value data, sorted by key and each entry padded to 4 bytes
+        std::vector<std::pair<std::string, std::string>> keyValues = image.keyValues;
+        std::sort(keyValues.begin(), keyValues.end());
+        std::vector<unsigned char> kvd;
+        for (const auto& keyValue : keyValues)
+        {
+            Put32(kvd, static_cast<uint32_t>(keyValue.first.size() + keyValue.second.size() + 2));
+            kvd.insert(kvd.end(), keyValue.first.begin(), keyValue.first.end());
+            kvd.push_back(0);
+            kvd.insert(kvd.end(), keyValue.second.begin(), keyValue.second.end());
+            kvd.push_back(0);
+            Pad(kvd, 4);
+        }
+
+        // the index (32 bytes) and the level index come first
+        uint32_t dfdOffset = static_cast<uint32_t>(out.size() + 32 + 24 * levelCount);
+        uint32_t dfdLength = static_cast<uint32_t>(4 + 4 * image.dfd.size());
+        uint32_t kvdOffset = dfdOffset + dfdLength;
+        Put32(out, dfdOffset);
+        Put32(out, dfdLength);
+        Put32(out, kvd.empty() ? 0 : kvdOffset);
+        Put32(out, static_cast<uint32_t>(kvd.size()));
+        Put64(out, 0);  // no supercompression global data
+        Put64(out, 0);
+
+        // level data follows the kvd, smallest level first as the format asks
+        std::vector<uint64_t> offsets(levelCount);
+        uint64_t offset = kvdOffset + kvd.size();
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            offset = (offset + blockBytes - 1) / blockBytes * blockBytes;
+            offsets[level] = offset;
+            offset += image.levels[level].size();
+        }
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            Put64(out, offsets[level]);
+            Put64(out, image.levels[level].size());
+            Put64(out, image.levels[level].size());
+        }
+
+        Put32(out, dfdLength);
+        for (uint32_t word : image.dfd)
+            Put32(out, word);
+        out.insert(out.end(), kvd.begin(), kvd.end());
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            out.resize(static_cast<size_t>(offsets[level]), 0);
+            out.insert(out.end(), image.levels[level].begin(), image.levels[level].end());
+        }
+        return out;
+    }
+
+    inline bool Write(const std::string& path, const Image& image, uint32_t blockBytes)
+    {
+        std::vector<unsigned char> bytes = Serialize(image, blockBytes);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return static_cast<bool>(out);
+    }
+
+    // false on anything that isn't a 2D, single layer, uncompressed-index file
+    inline bool Parse(const std::vector<unsigned char>& in, Image& image)
+    {
+        if (in.size() < 80 || std::memcmp(in.data(), Identifier, sizeof(Identifier)) != 0)
+            return false;
+        image = Image();
+        image.vkFormat = static_cast<uint32_t>(Get(in, 12, 4));
+        image.width = static_cast<uint32_t>(Get(in, 20, 4));
+        image.height = static_cast<uint32_t>(Get(in, 24, 4));
+        uint32_t depth = static_cast<uint32_t>(Get(in, 28, 4));
+        uint32_t layers = static_cast<uint32_t>(Get(in, 32, 4));
+        uint32_t faces = static_cast<uint32_t>(Get(in, 36, 4));
+        uint32_t levelCount = std::max<uint32_t>(1, static_cast<uint32_t>(Get(in, 40, 4)));
+        uint32_t supercompression = static_cast<uint32_t>(Get(in, 44, 4));
+        if (depth != 0 || layers > 1 || faces != 1 || supercompression != 0 || in.size() < 80 + 24 * static_cast<size_t>(levelCount))
+            return false;
+
+        uint64_t dfdOffset = Get(in, 48, 4), dfdLength = Get(in, 52, 4);
+        uint64_t kvdOffset = Get(in, 56, 4), kvdLength = Get(in, 60, 4);
+        if (dfdOffset + dfdLength > in.size() || kvdOffset + kvdLength > in.size())
+            return false;
+        for (uint64_t word = 1; word < dfdLength / 4; word++)
+            image.dfd.push_back(static_cast<uint32_t>(Get(in, static_cast<size_t>(dfdOffset + 4 * word), 4)));
+        for (uint64_t at = kvdOffset; at + 4 <= kvdOffset + kvdLength;)
+        {
+            uint64_t length = Get(in, static_cast<size_t>(at), 4);
+            if (at + 4 + length > kvdOffset + kvdLength)
+                return false;
+            std::string entry(reinterpret_cast<const char*>(&in[static_cast<size_t>(at + 4)]), static_cast<size_t>(length));
+            size_t separator = entry.find('\0');
+            if (separator != std::string::npos)
+            {
+                std::string value = entry.substr(separator + 1);
+                if (!value.empty() && value.back() == '\0')
+                    value.pop_back();
+                image.keyValues.push_back(std::make_pair(entry.substr(0, separator), value));
+            }
+            at += 4 + (length + 3) / 4 * 4;
+        }
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            uint64_t offset = Get(in, 80 + 24 * level, 8);
+            uint64_t length = Get(in, 80 + 24 * level + 8, 8);
+            if (offset + length > in.size())
+                return false;
+            image.levels.emplace_back(in.begin() + static_cast<size_t>(offset), in.begin() + static_cast<size_t>(offset + length));
+        }
+        return true;
+    }
+
+    inline bool Read(const std::string& path, Image& image, size_t* fileBytes = nullptr)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+        if (!file)
+            return false;
+        if (fileBytes)
+            *fileBytes = bytes.size();
+        return Parse(bytes, image);
+    }
+}
+
+#endif
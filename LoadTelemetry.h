@@ -0,0 +1,116 @@
+#ifndef LOAD_TELEMETRY_H
+#define LOAD_TELEMETRY_H
+
+#include "Trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Where the time of one asset load went. Stages that run on the thread pool (conversion, texture
+// reads and decodes) are summed over the jobs, so they can add up to more than the wall time.
+// GL stages are the CPU time of the calls, the driver may still be copying when they return.
+struct AssetLoadRecord {
+    std::string path;
+    std::string source;  // "assimp", "asset cache", "texture" or "texture stream"
+    double totalMs = 0.0;  // wall time of the whole load
+    double readMs = 0.0;  // model or baked file I/O
+    double parseMs = 0.0;  // assimp import without the postprocess steps
+    double flipUVsMs = 0.0;
+    double triangulateMs = 0.0;
+    double smoothNormalsMs = 0.0;
+    double tangentsMs = 0.0;
+    double convertMs = 0.0;  // aiMesh to Vertex and index buffers
+    double textureReadMs = 0.0;
+    double decodeMs = 0.0;
+    double textureUploadMs = 0.0;
+    double mipMs = 0.0;
+    double meshUploadMs = 0.0;
+    double bakeMs = 0.0;  // writing the asset cache
+    size_t bytesRead = 0;  // model or baked file plus texture files
+    size_t meshes = 0;
+    size_t vertices = 0;
+    size_t triangles = 0;
+    size_t textures = 0;  // decoded by this load, textures already in the cache aren't counted
+    size_t textureBytes = 0;  // decoded pixels
+    std::string textureSizes;  // "WxHxC" per decoded texture
+
+    void addTexture(int width, int height, int components)
+    {
+        textures++;
+        textureBytes += static_cast<size_t>(width) * height * components;
+        char size[48];
+        snprintf(size, sizeof(size), "%s%dx%dx%d", textureSizes.empty() ? "" : " ", width, height, components);
+        textureSizes += size;
+    }
+};
+
+// Every load of the session, newest last. Loads report from the GL thread, the lock is only there
+// so a report can be written from anywhere.
+class LoadTelemetry
+{
+public:
+    static LoadTelemetry& Get()
+    {
+        static LoadTelemetry telemetry;
+        return telemetry;
+    }
+
+    void add(const AssetLoadRecord& record)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.push_back(record);
+    }
+
+    std::vector<AssetLoadRecord> records() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return loads;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loads.clear();
+    }
+
+    // one row per load, times in ms. Returns the number of rows or -1 if the file can't be written
+    long writeCsv(const std::string& path) const
+    {
+        std::vector<AssetLoadRecord> rows = records();
+        std::ofstream out(path);
+        if (!out)
+            return -1;
+        out << "path,source,total_ms,read_ms,parse_ms,flip_uvs_ms,triangulate_ms,smooth_normals_ms,tangents_ms,convert_ms,"
+            "texture_read_ms,decode_ms,texture_upload_ms,mip_ms,mesh_upload_ms,bake_ms,bytes_read,meshes,vertices,triangles,"
+            "textures,texture_bytes,texture_sizes\n";
+        char line[512];
+        for (const AssetLoadRecord& row : rows)
+        {
+            snprintf(line, sizeof(line), ",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%zu,%zu,%zu,%zu,%zu,%zu,",
+                row.totalMs, row.readMs, row.parseMs, row.flipUVsMs, row.triangulateMs, row.smoothNormalsMs, row.tangentsMs, row.convertMs,
+                row.textureReadMs, row.decodeMs, row.textureUploadMs, row.mipMs, row.meshUploadMs, row.bakeMs,
+                row.bytesRead, row.meshes, row.vertices, row.triangles, row.textures, row.textureBytes);
+            // paths may contain commas, the numbers don't
+            out << Quote(row.path) << "," << row.source << line << row.textureSizes << "\n";
+        }
+        return out ? static_cast<long>(rows.size()) : -1;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<AssetLoadRecord> loads;
+
+    static std::string Quote(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+            quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+        return quoted + "\"";
+    }
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Heap tracking. Define MEMORY_TRACKING_ENABLED to 0 to keep the global operator new of the C++
+// library and compile the MEMORY_SCOPE macros out.
+#ifndef MEMORY_TRACKING_ENABLED
+#define MEMORY_TRACKING_ENABLED 1
+#endif
+
+// the subsystem a heap block is charged to
+enum class MemoryTag : unsigned char { Untagged, Import, Geometry, Textures, Acceleration, Scene, UI, Count };
+
+inline const char* MemoryTagName(MemoryTag tag)
+{
+    switch (tag)
+    {
+    case MemoryTag::Untagged: return "untagged";
+    case MemoryTag::Import: return "import (app side)";
+    case MemoryTag::Geometry: return "geometry";
+    case MemoryTag::Textures: return "textures";
+    case MemoryTag::Acceleration: return "acceleration";
+    case MemoryTag::Scene: return "scene";
+    case MemoryTag::UI: return "ui";
+    case MemoryTag::Count: break;
+    }
+    return "";
+}
+
+// Live heap bytes per subsystem with their high-water marks. main.cpp replaces the global operator
+// new and delete with Allocate and Free, which keep the size and the tag of the allocating thread's
+// innermost MemoryScope in a header in front of every block, so a block is credited back to the tag
+// it was charged to whichever thread frees it. Plain malloc (stb_image, the GL driver, DLLs with
+// their own heap) isn't seen, the gap to the resident size is roughly that. assimp is linked as a
+// DLL, so Import only holds what this module allocates during an import, not assimp's own memory.
+class MemoryTracker
+{
+public:
+    static const int TagCount = static_cast<int>(MemoryTag::Count);
+
+    struct TagStats {
+        size_t bytes = 0;
+        size_t peakBytes = 0;
+        size_t blocks = 0;  // live
+        size_t allocations = 0;  // since the start
+    };
+
+    static MemoryTracker& Get()
+    {
+        // only zero-initialized atomics, so it is ready before the first operator new of the program
+        static MemoryTracker tracker;
+        return tracker;
+    }
+
+    static MemoryTag& CurrentTag()
+    {
+        thread_local MemoryTag tag = MemoryTag::Untagged;
+        return tag;
+    }
+
+    // nullptr when malloc fails
+    static void* Allocate(size_t size)
+    {
+        void* block = std::malloc(size + HeaderSize);
+        if (!block)
+            return nullptr;
+        Header* header = static_cast<Header*>(block);
+        header->size = size;
+        header->tag = CurrentTag();
+        Get().charge(header->tag, size);
+        return static_cast<char*>(block) + HeaderSize;
+    }
+
+    static void Free(void* memory)
+    {
+        if (!memory)
+            return;
+        Header* header = reinterpret_cast<Header*>(static_cast<char*>(memory) - HeaderSize);
+        Get().credit(header->tag, header->size);
+        std::free(header);
+    }
+
+    TagStats stats(MemoryTag tag) const
+    {
+        int i = static_cast<int>(tag);
+        TagStats stats;
+        stats.bytes = bytes[i].load(std::memory_order_relaxed);
+        stats.peakBytes = peakBytes[i].load(std::memory_order_relaxed);
+        stats.blocks = blocks[i].load(std::memory_order_relaxed);
+        stats.allocations = allocations[i].load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    size_t totalBytes() const { return total.load(std::memory_order_relaxed); }
+    size_t totalPeakBytes() const { return totalPeak.load(std::memory_order_relaxed); }
+
+    // starts the high-water marks over from the current sizes
+    void resetPeaks()
+    {
+        for (int i = 0; i < TagCount; i++)
+            peakBytes[i].store(bytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        totalPeak.store(total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+private:
+    struct Header {
+        size_t size;
+        MemoryTag tag;
+    };
+    // keeps the alignment malloc gives to the block after the header
+    static const size_t HeaderSize = 16;
+    static_assert(sizeof(Header) <= HeaderSize && alignof(std::max_align_t) <= HeaderSize, "the header breaks the alignment of new");
+
+    std::atomic<size_t> bytes[TagCount];
+    std::atomic<size_t> peakBytes[TagCount];
+    std::atomic<size_t> blocks[TagCount];
+    std::atomic<size_t> allocations[TagCount];
+    std::atomic<size_t> total;
+    std::atomic<size_t> totalPeak;
+
+    static void RaisePeak(std::atomic<size_t>& peak, size_t value)
+    {
+        size_t seen = peak.load(std::memory_order_relaxed);
+        while (seen < value && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+            ;
+    }
+
+    void charge(MemoryTag tag, size_t size)
+    {
+        int i = static_cast<int>(tag);
+        RaisePeak(peakBytes[i], bytes[i].fetch_add(size, std::memory_order_relaxed) + size);
+        RaisePeak(totalPeak, total.fetch_add(size, std::memory_order_relaxed) + size);
+        blocks[i].fetch_add(1, std::memory_order_relaxed);
+        allocations[i].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void credit(MemoryTag tag, size_t size)
+    {
+        int i = static_cast<int>(tag);
+        bytes[i].fetch_sub(size, std::memory_order_relaxed);
+        total.fetch_sub(size, std::memory_order_relaxed);
+        blocks[i].fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+// charges the heap blocks allocated by this thread until the end of the scope to tag
+class MemoryScope
+{
+public:
+    explicit MemoryScope(MemoryTag tag) : previous(MemoryTracker::CurrentTag()) { MemoryTracker::CurrentTag() = tag; }
+    ~MemoryScope() { MemoryTracker::CurrentTag() = previous; }
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryTag previous;
+};
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+
+#if MEMORY_TRACKING_ENABLED
+#define MEMORY_SCOPE(tag) MemoryScope MEMORY_CONCAT(memoryScope, __LINE__)(MemoryTag::tag)
+#else
+#define MEMORY_SCOPE(tag) ((void)0)
+#endif
+
+#endif
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "GpuResources.h"
+#include "Meshlet.h"
 #include "Shader.h"
 
 #include <string>
@@ -32,23 +34,47 @@ struct Texture {
     std::string path;
 };
 
+// what happens to the CPU copy of the geometry once it has been uploaded
+enum class Residency {
+    GpuOnly,      // freed right after the upload
+    CpuRetained,  // kept for picking and collision
+    OnDemand      // freed, reloaded from the baked asset file when needed
+};
+
+inline const char* ResidencyName(Residency residency)
+{
+    switch (residency)
+    {
+    case Residency::GpuOnly: return "GPU only";
+    case Residency::CpuRetained: return "CPU retained";
+    case Residency::OnDemand: return "On demand";
+    }
+    return "";
+}
+
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, vertices and indices may be empty after the upload (see Residency)
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    vector<Meshlet>      meshlets;  // empty unless buildMeshlets was called
+    GLVertexArray VAO;
+    // name the GL objects are registered under, usually the asset path
+    string owner = "mesh";
+    // sizes of the uploaded buffers, valid even when the CPU copy has been released
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    // object space bounds, computed at upload so they survive releaseCpuData
+    AABB bounds;
 
     //default constructor
     Mesh() : vertices(), indices(), textures() {}
 
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // the buffers are taken by value and moved in, pass them with std::move to avoid copies
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const string& owner = "mesh")
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), owner(owner)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // set the vertex buffers and its attribute pointers.
         setupMesh();
     }
@@ -56,59 +82,100 @@ public:
     // render the mesh
     void Draw(const Shader& shader) const
     {
-        // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
-        for (unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if (name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        bindTextures(shader);
 
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(VAO.get());
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render only the meshlets that survive culling, falls back to Draw when there are none
+    void DrawCulled(const Shader& shader, const MeshletCullContext& context, MeshletStats& stats) const
+    {
+        if (meshlets.empty())
+        {
+            Draw(shader);
+            stats.triangles += indexCount / 3;
+            stats.trianglesDrawn += indexCount / 3;
+            stats.drawCalls++;
+            return;
+        }
+        CullMeshlets(meshlets, context, drawCounts, drawOffsets, stats);
+        if (drawCounts.empty())
+            return;
+        stats.drawCalls++;
+
+        bindTextures(shader);
+        glBindVertexArray(VAO.get());
+        glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()));
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // splits the mesh into meshlets, needs the CPU copy. The index buffer is reordered so that
+    // every meshlet is a contiguous range and uploaded again.
+    void buildMeshlets()
+    {
+        if (!hasCpuData() || indices.empty())
+            return;
+        meshlets = BuildMeshlets(&vertices[0].Position.x, sizeof(Vertex), vertices.size(), indices);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    bool hasCpuData() const
+    {
+        return vertices.size() == vertexCount && indices.size() == indexCount;
+    }
+
+    // frees the CPU copy of the geometry, the GPU buffers are left untouched
+    void releaseCpuData()
+    {
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+    }
+
+    size_t cpuBytes() const
+    {
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    }
+
+    size_t gpuBytes() const
+    {
+        return vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int);
+    }
+
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
+        vertexCount = vertices.size();
+        indexCount = indices.size();
+        bounds = AABB();
+        for (const Vertex& vertex : vertices)
+            bounds.expand(vertex.Position);
+
+        // create buffers/arrays, handles left from a previous setup are released by the assignments
+        VAO = GLVertexArray::Create(owner);
+        VBO = GLBuffer::Create(owner);
+        EBO = GLBuffer::Create(owner);
+
+        glBindVertexArray(VAO.get());
         // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        VBO.setBytes(vertices.size() * sizeof(Vertex));
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        EBO.setBytes(indices.size() * sizeof(unsigned int));
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -136,7 +203,39 @@ public:
     }
 private:
     // render data 
-    unsigned int VBO, EBO;
+    GLBuffer VBO, EBO;
+    // scratch ranges of DrawCulled, kept to avoid allocating every frame
+    mutable vector<int> drawCounts;
+    mutable vector<const void*> drawOffsets;
+
+    void bindTextures(const Shader& shader) const
+    {
+        // bind appropriate textures
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // retrieve texture number
+            string number;
+            string name = textures[i].type;
+            if (name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "texture_specular")
+                number = std::to_string(specularNr++); // transfer unsigned int to string
+            else if (name == "texture_normal")
+                number = std::to_string(normalNr++); // transfer unsigned int to string
+            else if (name == "texture_height")
+                number = std::to_string(heightNr++); // transfer unsigned int to string
+
+            // set the sampler to the correct texture unit
+            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            // bind the texture
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+    }
 
 };
 #endif
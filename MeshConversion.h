@@ -0,0 +1,88 @@
+#ifndef MESH_CONVERSION_H
+#define MESH_CONVERSION_H
+
+#include <assimp/scene.h>
+
+#include "Mesh.h"
+#include "Simd.h"
+
+#include <cstring>
+#include <cstddef>
+#include <vector>
+
+static_assert(sizeof(Vertex) == 22 * sizeof(float), "ConvertVertices assumes a tightly packed Vertex");
+static_assert(offsetof(Vertex, Tangent) == 8 * sizeof(float) && offsetof(Vertex, m_BoneIDs) == 14 * sizeof(float), "unexpected Vertex layout");
+
+// Converts the SoA attribute arrays of an aiMesh into the interleaved Vertex layout
+// used by the GPU buffers. The destination is sized once and written in a single pass.
+inline void ConvertVertices(const aiMesh* mesh, std::vector<Vertex>& vertices)
+{
+    const unsigned int count = mesh->mNumVertices;
+    vertices.resize(count);
+    if (count == 0)
+        return;
+
+    const bool hasNormals = mesh->HasNormals();
+    const bool hasTexCoords = mesh->mTextureCoords[0] != nullptr;
+    const bool hasTangents = hasTexCoords && mesh->HasTangentsAndBitangents();
+
+    Vertex* dst = vertices.data();
+    unsigned int i = 0;
+#if SIMD_SSE2
+    // every source attribute is loaded as 4 floats, the 4th one belongs to the next vertex so the
+    // last vertex is left to the scalar loop. Stores are issued in increasing offset order: the
+    // 4th lane spills into the next field, which is overwritten by the following store.
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 1 < count; i++)
+    {
+        float* v = reinterpret_cast<float*>(dst + i);
+        _mm_storeu_ps(v + 0, _mm_loadu_ps(&mesh->mVertices[i].x));
+        _mm_storeu_ps(v + 3, hasNormals ? _mm_loadu_ps(&mesh->mNormals[i].x) : zero);
+        // texture coordinates are stored as 3D vectors by assimp, only x and y are used
+        _mm_storel_pi(reinterpret_cast<__m64*>(v + 6), hasTexCoords ? _mm_loadu_ps(&mesh->mTextureCoords[0][i].x) : zero);
+        _mm_storeu_ps(v + 8, hasTangents ? _mm_loadu_ps(&mesh->mTangents[i].x) : zero);
+        _mm_storeu_ps(v + 11, hasTangents ? _mm_loadu_ps(&mesh->mBitangents[i].x) : zero);
+        // bone ids and weights
+        _mm_storeu_ps(v + 14, zero);
+        _mm_storeu_ps(v + 18, zero);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        Vertex& vertex = dst[i];
+        std::memset(&vertex, 0, sizeof(Vertex));
+        std::memcpy(&vertex.Position, &mesh->mVertices[i], sizeof(glm::vec3));
+        if (hasNormals)
+            std::memcpy(&vertex.Normal, &mesh->mNormals[i], sizeof(glm::vec3));
+        if (hasTexCoords)
+            std::memcpy(&vertex.TexCoords, &mesh->mTextureCoords[0][i], sizeof(glm::vec2));
+        if (hasTangents)
+        {
+            std::memcpy(&vertex.Tangent, &mesh->mTangents[i], sizeof(glm::vec3));
+            std::memcpy(&vertex.Bitangent, &mesh->mBitangents[i], sizeof(glm::vec3));
+        }
+    }
+}
+
+// Flattens the faces of an aiMesh into an index list. Triangulated meshes (the common case,
+// aiProcess_Triangulate is always requested) are sized up front without walking the faces twice.
+inline void ConvertIndices(const aiMesh* mesh, std::vector<unsigned int>& indices)
+{
+    size_t count = 0;
+    if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        count = static_cast<size_t>(mesh->mNumFaces) * 3;
+    else
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            count += mesh->mFaces[i].mNumIndices;
+
+    indices.resize(count);
+    unsigned int* dst = indices.data();
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace& face = mesh->mFaces[i];
+        std::memcpy(dst, face.mIndices, face.mNumIndices * sizeof(unsigned int));
+        dst += face.mNumIndices;
+    }
+}
+
+#endif
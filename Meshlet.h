@@ -0,0 +1,192 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// A small cluster of triangles with the bounds needed to cull it as a whole.
+// Its triangles are the range [indexOffset, indexOffset + triangleCount * 3) of the mesh index buffer.
+struct Meshlet {
+    glm::vec3 center;       // bounding sphere, object space
+    float radius;
+    glm::vec3 coneAxis;     // average facing direction of the triangles
+    float coneCutoff;       // sine of the cone half angle, 1 when the cluster can't be back-face culled
+    unsigned int indexOffset;
+    unsigned int triangleCount;
+};
+
+// per frame counters of the meshlet culling pass
+struct MeshletStats {
+    size_t meshlets = 0;
+    size_t meshletsDrawn = 0;
+    size_t triangles = 0;
+    size_t trianglesDrawn = 0;
+    size_t drawRanges = 0;
+    size_t drawCalls = 0;
+};
+
+// Splits a triangle list into meshlets. The index buffer is reordered in place so that every meshlet
+// is a contiguous range, the triangles themselves are unchanged. Positions are read with a byte stride
+// so the interleaved Vertex array can be passed directly.
+inline std::vector<Meshlet> BuildMeshlets(const float* positions, size_t strideBytes, size_t vertexCount, std::vector<unsigned int>& indices)
+{
+    auto position = [&](unsigned int index) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * strideBytes);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    std::vector<Meshlet> meshlets;
+    std::vector<unsigned int> ordered;
+    ordered.reserve(indices.size());
+    // meshlet each vertex was last added to, avoids clearing a set for every meshlet
+    std::vector<int> owner(vertexCount, -1);
+
+    size_t triangleCount = indices.size() / 3;
+    size_t begin = 0;
+    size_t verticesUsed = 0;
+    auto flush = [&](size_t end) {
+        if (end == begin)
+            return;
+        Meshlet meshlet;
+        meshlet.indexOffset = static_cast<unsigned int>(begin * 3);
+        meshlet.triangleCount = static_cast<unsigned int>(end - begin);
+
+        AABB box;
+        glm::vec3 normalSum(0.0f);
+        for (size_t t = begin; t < end; t++)
+        {
+            glm::vec3 a = position(ordered[t * 3]), b = position(ordered[t * 3 + 1]), c = position(ordered[t * 3 + 2]);
+            box.expand(a);
+            box.expand(b);
+            box.expand(c);
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+                normalSum += normal / length;
+        }
+        meshlet.center = box.center();
+        meshlet.radius = 0.0f;
+        for (size_t i = begin * 3; i < end * 3; i++)
+            meshlet.radius = std::max(meshlet.radius, glm::length(position(ordered[i]) - meshlet.center));
+
+        // the cone only helps when every triangle faces within 90 degrees of the average
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+        float sumLength = glm::length(normalSum);
+        if (sumLength > 0.0f)
+        {
+            glm::vec3 axis = normalSum / sumLength;
+            float minDot = 1.0f;
+            for (size_t t = begin; t < end; t++)
+            {
+                glm::vec3 a = position(ordered[t * 3]), b = position(ordered[t * 3 + 1]), c = position(ordered[t * 3 + 2]);
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float length = glm::length(normal);
+                if (length > 0.0f)
+                    minDot = std::min(minDot, glm::dot(normal / length, axis));
+            }
+            if (minDot > 0.0f)
+            {
+                meshlet.coneAxis = axis;
+                meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+        }
+        meshlets.push_back(meshlet);
+        begin = end;
+        verticesUsed = 0;
+    };
+
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const unsigned int* triangle = &indices[t * 3];
+        int meshletIndex = static_cast<int>(meshlets.size());
+        size_t newVertices = 0;
+        for (int k = 0; k < 3; k++)
+            newVertices += owner[triangle[k]] != meshletIndex ? 1 : 0;
+        // a repeated vertex inside the triangle is counted twice, which only makes the limit stricter
+        if (verticesUsed + newVertices > MESHLET_MAX_VERTICES || t - begin >= MESHLET_MAX_TRIANGLES)
+        {
+            flush(t);
+            meshletIndex = static_cast<int>(meshlets.size());
+            newVertices = 3;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            if (owner[triangle[k]] != meshletIndex)
+            {
+                owner[triangle[k]] = meshletIndex;
+                verticesUsed++;
+            }
+            ordered.push_back(triangle[k]);
+        }
+    }
+    flush(triangleCount);
+
+    indices.swap(ordered);
+    return meshlets;
+}
+
+// Camera data for the culling pass, in the object space of the mesh being drawn.
+// Cone culling assumes counter-clockwise front faces, like the GL default. It is off by default:
+// only turn it on where GL_CULL_FACE is on too, the app draws double-sided and the back of a
+// single-sided wall seen from inside the room would disappear.
+struct MeshletCullContext {
+    Frustum frustum;
+    glm::vec3 cameraPosition;
+    bool frustumCulling = true;
+    bool coneCulling = false;
+};
+
+inline bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullContext& context)
+{
+    if (context.frustumCulling && !context.frustum.intersectsSphere(meshlet.center, meshlet.radius))
+        return false;
+    if (context.coneCulling && meshlet.coneCutoff < 1.0f)
+    {
+        // every triangle faces away from any point of view inside the cone around the axis
+        glm::vec3 toCenter = meshlet.center - context.cameraPosition;
+        if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+            return false;
+    }
+    return true;
+}
+
+// Culls the meshlets and merges the visible ones into as few index ranges as possible,
+// ready for glMultiDrawElements (counts in indices, offsets in bytes).
+inline void CullMeshlets(const std::vector<Meshlet>& meshlets, const MeshletCullContext& context,
+    std::vector<int>& counts, std::vector<const void*>& offsets, MeshletStats& stats)
+{
+    counts.clear();
+    offsets.clear();
+    unsigned int rangeEnd = 0;
+    for (const Meshlet& meshlet : meshlets)
+    {
+        stats.meshlets++;
+        stats.triangles += meshlet.triangleCount;
+        if (!IsMeshletVisible(meshlet, context))
+            continue;
+        stats.meshletsDrawn++;
+        stats.trianglesDrawn += meshlet.triangleCount;
+        if (!counts.empty() && rangeEnd == meshlet.indexOffset)
+        {
+            counts.back() += static_cast<int>(meshlet.triangleCount * 3);
+        }
+        else
+        {
+            counts.push_back(static_cast<int>(meshlet.triangleCount * 3));
+            offsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(meshlet.indexOffset) * sizeof(unsigned int)));
+        }
+        rangeEnd = meshlet.indexOffset + meshlet.triangleCount * 3;
+    }
+    stats.drawRanges += counts.size();
+}
+
+#endif
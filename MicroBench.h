@@ -0,0 +1,576 @@
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <assimp/mesh.h>
+#include <nlohmann/json.hpp>
+
+#include "Bounds.h"
+#include "MeshConversion.h"
+#include "Meshlet.h"
+#include "NameRegistry.h"
+#include "Picking.h"
+#include "SceneStore.h"
+#include "Snapshot.h"
+#include "StressScene.h"
+#include "TextureCache.h"
+#include "TransformStore.h"
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Micro-benchmarks of the hot paths with a JSON report for tools/bench_compare.py. Unlike the
+// --bench-* modes, which compare an old and a new implementation once, these time the current code
+// the same way on every run so two builds can be compared. Every case does its setup once, then the
+// iteration count is doubled until a run takes --min-time, and the median of --repetitions runs is
+// reported. Nothing here calls into GL: textures are only decoded and meshes only converted, so the
+// suite also runs without a context (tools/microbench.cpp builds it without a window on Linux).
+namespace MicroBench {
+
+    // results feed this so the compiler can't drop the work
+    inline void Consume(float value)
+    {
+        static volatile float sink = 0.0f;
+        sink = sink + value;
+    }
+
+    // the timed body runs its work the given number of times
+    typedef std::function<void(long long)> Body;
+
+    struct Case {
+        std::string name;
+        double items;  // per iteration, for items_per_second, 0 for none
+        std::function<Body()> setup;  // only called when the case is selected, returns an empty body if it can't run
+    };
+
+    struct Result {
+        std::string name;
+        long long iterations = 0;
+        double medianNs = 0.0;  // per iteration
+        double minNs = 0.0;
+        double maxNs = 0.0;
+        double items = 0.0;
+    };
+
+    // a wavy height field of size x size quads, two triangles each
+    inline void MakeGrid(int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        vertices.assign(static_cast<size_t>(size + 1) * (size + 1), Vertex());
+        for (int z = 0; z <= size; z++)
+        {
+            for (int x = 0; x <= size; x++)
+            {
+                Vertex& vertex = vertices[z * (size + 1) + x];
+                float u = static_cast<float>(x) / size, v = static_cast<float>(z) / size;
+                vertex.Position = glm::vec3(u * 2.0f - 1.0f, 0.1f * std::sin(u * 20.0f) * std::cos(v * 20.0f), v * 2.0f - 1.0f);
+                vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                vertex.TexCoords = glm::vec2(u, v);
+            }
+        }
+        indices.clear();
+        for (int z = 0; z < size; z++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                unsigned int corner = z * (size + 1) + x;
+                unsigned int quad[6] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+    }
+
+    // an aiMesh like assimp returns it after MODEL_IMPORT_FLAGS, built from the grid
+    inline std::unique_ptr<aiMesh> MakeAiMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        std::unique_ptr<aiMesh> mesh(new aiMesh());
+        unsigned int count = static_cast<unsigned int>(vertices.size());
+        mesh->mNumVertices = count;
+        mesh->mVertices = new aiVector3D[count];
+        mesh->mNormals = new aiVector3D[count];
+        mesh->mTextureCoords[0] = new aiVector3D[count];
+        mesh->mTangents = new aiVector3D[count];
+        mesh->mBitangents = new aiVector3D[count];
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const Vertex& vertex = vertices[i];
+            mesh->mVertices[i] = aiVector3D(vertex.Position.x, vertex.Position.y, vertex.Position.z);
+            mesh->mNormals[i] = aiVector3D(vertex.Normal.x, vertex.Normal.y, vertex.Normal.z);
+            mesh->mTextureCoords[0][i] = aiVector3D(vertex.TexCoords.x, vertex.TexCoords.y, 0.0f);
+            mesh->mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+            mesh->mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+        }
+        mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+        mesh->mNumFaces = static_cast<unsigned int>(indices.size() / 3);
+        mesh->mFaces = new aiFace[mesh->mNumFaces];
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            mesh->mFaces[i].mNumIndices = 3;
+            mesh->mFaces[i].mIndices = new unsigned int[3];
+            std::copy(indices.begin() + i * 3, indices.begin() + i * 3 + 3, mesh->mFaces[i].mIndices);
+        }
+        return mesh;
+    }
+
+    // boxes of one unit scattered over the +-30 area the sliders of the app allow
+    inline std::vector<AABB> RandomBoxes(size_t count, uint32_t seed)
+    {
+        StressScene::Random random(seed);
+        std::vector<AABB> boxes(count);
+        for (AABB& box : boxes)
+        {
+            glm::vec3 center(random.range(-30.0f, 30.0f), random.range(-30.0f, 30.0f), random.range(-30.0f, 30.0f));
+            box = AABB(center - glm::vec3(0.5f), center + glm::vec3(0.5f));
+        }
+        return boxes;
+    }
+
+    // a 16:9 camera ten units in front of the origin, looking at it
+    inline glm::mat4 TestCamera()
+    {
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f) * view;
+    }
+
+    inline std::vector<Case> Cases()
+    {
+        std::vector<Case> cases;
+
+        // Model::processMesh without the GL upload
+        const int gridSize = 256;
+        cases.push_back(Case{ "convert/process_mesh", static_cast<double>((gridSize + 1) * (gridSize + 1)), [=]() -> Body {
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            MakeGrid(gridSize, vertices, indices);
+            std::shared_ptr<aiMesh> mesh(MakeAiMesh(vertices, indices).release());
+            return [mesh](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    std::vector<Vertex> converted;
+                    std::vector<unsigned int> convertedIndices;
+                    ConvertVertices(mesh.get(), converted);
+                    ConvertIndices(mesh.get(), convertedIndices);
+                    Consume(converted.back().Position.x + convertedIndices.back());
+                }
+            };
+        } });
+
+        // the decode half of TextureFromFile, a 1024x1024 JPEG and PNG of the bundled furniture
+        const char* textures[] = { "texture_diffuse4.jpg", "texture_diffuse1.jpg" };
+        const char* textureCases[] = { "texture/decode_jpeg", "texture/decode_png" };
+        for (int t = 0; t < 2; t++)
+        {
+            std::string file = textures[t];
+            cases.push_back(Case{ textureCases[t], 1024.0 * 1024.0, [file]() -> Body {
+                ImageData probe = DecodeImage(file.c_str(), "resources/objects");
+                if (!probe.pixels)
+                    return Body();
+                stbi_image_free(probe.pixels);
+                return [file](long long iterations) {
+                    for (long long i = 0; i < iterations; i++)
+                    {
+                        ImageData image = DecodeImage(file.c_str(), "resources/objects");
+                        Consume(image.pixels ? image.pixels[0] : 0.0f);
+                        stbi_image_free(image.pixels);
+                    }
+                };
+            } });
+        }
+
+        // the per object matrix, rebuilt with glm and kept up to date by TransformStore
+        const size_t transformCount = 10000;
+        cases.push_back(Case{ "transform/get_transform_matrix", static_cast<double>(transformCount), [=]() -> Body {
+            std::shared_ptr<std::vector<Model>> models = std::make_shared<std::vector<Model>>(transformCount);
+            StressScene::Random random(11);
+            for (Model& model : *models)
+            {
+                model.position = glm::vec3(random.range(-30.0f, 30.0f), random.range(-30.0f, 30.0f), random.range(-30.0f, 30.0f));
+                model.rotation = glm::vec3(random.range(-180.0f, 180.0f), random.range(-180.0f, 180.0f), random.range(-180.0f, 180.0f));
+                model.scale = glm::vec3(random.range(0.1f, 2.0f));
+            }
+            return [models](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    float sum = 0.0f;
+                    for (const Model& model : *models)
+                        sum += model.GetTransformMatrix()[3][0];
+                    Consume(sum);
+                }
+            };
+        } });
+        cases.push_back(Case{ "transform/store_update_all_dirty", static_cast<double>(transformCount), [=]() -> Body {
+            std::shared_ptr<TransformStore> store = std::make_shared<TransformStore>();
+            StressScene::Random random(11);
+            for (size_t i = 0; i < transformCount; i++)
+                store->add(glm::vec3(random.range(-30.0f, 30.0f)), glm::vec3(random.range(-180.0f, 180.0f)), glm::vec3(1.0f));
+            return [=](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    for (size_t index = 0; index < transformCount; index++)
+                        store->setPosition(index, store->position(index));
+                    store->update();
+                    Consume(store->world(0)[3][0]);
+                }
+            };
+        } });
+
+        // a saved scene of 1000 objects, written and read back in memory
+        const int sceneObjects = 1000;
+        auto makeScene = [=]() {
+            std::vector<StressScene::Asset> catalog;
+            const char* files[] = { "chair1.fbx", "Dresser.fbx", "table1.fbx", "desk.fbx", "couch1.fbx" };
+            for (const char* file : files)
+                catalog.push_back(StressScene::Asset{ std::string("resources/objects/") + file, "texture_diffuse1.jpg", 0.5f, 0.0f, file });
+            StressScene::Options options;
+            options.objects = sceneObjects;
+            return StressScene::Generate(options, catalog);
+        };
+        cases.push_back(Case{ "snapshot/serialize", static_cast<double>(sceneObjects), [=]() -> Body {
+            std::shared_ptr<std::vector<ModelSnapshot>> objects = std::make_shared<std::vector<ModelSnapshot>>(makeScene());
+            return [objects](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    std::ostringstream out(std::ios::binary);
+                    for (const ModelSnapshot& object : *objects)
+                        object.serialize(out);
+                    Consume(static_cast<float>(out.tellp()));
+                }
+            };
+        } });
+        cases.push_back(Case{ "snapshot/deserialize", static_cast<double>(sceneObjects), [=]() -> Body {
+            std::ostringstream out(std::ios::binary);
+            for (const ModelSnapshot& object : makeScene())
+                object.serialize(out);
+            std::shared_ptr<std::string> bytes = std::make_shared<std::string>(out.str());
+            return [bytes](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    std::istringstream in(*bytes, std::ios::binary);
+                    float sum = 0.0f;
+                    while (in.peek() != EOF)
+                    {
+                        ModelSnapshot snapshot;
+                        snapshot.deserialize(in);
+                        sum += snapshot.position.x;
+                    }
+                    Consume(sum);
+                }
+            };
+        } });
+
+        // what GenerateUniqueName became: 10000 objects placed from one menu entry
+        const size_t nameCount = 10000;
+        cases.push_back(Case{ "names/unique", static_cast<double>(nameCount), [=]() -> Body {
+            return [=](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    NameRegistry registry;
+                    for (size_t n = 0; n < nameCount; n++)
+                        registry.insert(registry.unique("Chair"));
+                    Consume(static_cast<float>(registry.size()));
+                }
+            };
+        } });
+
+        // culling: every box against the frustum, the same through the scene BVH, and room meshlets
+        const size_t boxCount = 100000;
+        cases.push_back(Case{ "culling/frustum_aabb", static_cast<double>(boxCount), [=]() -> Body {
+            std::shared_ptr<std::vector<AABB>> boxes = std::make_shared<std::vector<AABB>>(RandomBoxes(boxCount, 3));
+            Frustum frustum = Frustum::FromMatrix(TestCamera());
+            return [boxes, frustum](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    int visible = 0;
+                    for (const AABB& box : *boxes)
+                        visible += frustum.intersectsAABB(box) ? 1 : 0;
+                    Consume(static_cast<float>(visible));
+                }
+            };
+        } });
+        cases.push_back(Case{ "culling/bvh_query_frustum", static_cast<double>(boxCount), [=]() -> Body {
+            std::shared_ptr<SceneBVH> bvh = std::make_shared<SceneBVH>();
+            std::vector<AABB> boxes = RandomBoxes(boxCount, 3);
+            for (size_t i = 0; i < boxes.size(); i++)
+                bvh->createProxy(boxes[i], static_cast<int>(i));
+            Frustum frustum = Frustum::FromMatrix(TestCamera());
+            return [bvh, frustum](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    int visible = 0;
+                    bvh->queryFrustum(frustum, [&](int) { visible++; });
+                    Consume(static_cast<float>(visible));
+                }
+            };
+        } });
+        cases.push_back(Case{ "culling/meshlets", 0.0, [=]() -> Body {
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            MakeGrid(gridSize, vertices, indices);
+            std::shared_ptr<std::vector<Meshlet>> meshlets = std::make_shared<std::vector<Meshlet>>(
+                BuildMeshlets(&vertices[0].Position.x, sizeof(Vertex), vertices.size(), indices));
+            MeshletCullContext context;
+            context.frustum = Frustum::FromMatrix(TestCamera());
+            context.cameraPosition = glm::vec3(0.0f, 1.0f, 10.0f);
+            return [meshlets, context](long long iterations) {
+                std::vector<int> counts;
+                std::vector<const void*> offsets;
+                for (long long i = 0; i < iterations; i++)
+                {
+                    MeshletStats stats;
+                    CullMeshlets(*meshlets, context, counts, offsets, stats);
+                    Consume(static_cast<float>(stats.trianglesDrawn));
+                }
+            };
+        } });
+
+        // BVH builds: scene proxies inserted one by one, triangles of a mesh in one go
+        const size_t proxyCount = 10000;
+        cases.push_back(Case{ "bvh/scene_insert", static_cast<double>(proxyCount), [=]() -> Body {
+            std::shared_ptr<std::vector<AABB>> boxes = std::make_shared<std::vector<AABB>>(RandomBoxes(proxyCount, 5));
+            return [boxes](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    SceneBVH bvh;
+                    for (size_t b = 0; b < boxes->size(); b++)
+                        bvh.createProxy((*boxes)[b], static_cast<int>(b));
+                    Consume(static_cast<float>(bvh.height()));
+                }
+            };
+        } });
+        std::function<std::vector<Triangle>()> gridTriangles = [=]() {
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            MakeGrid(gridSize, vertices, indices);
+            std::vector<Triangle> triangles;
+            AppendTriangles(&vertices[0].Position.x, sizeof(Vertex), indices.data(), indices.size(), triangles);
+            return triangles;
+        };
+        cases.push_back(Case{ "bvh/triangle_build", 2.0 * gridSize * gridSize, [=]() -> Body {
+            std::shared_ptr<std::vector<Triangle>> triangles = std::make_shared<std::vector<Triangle>>(gridTriangles());
+            return [triangles](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    TriangleBVH bvh(*triangles);
+                    Consume(static_cast<float>(bvh.bytes()));
+                }
+            };
+        } });
+
+        // picking: rays from the camera against one mesh, and through a scene of 1000 instances of it
+        const int rayCount = 1000;
+        auto makeRays = [=]() {
+            std::vector<Ray> rays;
+            StressScene::Random random(7);
+            for (int i = 0; i < rayCount; i++)
+                rays.push_back(ScreenPointToRay(random.range(0.0f, 1920.0f), random.range(0.0f, 1080.0f), 1920, 1080, TestCamera()));
+            return rays;
+        };
+        cases.push_back(Case{ "pick/triangle_ray", static_cast<double>(rayCount), [=]() -> Body {
+            std::shared_ptr<TriangleBVH> bvh = std::make_shared<TriangleBVH>(gridTriangles());
+            std::shared_ptr<std::vector<Ray>> rays = std::make_shared<std::vector<Ray>>(makeRays());
+            // the grid lies around the origin, scaled up to fill the view
+            glm::mat4 inverse = glm::inverse(glm::scale(glm::mat4(1.0f), glm::vec3(8.0f)));
+            return [bvh, rays, inverse](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    int hits = 0;
+                    for (const Ray& ray : *rays)
+                    {
+                        float t;
+                        hits += IntersectInstance(*bvh, inverse, ray, FLT_MAX, t) ? 1 : 0;
+                    }
+                    Consume(static_cast<float>(hits));
+                }
+            };
+        } });
+        const int instanceCount = 1000;
+        cases.push_back(Case{ "pick/scene_ray", static_cast<double>(rayCount), [=]() -> Body {
+            std::shared_ptr<Model> asset = std::make_shared<Model>();
+            asset->pickBVH = std::make_shared<TriangleBVH>(gridTriangles());
+            asset->meshes.emplace_back();
+            asset->meshes.back().bounds = AABB(glm::vec3(-1.0f, -0.1f, -1.0f), glm::vec3(1.0f, 0.1f, 1.0f));
+            std::shared_ptr<SceneStore> scene = std::make_shared<SceneStore>();
+            StressScene::Random random(9);
+            for (int i = 0; i < instanceCount; i++)
+            {
+                glm::vec3 position(random.range(-30.0f, 30.0f), random.range(-5.0f, 5.0f), random.range(-30.0f, 5.0f));
+                scene->add(asset, "Grid", position, glm::vec3(random.range(-180.0f, 180.0f), 0.0f, 0.0f), glm::vec3(1.0f));
+            }
+            scene->update();
+            std::shared_ptr<std::vector<Ray>> rays = std::make_shared<std::vector<Ray>>(makeRays());
+            return [scene, rays](long long iterations) {
+                for (long long i = 0; i < iterations; i++)
+                {
+                    int hits = 0;
+                    for (const Ray& ray : *rays)
+                    {
+                        float closest = FLT_MAX;
+                        // the loop of PickObject in main.cpp
+                        scene->queryRay(ray.origin, ray.direction, FLT_MAX, [&](int index, float) {
+                            float t;
+                            if (scene->assets[index]->intersectRay(ray, scene->transforms.world(index), closest, t))
+                                closest = t;
+                            return closest;
+                        });
+                        hits += closest < FLT_MAX ? 1 : 0;
+                    }
+                    Consume(static_cast<float>(hits));
+                }
+            };
+        } });
+
+        return cases;
+    }
+
+    inline Result Measure(const std::string& name, double items, const Body& body, double minTime, int repetitions)
+    {
+        Result result;
+        result.name = name;
+        result.items = items;
+        // one untimed pass warms caches and allocators
+        body(1);
+        long long iterations = 1;
+        for (;;)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body(iterations);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds >= minTime || iterations >= (1LL << 40))
+                break;
+            // aim a little past minTime so the next run is usually the last one
+            double scale = seconds > 0.0 ? minTime * 1.2 / seconds : 10.0;
+            iterations = std::max(iterations * 2, static_cast<long long>(iterations * std::min(scale, 100.0)));
+        }
+        result.iterations = iterations;
+
+        std::vector<double> times;
+        for (int r = 0; r < repetitions; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body(iterations);
+            times.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations);
+        }
+        std::sort(times.begin(), times.end());
+        size_t middle = times.size() / 2;
+        result.medianNs = times.size() % 2 ? times[middle] : (times[middle - 1] + times[middle]) / 2.0;
+        result.minNs = times.front();
+        result.maxNs = times.back();
+        return result;
+    }
+
+    // --bench-micro [--filter text] [--min-time seconds] [--repetitions N] [--json out.json] [--list],
+    // arguments start at first
+    inline int Run(int argc, char** argv, int first)
+    {
+        std::string filter, jsonPath;
+        double minTime = 0.2;
+        int repetitions = 5;
+        bool list = false;
+        for (int i = first; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--filter" && hasValue)
+                filter = argv[++i];
+            else if (arg == "--min-time" && hasValue)
+                minTime = std::max(0.001, std::atof(argv[++i]));
+            else if (arg == "--repetitions" && hasValue)
+                repetitions = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--json" && hasValue)
+                jsonPath = argv[++i];
+            else if (arg == "--list")
+                list = true;
+            else
+            {
+                std::cerr << "Usage: --bench-micro [--filter text] [--min-time seconds] [--repetitions N] [--json out.json] [--list]" << std::endl;
+                return 1;
+            }
+        }
+
+        nlohmann::json benchmarks = nlohmann::json::array();
+        int failures = 0;
+        char line[256];
+        for (const Case& benchmark : Cases())
+        {
+            if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+                continue;
+            if (list)
+            {
+                std::cout << benchmark.name << "\n";
+                continue;
+            }
+            Body body = benchmark.setup();
+            if (!body)
+            {
+                std::cerr << benchmark.name << ": can't run (missing resources?)" << std::endl;
+                failures++;
+                continue;
+            }
+            Result result = Measure(benchmark.name, benchmark.items, body, minTime, repetitions);
+            snprintf(line, sizeof(line), "%-36s %14.1f ns  (min %.1f, max %.1f, %lld iterations)", result.name.c_str(), result.medianNs, result.minNs, result.maxNs, result.iterations);
+            std::cout << line;
+            if (result.items > 0.0)
+                std::cout << "  " << result.items / result.medianNs * 1e3 << " M items/s";
+            std::cout << std::endl;
+
+            nlohmann::json entry = {
+                { "name", result.name },
+                { "iterations", result.iterations },
+                { "repetitions", repetitions },
+                { "real_time", result.medianNs },
+                { "min_time", result.minNs },
+                { "max_time", result.maxNs },
+                { "time_unit", "ns" },
+            };
+            if (result.items > 0.0)
+                entry["items_per_second"] = result.items / result.medianNs * 1e9;
+            benchmarks.push_back(entry);
+        }
+        if (list)
+            return 0;
+
+        if (!jsonPath.empty())
+        {
+            char date[32];
+            std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+            nlohmann::json report = {
+                { "context", {
+                    { "date", date },
+                    { "executable", argv[0] },
+                    { "num_cpus", std::thread::hardware_concurrency() },
+                    { "min_time", minTime },
+#ifdef NDEBUG
+                    { "build_type", "release" },
+#else
+                    { "build_type", "debug" },
+#endif
+                } },
+                { "benchmarks", benchmarks },
+            };
+            std::ofstream out(jsonPath);
+            out << report.dump(2) << "\n";
+            if (!out)
+            {
+                std::cerr << "Failed to write " << jsonPath << std::endl;
+                return 1;
+            }
+            std::cout << "wrote " << jsonPath << std::endl;
+        }
+        return failures ? 1 : 0;
+    }
+}
+
+#endif
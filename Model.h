@@ -10,9 +10,20 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/IOStream.hpp>
 
+#include "AssetCache.h"
+#include "LoadTelemetry.h"
+#include "MemoryTracker.h"
 #include "Mesh.h"
+#include "MeshConversion.h"
+#include "Picking.h"
+#include "Profiler.h"
 #include "Shader.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
 
 #include <string>
 #include <fstream>
@@ -22,7 +33,75 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+// post-processing steps requested from assimp for every imported model
+#define MODEL_IMPORT_FLAGS (aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace)
+
+// Assimp file access with the time spent in reads and the bytes read added up, so the importer's
+// own time can be told apart from the disk. Covers every file the importer opens (.mtl, .bin of
+// glTF, ...), not only the model itself.
+class MeasuredIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    double readMs = 0.0;
+    size_t bytesRead = 0;
+
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+    {
+        double start = TraceRecorder::Now();
+        Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+        readMs += (TraceRecorder::Now() - start) * 1e-3;
+        return stream ? new MeasuredStream(stream, *this) : nullptr;
+    }
+
+    // importers also delete streams themselves, the wrapper frees the file either way
+    void Close(Assimp::IOStream* file) override
+    {
+        delete file;
+    }
+
+private:
+    class MeasuredStream : public Assimp::IOStream
+    {
+    public:
+        MeasuredStream(Assimp::IOStream* inner, MeasuredIOSystem& owner) : inner(inner), owner(owner) {}
+        ~MeasuredStream() override { delete inner; }
+
+        Assimp::IOStream* inner;
+
+        size_t Read(void* buffer, size_t size, size_t count) override
+        {
+            double start = TraceRecorder::Now();
+            size_t read = inner->Read(buffer, size, count);
+            owner.readMs += (TraceRecorder::Now() - start) * 1e-3;
+            owner.bytesRead += read * size;
+            return read;
+        }
+        size_t Write(const void* buffer, size_t size, size_t count) override { return inner->Write(buffer, size, count); }
+        aiReturn Seek(size_t offset, aiOrigin origin) override { return inner->Seek(offset, origin); }
+        size_t Tell() const override { return inner->Tell(); }
+        size_t FileSize() const override { return inner->FileSize(); }
+        void Flush() override { inner->Flush(); }
+
+    private:
+        MeasuredIOSystem& owner;
+    };
+};
+
+// The steps of MODEL_IMPORT_FLAGS one at a time, in the order assimp's own pipeline runs them, so
+// loadModel can time each. The result is the same as passing all flags to ReadFile.
+struct ImportStep {
+    unsigned int flag;
+    double AssetLoadRecord::*ms;
+};
+const ImportStep ImportSteps[] = {
+    { aiProcess_FlipUVs, &AssetLoadRecord::flipUVsMs },
+    { aiProcess_Triangulate, &AssetLoadRecord::triangulateMs },
+    { aiProcess_GenSmoothNormals, &AssetLoadRecord::smoothNormalsMs },
+    { aiProcess_CalcTangentSpace, &AssetLoadRecord::tangentsMs },
+};
+static_assert(MODEL_IMPORT_FLAGS == (aiProcess_FlipUVs | aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace),
+    "a new import flag needs an entry in ImportSteps");
+
 
 class Model
 {
@@ -30,16 +109,20 @@ public:
     // model data 
     vector<Mesh>    meshes;
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<shared_ptr<GLTexture>> textureHandles;  // keeps the textures in textures_loaded alive, shared with other models through TextureCache
     std::string objectName;
-    std::string textureName;
     std::string filePath;
     string directory;
-    int id;
+    // placement of a model drawn on its own (the room), scene objects are placed through their
+    // TransformStore entry
     glm::vec3 position;
     glm::vec3 rotation;
     glm::vec3 scale;
-    Mesh mesh;
     Shader shader;
+    // applied at the end of loadModel, change it afterwards with setResidency
+    Residency residency = Residency::GpuOnly;
+    // triangles for mouse picking, shared by every model of the same asset, null until buildPickBVH
+    shared_ptr<const TriangleBVH> pickBVH;
 
 
     glm::mat4 GetTransformMatrix() const {
@@ -59,12 +142,6 @@ public:
         scale(glm::vec3(1.0f)), 
         filePath("resources/objects/") {
     }
-    //constructor for object
-    Model(const std::string& modelPath, int id, const glm::vec3& pos, const glm::vec3& rot, const glm::vec3& scl)
-        : id(id), position(pos), rotation(rot), scale(scl), filePath(modelPath) {
-        loadModel(modelPath);
-    }
-
     // costructor for scenario
     Model(const std::string& modelPath, const glm::vec3& pos, const glm::vec3& rot, const glm::vec3& scl)
         : position(pos), rotation(rot), scale(scl), filePath(modelPath) {
@@ -95,223 +172,435 @@ public:
     glm::vec3 getScale() const {
         return scale;
     }
-    void setShaderPaths(const std::string& vertexPath, const std::string& fragmentPath) {
-        shader.vertexShaderPath = vertexPath;
-        shader.fragmentShaderPath = fragmentPath;
+    // object space bounds of all meshes
+    AABB localBounds() const {
+        AABB bounds;
+        for (const Mesh& mesh : meshes)
+            bounds.expand(mesh.bounds);
+        return bounds;
     }
-    const Shader& getShader() const {
-        return shader;
+
+    AABB worldBounds() const {
+        return localBounds().transformed(GetTransformMatrix());
+    }
+
+    // splits every mesh into meshlets so DrawCulled can skip clusters, meant for the large room meshes
+    void buildMeshlets() {
+        if (!loadCpuGeometry())
+            return;
+        {
+            MEMORY_SCOPE(Acceleration);
+            for (Mesh& mesh : meshes)
+                mesh.buildMeshlets();
+        }
+        releaseCpuGeometry();
     }
-    // Setter for position
-    void setPosition(const glm::vec3& newPosition) {
-        position = newPosition;
+
+    // builds the triangle BVH used by intersectRay, or takes the one of another model of the same asset
+    void buildPickBVH() {
+        pickBVH = TriangleBVHCache::Get().find(filePath);
+        if (pickBVH || !loadCpuGeometry())
+            return;
+        MEMORY_SCOPE(Acceleration);
+        vector<Triangle> triangles;
+        for (const Mesh& mesh : meshes)
+            if (!mesh.vertices.empty())
+                AppendTriangles(&mesh.vertices[0].Position.x, sizeof(Vertex), mesh.indices.data(), mesh.indices.size(), triangles);
+        pickBVH = TriangleBVHCache::Get().insert(filePath, std::move(triangles));
+        releaseCpuGeometry();
+    }
+
+    // closest hit of a world space ray with the triangles of the model placed with transform,
+    // t is the distance along the ray
+    bool intersectRay(const Ray& ray, const glm::mat4& transform, float maxT, float& t) const {
+        if (!pickBVH)
+            return false;
+        return IntersectInstance(*pickBVH, glm::inverse(transform), ray, maxT, t);
+    }
+
+    // draws the meshlets visible from the camera, settings only provides the culling switches
+    void DrawCulled(const Shader& shader, const glm::mat4& viewProjection, const glm::vec3& cameraPosition, const MeshletCullContext& settings, MeshletStats& stats) const
+    {
+        glm::mat4 transform = GetTransformMatrix();
+        MeshletCullContext context = settings;
+        context.frustum = Frustum::FromMatrix(viewProjection * transform);
+        context.cameraPosition = glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.0f));
+        for (const Mesh& mesh : meshes)
+            mesh.DrawCulled(shader, context, stats);
+    }
+
+    // switches the residency policy, the CPU copies are reloaded or freed to match it
+    void setResidency(Residency newResidency) {
+        residency = newResidency;
+        if (residency == Residency::CpuRetained)
+            loadCpuGeometry();
+        else
+            releaseCpuGeometry();
     }
 
-    // Setter for rotation
-    void setRotation(const glm::vec3& newRotation) {
-        rotation = newRotation;
+    // makes sure every mesh has its CPU copy (baked file first, the source asset as a fallback).
+    // Residency::OnDemand users call releaseCpuGeometry once they are done with it.
+    bool loadCpuGeometry() {
+        bool resident = true;
+        for (const Mesh& mesh : meshes)
+            resident = resident && mesh.hasCpuData();
+        if (resident)
+            return true;
+        if (AssetCache::Read(filePath, meshes))
+            return true;
+        return reloadGeometryFromSource();
     }
 
-    // Setter for scale
-    void setScale(const glm::vec3& newScale) {
-        scale = newScale;
+    // frees the CPU copies unless the policy asks to keep them
+    void releaseCpuGeometry() {
+        if (residency == Residency::CpuRetained)
+            return;
+        for (Mesh& mesh : meshes)
+            mesh.releaseCpuData();
+    }
+
+    size_t cpuBytes() const {
+        size_t bytes = 0;
+        for (const Mesh& mesh : meshes)
+            bytes += mesh.cpuBytes();
+        return bytes;
+    }
+
+    size_t gpuBytes() const {
+        size_t bytes = 0;
+        for (const Mesh& mesh : meshes)
+            bytes += mesh.gpuBytes();
+        return bytes;
+    }
+
+    // video memory of the textures, those shared with other models through TextureCache included
+    size_t textureBytes() const {
+        size_t bytes = 0;
+        for (const Texture& texture : textures_loaded)
+            bytes += GpuResourceRegistry::Get().bytes(GpuResourceKind::Texture, texture.id);
+        return bytes;
+    }
+
+    void setShaderPaths(const std::string& vertexPath, const std::string& fragmentPath) {
+        shader.vertexShaderPath = vertexPath;
+        shader.fragmentShaderPath = fragmentPath;
+    }
+    const Shader& getShader() const {
+        return shader;
     }
 
 private:
-    // loads a model and stores the resulting meshes in the meshes vector.
+    // a mesh between conversion and upload: CPU-side buffers plus the paths of its material textures
+    struct PendingMesh {
+        const aiMesh* source;
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        vector<string> texturePaths;
+        double convertMs = 0.0;
+    };
+
+    // loads a model and stores the resulting meshes in the meshes vector, from the baked file when
+    // it is fresh. Otherwise the node tree is walked first to build the work list, the meshes are
+    // converted and the new textures decoded on the thread pool, then everything is uploaded in
+    // order on the calling (GL) thread.
     void loadModel(string const& path)
     {
+        PROFILE_SCOPE("Import");
+        MEMORY_SCOPE(Geometry);
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+        AssetLoadRecord load;
+        load.path = path;
+        double loadStart = TraceRecorder::Now();
+        if (loadBaked(path, load))
+        {
+            releaseCpuGeometry();
+            finishLoad(load, loadStart);
+            return;
+        }
+
+        load.source = "assimp";
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        // the importer owns and deletes the IO system, the counters are read while it is alive
+        MeasuredIOSystem* io = new MeasuredIOSystem();
+        importer.SetIOHandler(io);
+        const aiScene* scene;
+        {
+            // the app side only, assimp allocates from its DLL's heap
+            MEMORY_SCOPE(Import);
+            double parseStart = TraceRecorder::Now();
+            scene = importer.ReadFile(path, 0);
+            load.readMs = io->readMs;
+            load.bytesRead = io->bytesRead;
+            load.parseMs = (TraceRecorder::Now() - parseStart) * 1e-3 - io->readMs;
+            for (const ImportStep& step : ImportSteps)
+            {
+                if (!scene)
+                    break;
+                double stepStart = TraceRecorder::Now();
+                scene = importer.ApplyPostProcessing(step.flag);
+                load.*step.ms = (TraceRecorder::Now() - stepStart) * 1e-3;
+            }
+        }
         // check for errors
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
-    }
+        // 1. collect the meshes of ASSIMP's node tree in draw order
+        vector<PendingMesh> pending;
+        collectMeshes(scene->mRootNode, scene, pending);
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene)
-    {
-        // process each mesh located at the current node
-        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        // 2. resolve the materials, textures seen for the first time are queued for decoding
+        vector<Texture> newTextures;
+        for (PendingMesh& mesh : pending)
+            resolveMaterialTextures(scene->mMaterials[mesh.source->mMaterialIndex], mesh.texturePaths, newTextures);
+
+        // 3. decode images and convert meshes in parallel, images go first since they are the longest jobs.
+        // Streamed textures are decoded by the streamer instead, the load doesn't wait for them.
+        vector<ImageData> images(TextureStreamer::Get().enabled() ? 0 : newTextures.size());
+        ThreadPool::Shared().parallelFor(images.size() + pending.size(), [&](size_t job) {
+            if (job < images.size())
+            {
+                TRACE_SCOPE("Decode texture", "load");
+                MEMORY_SCOPE(Textures);
+                images[job] = DecodeImage(newTextures[job].path.c_str(), directory);
+                return;
+            }
+            TRACE_SCOPE("Convert mesh", "load");
+            MEMORY_SCOPE(Geometry);
+            PendingMesh& mesh = pending[job - images.size()];
+            double convertStart = TraceRecorder::Now();
+            ConvertVertices(mesh.source, mesh.vertices);
+            ConvertIndices(mesh.source, mesh.indices);
+            mesh.convertMs = (TraceRecorder::Now() - convertStart) * 1e-3;
+        });
+
+        // 4. GL uploads, in order
+        uploadTextures(newTextures, images, load);
         {
-            // the node object only contains indices to index the actual objects in the scene. 
-            // the scene contains all the data, nodes keep stuff organised.
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            TRACE_SCOPE("Upload meshes", "upload");
+            double uploadStart = TraceRecorder::Now();
+            meshes.reserve(meshes.size() + pending.size());
+            for (PendingMesh& mesh : pending)
+            {
+                load.convertMs += mesh.convertMs;
+                countMesh(mesh.vertices.size(), mesh.indices.size(), load);
+                vector<Texture> textures;
+                textures.reserve(mesh.texturePaths.size());
+                for (const string& texturePath : mesh.texturePaths)
+                    textures.push_back(*findLoadedTexture(texturePath));
+                meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), "mesh " + path));
+            }
+            load.meshUploadMs = (TraceRecorder::Now() - uploadStart) * 1e-3;
         }
-        // after processed all of the meshes (if any), recursively process each of the children nodes
-        for (unsigned int i = 0; i < node->mNumChildren; i++)
+
+        // 5. bake the converted buffers once so the CPU copies can be dropped and reloaded cheaply
+        if (!AssetCache::IsFresh(path))
         {
-            processNode(node->mChildren[i], scene);
+            TRACE_SCOPE("Bake asset cache", "load");
+            double bakeStart = TraceRecorder::Now();
+            AssetCache::Write(path, meshes);
+            load.bakeMs = (TraceRecorder::Now() - bakeStart) * 1e-3;
         }
+        releaseCpuGeometry();
+        finishLoad(load, loadStart);
+    }
 
+    void countMesh(size_t vertexCount, size_t indexCount, AssetLoadRecord& load)
+    {
+        load.meshes++;
+        load.vertices += vertexCount;
+        load.triangles += indexCount / 3;
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    void finishLoad(AssetLoadRecord& load, double start)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        load.totalMs = (TraceRecorder::Now() - start) * 1e-3;
+        LoadTelemetry::Get().add(load);
+    }
 
-        // walk through each of the mesh's vertices
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    // the converted meshes and their texture references come from the baked file, only the new
+    // textures are decoded. False if there is no fresh baked file.
+    bool loadBaked(const string& path, AssetLoadRecord& load)
+    {
+        vector<AssetCache::BakedMesh> baked;
         {
-            Vertex vertex;
-            glm::vec3 vector; // declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            TRACE_SCOPE("Read asset cache", "load");
+            double readStart = TraceRecorder::Now();
+            if (!AssetCache::ReadBaked(path, baked))
+                return false;
+            load.readMs = (TraceRecorder::Now() - readStart) * 1e-3;
+        }
+        load.source = "asset cache";
+        AssetCache::SourceStamp bakedFile;
+        if (AssetCache::GetSourceStamp(AssetCache::BakedPath(path), bakedFile))
+            load.bytesRead = static_cast<size_t>(bakedFile.size);
+        vector<Texture> newTextures;
+        for (const AssetCache::BakedMesh& mesh : baked)
+            for (const Texture& texture : mesh.textures)
+                resolveTexture(texture.path, texture.type, newTextures);
+
+        vector<ImageData> images(TextureStreamer::Get().enabled() ? 0 : newTextures.size());
+        ThreadPool::Shared().parallelFor(images.size(), [&](size_t i) {
+            TRACE_SCOPE("Decode texture", "load");
+            MEMORY_SCOPE(Textures);
+            images[i] = DecodeImage(newTextures[i].path.c_str(), directory);
+        });
+        uploadTextures(newTextures, images, load);
+
+        TRACE_SCOPE("Upload meshes", "upload");
+        double uploadStart = TraceRecorder::Now();
+        meshes.reserve(meshes.size() + baked.size());
+        for (AssetCache::BakedMesh& mesh : baked)
+        {
+            countMesh(mesh.vertices.size(), mesh.indices.size(), load);
+            vector<Texture> textures;
+            textures.reserve(mesh.textures.size());
+            for (const Texture& texture : mesh.textures)
+                textures.push_back(*findLoadedTexture(texture.path));
+            meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), "mesh " + path));
+        }
+        load.meshUploadMs = (TraceRecorder::Now() - uploadStart) * 1e-3;
+        return true;
+    }
+
+    // uploads the decoded images in order, the textures become part of the model and the texture cache.
+    // With the streamer running the model gets placeholders that fill in over the next frames, and
+    // the streamer reports the texture loads itself.
+    void uploadTextures(const vector<Texture>& newTextures, vector<ImageData>& images, AssetLoadRecord& load)
+    {
+        TRACE_SCOPE("Upload textures", "upload");
+        if (TextureStreamer::Get().enabled())
+        {
+            for (const Texture& texture : newTextures)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                addTexture(texture, StreamTexture(ImagePath(texture.path.c_str(), directory)));
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            return;
+        }
+        for (size_t i = 0; i < newTextures.size(); i++)
+        {
+            string filename = ImagePath(newTextures[i].path.c_str(), directory);
+            addTexture(newTextures[i], TextureCache::Get().insert(filename, UploadTexture(images[i], filename)));
+            RecordTextureLoad(images[i], load);
+        }
+    }
 
-            vertices.push_back(vertex);
+    // converts the source asset again without touching the GPU buffers
+    bool reloadGeometryFromSource()
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(filePath, MODEL_IMPORT_FLAGS);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+        vector<PendingMesh> pending;
+        collectMeshes(scene->mRootNode, scene, pending);
+        if (pending.size() != meshes.size())
+            return false;
+        ThreadPool::Shared().parallelFor(pending.size(), [&](size_t i) {
+            ConvertVertices(pending[i].source, meshes[i].vertices);
+            ConvertIndices(pending[i].source, meshes[i].indices);
+        });
+        return true;
+    }
+
+    // walks the node tree recursively and appends every mesh it references to the work list.
+    void collectMeshes(const aiNode* node, const aiScene* scene, vector<PendingMesh>& pending)
+    {
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            // the node object only contains indices to index the actual objects in the scene. 
+            // the scene contains all the data, nodes keep stuff organised.
+            PendingMesh mesh;
+            mesh.source = scene->mMeshes[node->mMeshes[i]];
+            pending.push_back(std::move(mesh));
         }
-        // now walk through each of the mesh's facesand retrieve the corresponding vertex indices.
-        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            collectMeshes(node->mChildren[i], scene, pending);
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        // each diffuse texture should be named
-        // as 'texture_diffuseN', N is a number ranging from 1 to MAX_SAMPLER_NUMBER. 
-        // same logic applies to the following
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
+    }
 
+    // gathers the texture paths used by a material.
+    // each diffuse texture should be named
+    // as 'texture_diffuseN', N is a number ranging from 1 to MAX_SAMPLER_NUMBER. 
+    // same logic applies to the following
+    // diffuse: texture_diffuseN
+    // specular: texture_specularN
+    // normal: texture_normalN
+    void resolveMaterialTextures(aiMaterial* material, vector<string>& texturePaths, vector<Texture>& newTextures)
+    {
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        resolveMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", texturePaths, newTextures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        resolveMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", texturePaths, newTextures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        resolveMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", texturePaths, newTextures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        resolveMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", texturePaths, newTextures);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+    // checks all material textures of a given type, the ones that are neither loaded nor queued yet are queued.
+    void resolveMaterialTextures(aiMaterial* mat, aiTextureType type, const string& typeName, vector<string>& texturePaths, vector<Texture>& newTextures)
     {
-        vector<Texture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if (!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            texturePaths.push_back(str.C_Str());
+            resolveTexture(str.C_Str(), typeName, newTextures);
         }
-        return textures;
     }
-};
-
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // a texture that is neither loaded nor in the texture cache nor queued yet is queued
+    void resolveTexture(const string& path, const string& typeName, vector<Texture>& newTextures)
+    {
+        // a texture with the same filepath has already been loaded or queued, skip it (optimization)
+        if (findLoadedTexture(path))
+            return;
+        // another model already uploaded it
+        shared_ptr<GLTexture> cached = TextureCache::Get().find(ImagePath(path.c_str(), directory));
+        if (cached)
+        {
+            Texture texture;
+            texture.type = typeName;
+            texture.path = path;
+            addTexture(texture, cached);
+            return;
+        }
+        for (const Texture& texture : newTextures)
+            if (texture.path == path)
+                return;
+        Texture texture;
+        texture.id = 0;
+        texture.type = typeName;
+        texture.path = path;
+        newTextures.push_back(texture);
+    }
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+    void addTexture(Texture texture, shared_ptr<GLTexture> handle)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
+        texture.id = handle->get();
+        textures_loaded.push_back(texture);
+        textureHandles.push_back(std::move(handle));
+    }
+
+    const Texture* findLoadedTexture(const string& path) const
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        for (const Texture& texture : textures_loaded)
+            if (texture.path == path)
+                return &texture;
+        return nullptr;
     }
+};
+
 
-    return textureID;
-}
 #endif
 
@@ -0,0 +1,46 @@
+#ifndef NAME_REGISTRY_H
+#define NAME_REGISTRY_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Names in use by the scene objects. unique(base) returns base if it is free, otherwise base
+// followed by the first free counter (base0, base1, ...). The counter to try next is kept per base,
+// so placing N objects of one type costs O(N) lookups instead of rescanning every name each time.
+// Counters only grow: deleting base3 doesn't make the next object base3 again, the names stay unique.
+class NameRegistry
+{
+public:
+    bool contains(const std::string& name) const { return used.count(name) != 0; }
+    size_t size() const { return used.size(); }
+
+    std::string unique(const std::string& base)
+    {
+        if (!contains(base))
+            return base;
+        int& counter = nextSuffix[base];
+        std::string name = base + std::to_string(counter);
+        // names loaded from a file or typed by hand can occupy counters ahead of it
+        while (contains(name))
+            name = base + std::to_string(++counter);
+        counter++;
+        return name;
+    }
+
+    // returns false if the name is already taken
+    bool insert(const std::string& name) { return used.insert(name).second; }
+    void release(const std::string& name) { used.erase(name); }
+
+    void clear()
+    {
+        used.clear();
+        nextSuffix.clear();
+    }
+
+private:
+    std::unordered_set<std::string> used;
+    std::unordered_map<std::string, int> nextSuffix;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "GpuResources.h"
+#include "TextureCompression.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Which library creates the GL context of a headless render. Native is the platform default (WGL,
+// GLX), EGL and OSMesa can run on Mesa's llvmpipe without a GPU; LIBGL_ALWAYS_SOFTWARE=1 forces
+// llvmpipe for the other two on Mesa drivers.
+enum class GLBackend { Native, Egl, OSMesa };
+
+inline const char* GLBackendName(GLBackend backend)
+{
+    switch (backend)
+    {
+    case GLBackend::Native: return "native";
+    case GLBackend::Egl: return "egl";
+    case GLBackend::OSMesa: return "osmesa";
+    }
+    return "";
+}
+
+inline bool ParseGLBackend(const std::string& name, GLBackend& backend)
+{
+    for (GLBackend candidate : { GLBackend::Native, GLBackend::Egl, GLBackend::OSMesa })
+    {
+        if (name == GLBackendName(candidate))
+        {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Initializes GLFW and creates a hidden 3.3 core context for rendering into framebuffers, nullptr if
+// the backend isn't available. GLFW 3.3 still opens a display connection (Xvfb on a server without
+// one), with GLFW 3.4 OSMesa runs on the null platform and needs no display at all.
+inline GLFWwindow* CreateOffscreenContext(GLBackend backend)
+{
+#ifdef GLFW_PLATFORM_NULL
+    if (backend == GLBackend::OSMesa)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+    if (!glfwInit())
+        return nullptr;
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (backend == GLBackend::Egl)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    else if (backend == GLBackend::OSMesa)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+
+    // the window is never shown, the default framebuffer isn't used
+    GLFWwindow* window = glfwCreateWindow(16, 16, "Interior Designer (offscreen)", NULL, NULL);
+    if (!window)
+    {
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+    TextureCompression::DetectSupport();
+    return window;
+}
+
+// Color and depth renderbuffers to draw a frame into and read it back.
+class OffscreenTarget
+{
+public:
+    int width = 0;
+    int height = 0;
+
+    // false if the driver doesn't accept the attachments
+    bool create(int newWidth, int newHeight)
+    {
+        width = newWidth;
+        height = newHeight;
+        framebuffer = GLFramebuffer::Create("offscreen target");
+        color = GLRenderbuffer::Create("offscreen target");
+        depth = GLRenderbuffer::Create("offscreen target");
+
+        glBindRenderbuffer(GL_RENDERBUFFER, color.get());
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        color.setBytes(static_cast<size_t>(width) * height * 4);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth.get());
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        depth.setBytes(static_cast<size_t>(width) * height * 4);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color.get());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth.get());
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    void bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+        glViewport(0, 0, width, height);
+    }
+
+    // RGBA rows, bottom row first. Waits for the frame to finish.
+    void read(std::vector<uint8_t>& pixels) const
+    {
+        pixels.resize(static_cast<size_t>(width) * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.get());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+
+    void reset()
+    {
+        framebuffer.reset();
+        color.reset();
+        depth.reset();
+    }
+
+private:
+    GLFramebuffer framebuffer;
+    GLRenderbuffer color;
+    GLRenderbuffer depth;
+};
+
+// A camera placement for a render: yaw turns right from -Z, pitch looks up, both in degrees.
+struct CameraPose {
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 2.0f);
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+
+    void apply(Camera& camera) const
+    {
+        float yawRadians = glm::radians(yaw);
+        float pitchRadians = glm::radians(pitch);
+        camera.Position = position;
+        camera.Orientation = glm::vec3(std::sin(yawRadians) * std::cos(pitchRadians), std::sin(pitchRadians), -std::cos(yawRadians) * std::cos(pitchRadians));
+    }
+
+    // "x,y,z" or "x,y,z,yaw" or "x,y,z,yaw,pitch"
+    static bool Parse(const std::string& text, CameraPose& pose)
+    {
+        CameraPose parsed;
+        int fields = std::sscanf(text.c_str(), "%f,%f,%f,%f,%f", &parsed.position.x, &parsed.position.y, &parsed.position.z, &parsed.yaw, &parsed.pitch);
+        if (fields < 3)
+            return false;
+        pose = parsed;
+        return true;
+    }
+
+    // the start position of the app turned to the four sides
+    static std::vector<CameraPose> Defaults()
+    {
+        std::vector<CameraPose> poses(4);
+        for (int i = 0; i < 4; i++)
+            poses[i].yaw = 90.0f * i;
+        return poses;
+    }
+};
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef OUTLINER_H
+#define OUTLINER_H
+
+#include "imgui/imgui.h"
+
+#include "SceneStore.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+inline std::string ToLower(const std::string& text)
+{
+    std::string lower = text;
+    for (char& c : lower)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return lower;
+}
+
+// Search index and row list behind the outliner. Names match case-insensitively, anywhere in the
+// name or, with prefixOnly, at its start. An edit of the scene (revision change) regroups the objects,
+// the search index is rebuilt lazily, on the first query typed after the edit.
+// Substring queries of 3+ characters verify the shortest trigram posting list, prefix queries use a
+// sorted name array, and a query that extends the previous one only narrows the previous matches.
+// Matches are grouped by asset and flattened into rows so the view can clip them.
+class OutlinerIndex
+{
+public:
+    struct Group {
+        const Model* asset = nullptr;
+        std::string label;
+        std::vector<int> members;  // dense indices matching the query, in scene order
+        size_t total = 0;          // objects of the asset in the whole scene
+        bool open = true;
+    };
+    // a group header has index -1
+    struct Row {
+        int group;
+        int index;
+    };
+
+    // O(1) when neither the scene nor the query changed, meant to be called every frame
+    void update(const SceneStore& scene, const std::string& query, bool prefixOnly)
+    {
+        bool rebuilt = false;
+        if (!built || scene.revision() != revision)
+        {
+            rebuild(scene);
+            rebuilt = true;
+        }
+        std::string lowerQuery = ToLower(query);
+        if (!rebuilt && lowerQuery == lastQuery && prefixOnly == lastPrefix)
+            return;
+
+        bool narrowing = !rebuilt && prefixOnly == lastPrefix && !lastQuery.empty() &&
+            (prefixOnly ? lowerQuery.compare(0, lastQuery.size(), lastQuery) == 0 : lowerQuery.find(lastQuery) != std::string::npos);
+        search(scene, lowerQuery, prefixOnly, narrowing);
+        lastQuery = lowerQuery;
+        lastPrefix = prefixOnly;
+        buildRows();
+    }
+
+    const std::vector<Row>& rows() const { return rowList; }
+    const std::vector<Group>& groups() const { return groupList; }
+    size_t matchCount() const { return matches.size(); }
+
+    void setGroupOpen(int group, bool open)
+    {
+        groupList[group].open = open;
+        closedAssets[groupList[group].asset] = !open;
+        buildRows();
+    }
+
+    // row showing a dense index, -1 if it doesn't match the query or its group is closed
+    int rowOf(int index) const { return index >= 0 && index < static_cast<int>(rowIndex.size()) ? rowIndex[index] : -1; }
+
+private:
+    bool built = false;
+    bool searchable = false;  // lowerNames, sortedNames and trigrams match the scene
+    unsigned int revision = 0;
+    std::string lastQuery;
+    bool lastPrefix = false;
+
+    std::vector<std::string> lowerNames;
+    std::vector<std::pair<std::string, int>> sortedNames;      // lowercase name, dense index
+    std::unordered_map<uint32_t, std::vector<int>> trigrams;  // dense indices in ascending order
+    std::vector<int> groupOf;                                 // per dense index
+    std::vector<Group> groupList;
+    std::unordered_map<const Model*, bool> closedAssets;      // survives rebuilds
+
+    std::vector<int> matches;  // ascending dense indices
+    std::vector<Row> rowList;
+    std::vector<int> rowIndex;  // per dense index
+
+    static uint32_t Trigram(const std::string& text, size_t i)
+    {
+        return (static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16) |
+            (static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8) |
+            static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2]));
+    }
+
+    void buildSearchIndex(const SceneStore& scene)
+    {
+        searchable = true;
+        size_t count = scene.size();
+        lowerNames.resize(count);
+        sortedNames.resize(count);
+        trigrams.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            lowerNames[i] = ToLower(scene.names[i]);
+            sortedNames[i] = std::make_pair(lowerNames[i], static_cast<int>(i));
+            const std::string& name = lowerNames[i];
+            for (size_t k = 0; k + 3 <= name.size(); k++)
+            {
+                std::vector<int>& postings = trigrams[Trigram(name, k)];
+                if (postings.empty() || postings.back() != static_cast<int>(i))
+                    postings.push_back(static_cast<int>(i));
+            }
+        }
+        std::sort(sortedNames.begin(), sortedNames.end());
+    }
+
+    void rebuild(const SceneStore& scene)
+    {
+        built = true;
+        searchable = false;
+        revision = scene.revision();
+        // the dense indices moved, the old matches mean nothing now
+        lastQuery.clear();
+        size_t count = scene.size();
+
+        // one group per asset, ordered by label
+        std::unordered_map<const Model*, int> assetGroups;
+        groupList.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            const Model* asset = scene.assets[i].get();
+            if (assetGroups.emplace(asset, static_cast<int>(groupList.size())).second)
+            {
+                Group group;
+                group.asset = asset;
+                group.label = asset->objectName.empty() ? "Object" : asset->objectName;
+                auto closed = closedAssets.find(asset);
+                group.open = closed == closedAssets.end() || !closed->second;
+                groupList.push_back(group);
+            }
+        }
+        std::vector<int> order(groupList.size());
+        for (size_t g = 0; g < order.size(); g++)
+            order[g] = static_cast<int>(g);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return groupList[a].label < groupList[b].label; });
+        std::vector<Group> sortedGroups;
+        for (int g : order)
+        {
+            assetGroups[groupList[g].asset] = static_cast<int>(sortedGroups.size());
+            sortedGroups.push_back(groupList[g]);
+        }
+        groupList.swap(sortedGroups);
+
+        groupOf.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            // objects of one asset are often placed one after another
+            groupOf[i] = i > 0 && scene.assets[i] == scene.assets[i - 1] ? groupOf[i - 1] : assetGroups[scene.assets[i].get()];
+            groupList[groupOf[i]].total++;
+        }
+    }
+
+    void search(const SceneStore& scene, const std::string& query, bool prefixOnly, bool narrowing)
+    {
+        std::vector<int> previous;
+        previous.swap(matches);
+        if (!query.empty() && !searchable)
+            buildSearchIndex(scene);
+        auto matchesQuery = [&](int index) {
+            return prefixOnly ? lowerNames[index].compare(0, query.size(), query) == 0 : lowerNames[index].find(query) != std::string::npos;
+        };
+
+        if (query.empty())
+        {
+            matches.resize(scene.size());
+            for (size_t i = 0; i < matches.size(); i++)
+                matches[i] = static_cast<int>(i);
+        }
+        else if (prefixOnly)
+        {
+            // the names starting with the query are one range of the sorted array
+            auto it = std::lower_bound(sortedNames.begin(), sortedNames.end(), std::make_pair(query, -1));
+            for (; it != sortedNames.end() && it->first.compare(0, query.size(), query) == 0; ++it)
+                matches.push_back(it->second);
+            std::sort(matches.begin(), matches.end());
+        }
+        else
+        {
+            // candidates: the previous matches, the rarest trigram of the query or, for one or two
+            // characters, every name
+            const std::vector<int>* candidates = narrowing ? &previous : nullptr;
+            bool everyName = !narrowing;
+            for (size_t k = 0; k + 3 <= query.size(); k++)
+            {
+                auto postings = trigrams.find(Trigram(query, k));
+                if (postings == trigrams.end())
+                    return;
+                if (everyName || postings->second.size() < candidates->size())
+                {
+                    candidates = &postings->second;
+                    everyName = false;
+                }
+            }
+            if (everyName)
+            {
+                for (int i = 0; i < static_cast<int>(lowerNames.size()); i++)
+                    if (matchesQuery(i))
+                        matches.push_back(i);
+            }
+            else
+            {
+                for (int index : *candidates)
+                    if (matchesQuery(index))
+                        matches.push_back(index);
+            }
+        }
+    }
+
+    void buildRows()
+    {
+        for (Group& group : groupList)
+            group.members.clear();
+        for (int index : matches)
+            groupList[groupOf[index]].members.push_back(index);
+
+        rowList.clear();
+        rowIndex.assign(groupOf.size(), -1);
+        for (int g = 0; g < static_cast<int>(groupList.size()); g++)
+        {
+            const Group& group = groupList[g];
+            if (group.members.empty())
+                continue;
+            rowList.push_back(Row{ g, -1 });
+            if (!group.open)
+                continue;
+            for (int index : group.members)
+            {
+                rowIndex[index] = static_cast<int>(rowList.size());
+                rowList.push_back(Row{ g, index });
+            }
+        }
+    }
+};
+
+// Object list for large scenes: only the rows inside the view are submitted to ImGui, so a frame
+// costs the same with 10 or 100 000 objects.
+class Outliner
+{
+public:
+    OutlinerIndex index;
+
+    // contents of the outliner window, clicking a row changes the selection
+    void draw(const SceneStore& scene, SceneHandle& selected)
+    {
+        ImGui::SetNextItemWidth(-120.0f);
+        ImGui::InputTextWithHint("##search", "Search", query, sizeof(query));
+        ImGui::SameLine();
+        ImGui::Checkbox("Prefix", &prefixOnly);
+        index.update(scene, query, prefixOnly);
+        ImGui::Text("%zu / %zu objects", index.matchCount(), scene.size());
+
+        int selectedIndex = scene.indexOf(selected);
+        // an object selected in the viewport is scrolled into view once
+        bool selectionChanged = selected != shown;
+        shown = selected;
+
+        ImGui::BeginChild("rows", ImVec2(0, 0), ImGuiChildFlags_Border);
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        if (selectionChanged && index.rowOf(selectedIndex) >= 0)
+            ImGui::SetScrollY(index.rowOf(selectedIndex) * rowHeight - ImGui::GetWindowHeight() * 0.5f);
+
+        const std::vector<OutlinerIndex::Row>& rows = index.rows();
+        int toggledGroup = -1;
+        bool toggledOpen = false;
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(rows.size()), rowHeight);
+        while (clipper.Step())
+        {
+            for (int r = clipper.DisplayStart; r < clipper.DisplayEnd; r++)
+            {
+                const OutlinerIndex::Row& row = rows[r];
+                ImGui::PushID(r);
+                if (row.index < 0)
+                {
+                    const OutlinerIndex::Group& group = index.groups()[row.group];
+                    ImGui::SetNextItemOpen(group.open);
+                    bool open = ImGui::TreeNodeEx("##group", ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanAvailWidth,
+                        "%s (%zu / %zu)", group.label.c_str(), group.members.size(), group.total);
+                    if (open != group.open)
+                    {
+                        toggledGroup = row.group;
+                        toggledOpen = open;
+                    }
+                }
+                else
+                {
+                    ImGui::Indent();
+                    if (ImGui::Selectable(scene.names[row.index].c_str(), row.index == selectedIndex))
+                    {
+                        selected = scene.handleAt(row.index);
+                        shown = selected;
+                    }
+                    ImGui::Unindent();
+                }
+                ImGui::PopID();
+            }
+        }
+        // the rows are rebuilt after the loop that reads them
+        if (toggledGroup >= 0)
+            index.setGroupOpen(toggledGroup, toggledOpen);
+        ImGui::EndChild();
+    }
+
+private:
+    char query[128] = "";
+    bool prefixOnly = false;
+    SceneHandle shown;
+};
+
+#endif
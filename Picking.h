@@ -0,0 +1,37 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <glm/glm.hpp>
+
+#include "TriangleBVH.h"
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;  // normalized
+};
+
+// Ray through a window pixel (origin top left, as reported by glfwGetCursorPos), from the near
+// plane into the scene. cameraMatrix is projection * view, so no camera parameters are needed.
+inline Ray ScreenPointToRay(double x, double y, int width, int height, const glm::mat4& cameraMatrix)
+{
+    float ndcX = static_cast<float>(2.0 * x / width - 1.0);
+    float ndcY = static_cast<float>(1.0 - 2.0 * y / height);
+    glm::mat4 inverseCamera = glm::inverse(cameraMatrix);
+    glm::vec4 nearPoint = inverseCamera * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseCamera * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    Ray ray;
+    ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+    return ray;
+}
+
+// Tests a world space ray against one instance of an asset. The ray is moved into object space
+// without normalizing the direction, so t stays a world distance whatever the scale of the object.
+inline bool IntersectInstance(const TriangleBVH& bvh, const glm::mat4& inverseTransform, const Ray& ray, float maxT, float& t)
+{
+    glm::vec3 origin = glm::vec3(inverseTransform * glm::vec4(ray.origin, 1.0f));
+    glm::vec3 direction = glm::vec3(inverseTransform * glm::vec4(ray.direction, 0.0f));
+    return bvh.intersect(origin, direction, maxT, t);
+}
+
+#endif
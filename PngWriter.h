@@ -0,0 +1,133 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Minimal PNG encoder for rendered previews: 8-bit RGBA, no filtering, the zlib stream made of
+// stored (uncompressed) deflate blocks. Files are about as large as the raw pixels, in exchange
+// writing costs little more than the copy and any viewer opens them.
+namespace PngWriter {
+
+    struct CrcTable {
+        uint32_t entries[256];
+        CrcTable()
+        {
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+        }
+    };
+
+    inline uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static const CrcTable table;
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    inline uint32_t Adler32(const uint8_t* data, size_t size)
+    {
+        uint32_t a = 1, b = 0;
+        while (size > 0)
+        {
+            // the sums can't overflow within 5552 bytes, so the modulo runs once per block
+            size_t block = std::min<size_t>(size, 5552);
+            for (size_t i = 0; i < block; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += block;
+            size -= block;
+        }
+        return (b << 16) | a;
+    }
+
+    inline void PutUint32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    inline void WriteChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(data.size() + 12);
+        PutUint32(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        PutUint32(chunk, Crc32(chunk.data() + 4, data.size() + 4));
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+
+    // pixels are width * height RGBA, bottom row first when flipRows is set (glReadPixels order)
+    inline bool Write(const std::string& path, int width, int height, const std::vector<uint8_t>& pixels, bool flipRows)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file || width <= 0 || height <= 0 || pixels.size() < static_cast<size_t>(width) * height * 4)
+            return false;
+        const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<uint8_t> header;
+        PutUint32(header, static_cast<uint32_t>(width));
+        PutUint32(header, static_cast<uint32_t>(height));
+        header.push_back(8);  // bits per channel
+        header.push_back(6);  // RGBA
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(0);
+        WriteChunk(file, "IHDR", header);
+
+        // every row starts with its filter type, 0 = none
+        size_t rowBytes = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> raw;
+        raw.reserve((rowBytes + 1) * height);
+        for (int y = 0; y < height; y++)
+        {
+            const uint8_t* row = pixels.data() + rowBytes * (flipRows ? height - 1 - y : y);
+            raw.push_back(0);
+            raw.insert(raw.end(), row, row + rowBytes);
+        }
+
+        // zlib header, stored blocks of at most 65535 bytes, adler32
+        std::vector<uint8_t> data;
+        data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        data.push_back(0x78);
+        data.push_back(0x01);
+        for (size_t offset = 0;;)
+        {
+            size_t length = std::min<size_t>(65535, raw.size() - offset);
+            bool last = offset + length == raw.size();
+            data.push_back(last ? 1 : 0);
+            data.push_back(static_cast<uint8_t>(length));
+            data.push_back(static_cast<uint8_t>(length >> 8));
+            data.push_back(static_cast<uint8_t>(~length));
+            data.push_back(static_cast<uint8_t>(~length >> 8));
+            data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+            offset += length;
+            if (last)
+                break;
+        }
+        PutUint32(data, Adler32(raw.data(), raw.size()));
+        WriteChunk(file, "IDAT", data);
+        WriteChunk(file, "IEND", std::vector<uint8_t>());
+        return static_cast<bool>(file);
+    }
+}
+
+#endif
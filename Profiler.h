@@ -0,0 +1,228 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include "FramePacer.h"
+#include "GpuResources.h"
+#include "Trace.h"
+
+#include <vector>
+
+// Per frame timings of the main thread: nested CPU scopes and GL_TIME_ELAPSED queries around the
+// main GPU passes. Query results are read two frames later from a second set of queries, and only
+// once GL reports them available, so the CPU never waits for the GPU. Time elapsed queries can't
+// nest, a GPU scope opened inside another one is ignored.
+// CPU scopes and frames also go to the TraceRecorder, from every thread.
+class Profiler
+{
+public:
+    struct Scope {
+        const char* name;
+        int depth;
+        double start;  // ms since the start of the frame
+        double duration;  // ms
+    };
+    struct GpuScope {
+        const char* name;
+        double duration;  // ms
+    };
+
+    static Profiler& Get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // recent frame times in seconds, CPU from beginFrame to endFrame and the sum of the GPU scopes
+    FrameTimeStats cpuFrames{ 300 };
+    FrameTimeStats gpuFrames{ 300 };
+
+    // scopes of the last finished frame, in the order they were opened
+    const std::vector<Scope>& lastFrame() const { return finished; }
+    const std::vector<GpuScope>& lastGpuFrame() const { return gpuFinished; }
+    double lastFrameTime() const { return finishedTime; }
+    // GPU results that weren't ready when they were due and were dropped
+    size_t droppedGpuFrames() const { return dropped; }
+
+    // only the thread that calls beginFrame records scopes
+    void beginFrame()
+    {
+        ProfiledThread() = true;
+        frameStart = TraceRecorder::Now();
+        recording.clear();
+        open.clear();
+
+        // the queries of this slot were issued two frames ago
+        GpuSlot& slot = gpuSlots[gpuSlot];
+        if (slot.used > 0)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(slot.queries[slot.used - 1].get(), GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                gpuFinished.clear();
+                double total = 0.0;
+                for (int i = 0; i < slot.used; i++)
+                {
+                    GLuint64 nanoseconds = 0;
+                    glGetQueryObjectui64v(slot.queries[i].get(), GL_QUERY_RESULT, &nanoseconds);
+                    GpuScope scope = { slot.names[i], nanoseconds * 1e-6 };
+                    gpuFinished.push_back(scope);
+                    total += scope.duration;
+                }
+                gpuFrames.add(total * 1e-3);
+            }
+            else
+            {
+                dropped++;
+            }
+        }
+        slot.used = 0;
+    }
+
+    void endFrame()
+    {
+        double end = TraceRecorder::Now();
+        TraceRecorder::Get().record("Frame", "frame", frameStart, end, static_cast<long long>(frameNumber++));
+        finishedTime = (end - frameStart) * 1e-3;
+        cpuFrames.add(finishedTime * 1e-3);
+        finished.swap(recording);
+        gpuSlot = 1 - gpuSlot;
+    }
+
+    // start and end are TraceRecorder::Now() times. Returns the index to pass to endScope, -1 when
+    // the scope isn't recorded
+    int beginScope(const char* name, double start)
+    {
+        if (!ProfiledThread())
+            return -1;
+        Scope scope = { name, static_cast<int>(open.size()), (start - frameStart) * 1e-3, 0.0 };
+        open.push_back(static_cast<int>(recording.size()));
+        recording.push_back(scope);
+        return open.back();
+    }
+
+    void endScope(int index, double end)
+    {
+        // a scope still open when its frame ended is dropped
+        if (index < 0 || open.empty() || open.back() != index)
+            return;
+        recording[index].duration = (end - frameStart) * 1e-3 - recording[index].start;
+        open.pop_back();
+    }
+
+    // returns false when the scope isn't measured (nested, or outside of a frame)
+    bool beginGpuScope(const char* name)
+    {
+        if (!ProfiledThread() || gpuOpen)
+            return false;
+        GpuSlot& slot = gpuSlots[gpuSlot];
+        if (slot.used == static_cast<int>(slot.queries.size()))
+        {
+            slot.queries.push_back(GLQuery::Create("Profiler"));
+            slot.names.push_back(nullptr);
+        }
+        slot.names[slot.used] = name;
+        glBeginQuery(GL_TIME_ELAPSED, slot.queries[slot.used].get());
+        gpuOpen = true;
+        return true;
+    }
+
+    void endGpuScope()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuSlots[gpuSlot].used++;
+        gpuOpen = false;
+    }
+
+    // deletes the queries, call while the GL context still exists
+    void releaseGpu()
+    {
+        for (GpuSlot& slot : gpuSlots)
+        {
+            slot.queries.clear();
+            slot.names.clear();
+            slot.used = 0;
+        }
+    }
+
+private:
+    struct GpuSlot {
+        std::vector<GLQuery> queries;
+        std::vector<const char*> names;
+        int used = 0;
+    };
+
+    double frameStart = 0.0;  // microseconds
+    size_t frameNumber = 0;
+    std::vector<Scope> recording;
+    std::vector<Scope> finished;
+    std::vector<int> open;
+    double finishedTime = 0.0;
+
+    GpuSlot gpuSlots[2];
+    int gpuSlot = 0;
+    bool gpuOpen = false;
+    std::vector<GpuScope> gpuFinished;
+    size_t dropped = 0;
+
+    static bool& ProfiledThread()
+    {
+        thread_local bool profiled = false;
+        return profiled;
+    }
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : name(name), start(TraceRecorder::Now()), index(Profiler::Get().beginScope(name, start)) {}
+    ~ProfileScope()
+    {
+        double end = TraceRecorder::Now();
+        Profiler::Get().endScope(index, end);
+        TraceRecorder::Get().record(name, "cpu", start, end);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    double start;
+    int index;
+};
+
+class GpuProfileScope
+{
+public:
+    explicit GpuProfileScope(const char* name) : active(Profiler::Get().beginGpuScope(name)) {}
+    ~GpuProfileScope()
+    {
+        if (active)
+            Profiler::Get().endGpuScope();
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    bool active;
+};
+
+#if PROFILER_ENABLED
+// times the rest of the enclosing block, name must be a string literal
+#define PROFILE_SCOPE(name) ProfileScope TRACE_CONCAT(profileScope, __LINE__)(name)
+// times the GL commands issued in the rest of the enclosing block
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope TRACE_CONCAT(gpuProfileScope, __LINE__)(name)
+#define PROFILE_BEGIN_FRAME() Profiler::Get().beginFrame()
+#define PROFILE_END_FRAME() Profiler::Get().endFrame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,429 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// Dynamic bounding volume hierarchy over the world bounds of placed objects.
+// Every object gets a proxy (a leaf) holding a slightly enlarged box, so small moves don't touch
+// the tree at all and larger ones remove and reinsert the single leaf. Inserts pick the sibling
+// with the lowest surface area cost and the tree is kept balanced with AVL style rotations.
+// The user data of a leaf is the index of the object in the scene, see setUserData.
+class SceneBVH
+{
+public:
+    // world units added on every side of a leaf box
+    float margin = 0.1f;
+
+    SceneBVH() { clear(); }
+
+    void clear()
+    {
+        nodes.clear();
+        root = Null;
+        freeList = Null;
+        leafCount = 0;
+    }
+
+    int createProxy(const AABB& box, int userData)
+    {
+        int leaf = allocateNode();
+        nodes[leaf].box = fatten(box);
+        nodes[leaf].userData = userData;
+        nodes[leaf].height = 0;
+        insertLeaf(leaf);
+        leafCount++;
+        return leaf;
+    }
+
+    void destroyProxy(int proxy)
+    {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        leafCount--;
+    }
+
+    // call after the object moved, returns true if the leaf had to be reinserted
+    bool moveProxy(int proxy, const AABB& box)
+    {
+        if (nodes[proxy].box.contains(box))
+            return false;
+        removeLeaf(proxy);
+        nodes[proxy].box = fatten(box);
+        insertLeaf(proxy);
+        return true;
+    }
+
+    void setUserData(int proxy, int userData) { nodes[proxy].userData = userData; }
+    int getUserData(int proxy) const { return nodes[proxy].userData; }
+    const AABB& getFatBox(int proxy) const { return nodes[proxy].box; }
+
+    size_t size() const { return leafCount; }
+    int height() const { return root == Null ? 0 : nodes[root].height; }
+    AABB bounds() const { return root == Null ? AABB() : nodes[root].box; }
+
+    // Recomputes every internal box bottom-up from the leaves, after many proxies were given
+    // new boxes through setProxyBox. Cheaper than reinserting when most of the scene moved
+    // together, but the tree quality degrades if objects move far from their neighbours.
+    void setProxyBox(int proxy, const AABB& box) { nodes[proxy].box = fatten(box); }
+    void refit()
+    {
+        if (root != Null)
+            refitNode(root);
+    }
+
+    // The queries call visitor(userData) for every object whose fat box passes the test, the
+    // caller does the exact test if it needs one. They share one traversal stack, so a visitor
+    // must not start another query on the same tree.
+    template <typename Visitor>
+    void queryFrustum(const Frustum& frustum, Visitor visitor) const
+    {
+        if (root == Null)
+            return;
+        std::vector<int>& stack = scratch;
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            int test = frustum.classifyAABB(node.box);
+            if (test == 0)
+                continue;
+            if (node.isLeaf())
+            {
+                visitor(node.userData);
+                continue;
+            }
+            if (test == 2)
+            {
+                // everything below is visible, no more plane tests
+                visitLeaves(stack.size(), node.left, node.right, visitor);
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    template <typename Visitor>
+    void queryOverlap(const AABB& box, Visitor visitor) const
+    {
+        traverse([&](const AABB& node) { return node.overlaps(box); }, visitor);
+    }
+
+    template <typename Visitor>
+    void queryRadius(const glm::vec3& center, float radius, Visitor visitor) const
+    {
+        float radiusSquared = radius * radius;
+        traverse([&](const AABB& node) { return node.distanceSquared(center) <= radiusSquared; }, visitor);
+    }
+
+    // Visits the objects along the ray front to back. visitor(userData, entryT) returns the new
+    // maximum distance, e.g. the hit distance of an exact test, which prunes everything behind it.
+    template <typename Visitor>
+    void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxT, Visitor visitor) const
+    {
+        if (root == Null)
+            return;
+        glm::vec3 inverseDirection = 1.0f / direction;
+        float t;
+        if (!nodes[root].box.intersectsRay(origin, inverseDirection, maxT, t))
+            return;
+        std::vector<int>& stack = scratch;
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            int index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+            // the box may be further than a hit found since it was pushed
+            if (!node.box.intersectsRay(origin, inverseDirection, maxT, t))
+                continue;
+            if (node.isLeaf())
+            {
+                maxT = std::min(maxT, visitor(node.userData, t));
+                continue;
+            }
+            float tLeft, tRight;
+            bool hitLeft = nodes[node.left].box.intersectsRay(origin, inverseDirection, maxT, tLeft);
+            bool hitRight = nodes[node.right].box.intersectsRay(origin, inverseDirection, maxT, tRight);
+            // push the far child first so the near one is visited first
+            if (hitLeft && hitRight)
+            {
+                stack.push_back(tLeft <= tRight ? node.right : node.left);
+                stack.push_back(tLeft <= tRight ? node.left : node.right);
+            }
+            else if (hitLeft)
+                stack.push_back(node.left);
+            else if (hitRight)
+                stack.push_back(node.right);
+        }
+    }
+
+private:
+    static const int Null = -1;
+
+    struct Node {
+        AABB box;
+        int parent = Null;  // next free node while on the free list
+        int left = Null;
+        int right = Null;
+        int height = 0;     // leaves are 0, free nodes -1
+        int userData = -1;
+
+        bool isLeaf() const { return left == Null; }
+    };
+
+    std::vector<Node> nodes;
+    int root;
+    int freeList;
+    size_t leafCount;
+    // traversal stack, kept to avoid allocating on every query
+    mutable std::vector<int> scratch;
+
+    AABB fatten(const AABB& box) const
+    {
+        return AABB(box.min - glm::vec3(margin), box.max + glm::vec3(margin));
+    }
+
+    template <typename Test, typename Visitor>
+    void traverse(Test test, Visitor& visitor) const
+    {
+        if (root == Null)
+            return;
+        std::vector<int>& stack = scratch;
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (!test(node.box))
+                continue;
+            if (node.isLeaf())
+            {
+                visitor(node.userData);
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    // visits every leaf under the two nodes using the top of the shared stack, which is left as it was
+    template <typename Visitor>
+    void visitLeaves(size_t base, int left, int right, Visitor& visitor) const
+    {
+        std::vector<int>& stack = scratch;
+        stack.push_back(left);
+        stack.push_back(right);
+        while (stack.size() > base)
+        {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.isLeaf())
+            {
+                visitor(node.userData);
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    int allocateNode()
+    {
+        if (freeList == Null)
+        {
+            nodes.push_back(Node());
+            return static_cast<int>(nodes.size()) - 1;
+        }
+        int index = freeList;
+        freeList = nodes[index].parent;
+        nodes[index] = Node();
+        return index;
+    }
+
+    void freeNode(int index)
+    {
+        nodes[index].parent = freeList;
+        nodes[index].height = -1;
+        freeList = index;
+    }
+
+    void insertLeaf(int leaf)
+    {
+        if (root == Null)
+        {
+            root = leaf;
+            nodes[root].parent = Null;
+            return;
+        }
+
+        // walk down to the sibling that increases the total surface area the least
+        AABB leafBox = nodes[leaf].box;
+        int index = root;
+        while (!nodes[index].isLeaf())
+        {
+            const Node& node = nodes[index];
+            AABB combined = node.box;
+            combined.expand(leafBox);
+            float area = node.box.area();
+            float combinedArea = combined.area();
+            // cost of making a new parent for this node and the leaf
+            float cost = 2.0f * combinedArea;
+            // minimum cost of pushing the leaf further down
+            float inheritanceCost = 2.0f * (combinedArea - area);
+
+            float costLeft = descendCost(node.left, leafBox) + inheritanceCost;
+            float costRight = descendCost(node.right, leafBox) + inheritanceCost;
+            if (cost < costLeft && cost < costRight)
+                break;
+            index = costLeft < costRight ? node.left : node.right;
+        }
+        int sibling = index;
+
+        int oldParent = nodes[sibling].parent;
+        int newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].box = nodes[sibling].box;
+        nodes[newParent].box.expand(leafBox);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].left = sibling;
+        nodes[newParent].right = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+        if (oldParent == Null)
+            root = newParent;
+        else if (nodes[oldParent].left == sibling)
+            nodes[oldParent].left = newParent;
+        else
+            nodes[oldParent].right = newParent;
+
+        fixUpwards(nodes[leaf].parent);
+    }
+
+    float descendCost(int child, const AABB& leafBox) const
+    {
+        AABB combined = nodes[child].box;
+        combined.expand(leafBox);
+        if (nodes[child].isLeaf())
+            return combined.area();
+        return combined.area() - nodes[child].box.area();
+    }
+
+    void removeLeaf(int leaf)
+    {
+        if (leaf == root)
+        {
+            root = Null;
+            return;
+        }
+        int parent = nodes[leaf].parent;
+        int grandParent = nodes[parent].parent;
+        int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+        // the sibling takes the place of the parent
+        if (grandParent == Null)
+        {
+            root = sibling;
+            nodes[sibling].parent = Null;
+        }
+        else
+        {
+            if (nodes[grandParent].left == parent)
+                nodes[grandParent].left = sibling;
+            else
+                nodes[grandParent].right = sibling;
+            nodes[sibling].parent = grandParent;
+        }
+        freeNode(parent);
+        fixUpwards(grandParent);
+    }
+
+    // rebalances and refits the ancestors of a changed node
+    void fixUpwards(int index)
+    {
+        while (index != Null)
+        {
+            index = balance(index);
+            Node& node = nodes[index];
+            node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+            node.box = nodes[node.left].box;
+            node.box.expand(nodes[node.right].box);
+            index = node.parent;
+        }
+    }
+
+    // rotates the taller grandchild up when the children heights differ by more than one,
+    // returns the node now at the position of index
+    int balance(int a)
+    {
+        if (nodes[a].isLeaf() || nodes[a].height < 2)
+            return a;
+        int b = nodes[a].left;
+        int c = nodes[a].right;
+        int difference = nodes[c].height - nodes[b].height;
+        if (difference > 1)
+            return rotate(a, c, b, false);
+        if (difference < -1)
+            return rotate(a, b, c, true);
+        return a;
+    }
+
+    // lifts child (a child of a) into the place of a, other is the other child of a
+    int rotate(int a, int child, int other, bool childIsLeft)
+    {
+        int f = nodes[child].left;
+        int g = nodes[child].right;
+
+        nodes[child].left = a;
+        nodes[child].parent = nodes[a].parent;
+        nodes[a].parent = child;
+        int parent = nodes[child].parent;
+        if (parent == Null)
+            root = child;
+        else if (nodes[parent].left == a)
+            nodes[parent].left = child;
+        else
+            nodes[parent].right = child;
+
+        // the taller grandchild stays with child, the other one replaces child under a
+        int keep = nodes[f].height > nodes[g].height ? f : g;
+        int give = keep == f ? g : f;
+        nodes[child].right = keep;
+        if (childIsLeft)
+            nodes[a].left = give;
+        else
+            nodes[a].right = give;
+        nodes[give].parent = a;
+
+        nodes[a].box = nodes[other].box;
+        nodes[a].box.expand(nodes[give].box);
+        nodes[a].height = 1 + std::max(nodes[other].height, nodes[give].height);
+        nodes[child].box = nodes[a].box;
+        nodes[child].box.expand(nodes[keep].box);
+        nodes[child].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+        return child;
+    }
+
+    void refitNode(int index)
+    {
+        Node& node = nodes[index];
+        if (node.isLeaf())
+            return;
+        refitNode(node.left);
+        refitNode(node.right);
+        node.box = nodes[node.left].box;
+        node.box.expand(nodes[node.right].box);
+    }
+};
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef SCENE_STORE_H
+#define SCENE_STORE_H
+
+#include "Model.h"
+#include "NameRegistry.h"
+#include "SceneBVH.h"
+#include "TransformStore.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Stable reference to an object of the scene, safe to keep across frames (selection, undo).
+// Slots are reused after an object is removed, the generation makes the old handles stop resolving.
+struct SceneHandle {
+    unsigned int slot = 0xffffffffu;
+    unsigned int generation = 0;
+
+    bool operator==(const SceneHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const SceneHandle& other) const { return !(*this == other); }
+};
+
+// The placed objects. Components live in dense arrays, index i of every array belongs to the same
+// object, so per frame loops run over contiguous memory. Removing swaps the last object into the
+// hole: O(1), but dense indices change, keep a SceneHandle to refer to an object.
+// Objects placed from the same file share one Model (meshes, textures, picking data), see AssetLibrary.
+class SceneStore
+{
+public:
+    TransformStore transforms;
+    std::vector<std::shared_ptr<Model>> assets;
+    std::vector<std::string> names;
+    // the texture name saved with each object, per object because assets are shared
+    std::vector<std::string> textureNames;
+
+    size_t size() const { return names.size(); }
+    // changes whenever objects are added or removed, lets views over the dense arrays know they are stale
+    unsigned int revision() const { return changes; }
+
+    // name is used as the base of a unique name when it is already taken, see NameRegistry.
+    // An empty name becomes "Object".
+    SceneHandle add(std::shared_ptr<Model> asset, const std::string& name, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale,
+        const std::string& textureName = std::string())
+    {
+        MEMORY_SCOPE(Scene);
+        unsigned int slot;
+        if (freeHead != None)
+        {
+            slot = freeHead;
+            freeHead = slots[slot].dense;
+        }
+        else
+        {
+            slot = static_cast<unsigned int>(slots.size());
+            slots.push_back(Slot());
+        }
+        slots[slot].dense = static_cast<unsigned int>(size());
+
+        assets.push_back(std::move(asset));
+        names.push_back(nameRegistry.unique(name.empty() ? "Object" : name));
+        nameRegistry.insert(names.back());
+        textureNames.push_back(textureName);
+        denseSlots.push_back(slot);
+        proxies.push_back(-1);
+        transforms.add(position, rotation, scale);
+        changes++;
+        // creates the BVH leaf
+        update();
+
+        SceneHandle handle;
+        handle.slot = slot;
+        handle.generation = slots[slot].generation;
+        return handle;
+    }
+
+    // returns false for a handle that no longer resolves
+    bool remove(SceneHandle handle)
+    {
+        int index = indexOf(handle);
+        if (index < 0)
+            return false;
+        bvh.destroyProxy(proxies[index]);
+        nameRegistry.release(names[index]);
+
+        size_t last = size() - 1;
+        if (static_cast<size_t>(index) != last)
+        {
+            assets[index] = std::move(assets[last]);
+            names[index] = std::move(names[last]);
+            textureNames[index] = std::move(textureNames[last]);
+            proxies[index] = proxies[last];
+            denseSlots[index] = denseSlots[last];
+            slots[denseSlots[index]].dense = static_cast<unsigned int>(index);
+        }
+        assets.pop_back();
+        names.pop_back();
+        textureNames.pop_back();
+        proxies.pop_back();
+        denseSlots.pop_back();
+        transforms.remove(index);
+
+        slots[handle.slot].generation++;
+        slots[handle.slot].dense = freeHead;
+        freeHead = handle.slot;
+        changes++;
+        return true;
+    }
+
+    void clear()
+    {
+        transforms.clear();
+        assets.clear();
+        names.clear();
+        textureNames.clear();
+        nameRegistry.clear();
+        denseSlots.clear();
+        proxies.clear();
+        bvh.clear();
+        changes++;
+        // the generations are kept so handles from before the clear stay invalid
+        freeHead = None;
+        for (unsigned int slot = static_cast<unsigned int>(slots.size()); slot-- > 0;)
+        {
+            slots[slot].generation++;
+            slots[slot].dense = freeHead;
+            freeHead = slot;
+        }
+    }
+
+    // dense index of the object, -1 if it has been removed
+    int indexOf(SceneHandle handle) const
+    {
+        if (handle.slot >= slots.size() || slots[handle.slot].generation != handle.generation)
+            return -1;
+        return static_cast<int>(slots[handle.slot].dense);
+    }
+
+    bool contains(SceneHandle handle) const { return indexOf(handle) >= 0; }
+
+    SceneHandle handleAt(size_t index) const
+    {
+        SceneHandle handle;
+        handle.slot = denseSlots[index];
+        handle.generation = slots[handle.slot].generation;
+        return handle;
+    }
+
+    // rebuilds the matrices of the objects that moved since the last call and refits their BVH leaves
+    void update()
+    {
+        MEMORY_SCOPE(Scene);
+        transforms.update([this](size_t index) {
+            if (proxies[index] < 0)
+                proxies[index] = bvh.createProxy(worldBounds(index), static_cast<int>(denseSlots[index]));
+            else
+                bvh.moveProxy(proxies[index], worldBounds(index));
+        });
+    }
+
+    // world bounds from the cached matrix, a mesh-less asset counts as a point at the object origin
+    AABB worldBounds(size_t index) const
+    {
+        AABB local = assets[index]->localBounds();
+        if (local.empty())
+            local = AABB(glm::vec3(0.0f), glm::vec3(0.0f));
+        return local.transformed(transforms.world(index));
+    }
+
+    int bvhHeight() const { return bvh.height(); }
+
+    // BVH queries, the visitors get dense indices (the tree itself stores slots, which never move)
+    template <typename Visitor>
+    void queryFrustum(const Frustum& frustum, Visitor visitor) const
+    {
+        bvh.queryFrustum(frustum, [&](int slot) { visitor(static_cast<int>(slots[slot].dense)); });
+    }
+
+    template <typename Visitor>
+    void queryOverlap(const AABB& box, Visitor visitor) const
+    {
+        bvh.queryOverlap(box, [&](int slot) { visitor(static_cast<int>(slots[slot].dense)); });
+    }
+
+    template <typename Visitor>
+    void queryRadius(const glm::vec3& center, float radius, Visitor visitor) const
+    {
+        bvh.queryRadius(center, radius, [&](int slot) { visitor(static_cast<int>(slots[slot].dense)); });
+    }
+
+    template <typename Visitor>
+    void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxT, Visitor visitor) const
+    {
+        bvh.queryRay(origin, direction, maxT, [&](int slot, float t) { return visitor(static_cast<int>(slots[slot].dense), t); });
+    }
+
+private:
+    static const unsigned int None = 0xffffffffu;
+
+    struct Slot {
+        unsigned int dense = None;  // next free slot while the slot is free
+        unsigned int generation = 0;
+    };
+
+    std::vector<Slot> slots;
+    unsigned int freeHead = None;
+    unsigned int changes = 0;
+    // per dense index
+    std::vector<unsigned int> denseSlots;
+    std::vector<int> proxies;
+    SceneBVH bvh;
+    NameRegistry nameRegistry;
+};
+
+// Models shared by every object placed from the same file with the same textures. Only weak
+// references are kept, an asset is unloaded once the last object using it is deleted.
+class AssetLibrary
+{
+public:
+    static AssetLibrary& Get()
+    {
+        static AssetLibrary library;
+        return library;
+    }
+
+    std::shared_ptr<Model> find(const std::string& key) const
+    {
+        auto it = assets.find(key);
+        return it != assets.end() ? it->second.lock() : std::shared_ptr<Model>();
+    }
+
+    std::shared_ptr<Model> insert(const std::string& key, Model model)
+    {
+        for (auto it = assets.begin(); it != assets.end();)
+        {
+            if (it->second.expired())
+                it = assets.erase(it);
+            else
+                ++it;
+        }
+        std::shared_ptr<Model> shared = std::make_shared<Model>(std::move(model));
+        assets[key] = shared;
+        return shared;
+    }
+
+    // the assets currently used by the scene, in key order
+    std::vector<std::pair<std::string, std::shared_ptr<Model>>> live() const
+    {
+        std::vector<std::pair<std::string, std::shared_ptr<Model>>> result;
+        for (const auto& entry : assets)
+        {
+            std::shared_ptr<Model> model = entry.second.lock();
+            if (model)
+                result.push_back(std::make_pair(entry.first, model));
+        }
+        return result;
+    }
+
+private:
+    std::map<std::string, std::weak_ptr<Model>> assets;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "GpuResources.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -13,6 +15,7 @@
 class Shader
 {
 public:
+    // id of the linked program, owned by program (shaders are move-only)
     unsigned int ID;
     std::string vertexShaderPath;
     std::string fragmentShaderPath;
@@ -28,6 +31,36 @@ public:
     glm::mat2 mat2Value;
     //default constructor
     Shader():ID(0) {}
+
+    Shader(Shader&& other) noexcept
+        : ID(other.ID), vertexShaderPath(std::move(other.vertexShaderPath)), fragmentShaderPath(std::move(other.fragmentShaderPath)),
+        vec4Value(other.vec4Value), vec3Value(other.vec3Value), vec2Value(other.vec2Value), fVal(other.fVal), iVal(other.iVal), bVal(other.bVal),
+        mat4Value(other.mat4Value), mat3Value(other.mat3Value), mat2Value(other.mat2Value), program(std::move(other.program))
+    {
+        other.ID = 0;
+    }
+
+    Shader& operator=(Shader&& other) noexcept
+    {
+        if (this != &other)
+        {
+            program = std::move(other.program);
+            ID = other.ID;
+            other.ID = 0;
+            vertexShaderPath = std::move(other.vertexShaderPath);
+            fragmentShaderPath = std::move(other.fragmentShaderPath);
+            vec4Value = other.vec4Value;
+            vec3Value = other.vec3Value;
+            vec2Value = other.vec2Value;
+            fVal = other.fVal;
+            iVal = other.iVal;
+            bVal = other.bVal;
+            mat4Value = other.mat4Value;
+            mat3Value = other.mat3Value;
+            mat2Value = other.mat2Value;
+        }
+        return *this;
+    }
     Shader(const char* vertexPath, const char* fragmentPath)
     {
         // 1. retrieve the vertex/fragment source code from filePath
@@ -78,7 +111,8 @@ public:
         checkCompileErrors(fragment, "FRAGMENT");
 
         // shader Program
-        ID = glCreateProgram();
+        program = GLProgram::Create("shader " + vertexShaderPath);
+        ID = program.get();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
@@ -200,8 +234,9 @@ public:
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
 
-        // Shader Program
-        ID = glCreateProgram();
+        // Shader Program, replacing the handle deletes the previous program
+        program = GLProgram::Create("shader " + vertexShaderPath);
+        ID = program.get();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
@@ -213,6 +248,8 @@ public:
     }
 
 private:
+    GLProgram program;
+
     void readShaderCode(const std::string& path, std::string& shaderCode) {
         std::ifstream shaderFile;
         shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
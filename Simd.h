@@ -0,0 +1,13 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is always available on x64 (and on x86 builds compiled with /arch:SSE2),
+// every SIMD kernel in the project has a scalar fallback for other targets.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#endif
+
+#endif
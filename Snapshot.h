@@ -2,7 +2,9 @@
 #define MODEL_SNAPSHOT_H
 
 #include <iostream>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <glm/glm.hpp>
 #include "Model.h"  
@@ -64,7 +66,11 @@ struct MeshSnapshot {
         is.read(reinterpret_cast<char*>(&texturesSize), sizeof(texturesSize));
         textures.resize(texturesSize);
         for (auto& texture : textures) {
-            is.read(reinterpret_cast<char*>(&texture), sizeof(Texture));
+            // the records are raw Texture bytes, the strings inside them are dangling pointers
+            // from the writing process so only the id is kept
+            char record[sizeof(Texture)];
+            is.read(record, sizeof(Texture));
+            std::memcpy(&texture.id, record + offsetof(Texture, id), sizeof(texture.id));
         }
     }
 
@@ -139,23 +145,16 @@ struct ModelSnapshot {
         : position(model.getPosition()),
         rotation(model.getRotation()),
         scale(model.getScale()),
+        objectName(model.objectName),
         modelFilePath(model.getFilePath()) {
-        for (const auto& mesh : model.meshes) {  
-            meshes.push_back(MeshSnapshot(mesh));
-        }
+        // the geometry is not copied, it is reloaded from modelFilePath so meshes stay empty.
+        // Files written by older versions embed it and deserialize still reads it.
         textures = model.textures_loaded;
         shader = ShaderSnapshot(model.getShader());
 
     }
 
 
-    // apply this snapshot to a Model
-    void applyToModel(Model& model) const {
-        model.setPosition(position);
-        model.setRotation(rotation);
-        model.setScale(scale);
-    }
-
     // serialize the snapshot to an output stream
     void serialize(std::ostream& os) const {
         os.write(reinterpret_cast<const char*>(&position), sizeof(position));
@@ -223,8 +222,8 @@ struct ModelSnapshot {
         }
         textures.resize(sizeTextures);
         for (auto& texture : textures) {
+            // uploaded by the loader, which shares it with the other models using the same file
             texture.path = deserializeString(is);
-            texture.id = TextureFromFile(texture.path.c_str(), "resources/objects/");
         }
         
     }
@@ -269,4 +268,11 @@ struct ModelSnapshot {
         }
 };
 
+// a scene file starts with the name of its room preset, the ModelSnapshots of its objects follow
+inline void WriteSceneHeader(std::ostream& os, const std::string& roomModel) {
+    size_t roomModelLength = roomModel.length();
+    os.write(reinterpret_cast<const char*>(&roomModelLength), sizeof(roomModelLength));
+    os.write(roomModel.c_str(), roomModelLength);
+}
+
 #endif // MODEL_SNAPSHOT_H
@@ -0,0 +1,185 @@
+#ifndef STRESS_SCENE_H
+#define STRESS_SCENE_H
+
+#include <glm/glm.hpp>
+
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic scenes for scalability tests, written in the format of saved scenes so --render,
+// --batch and --bench-flythrough read them like any other. The nine furniture files are too few
+// to stress the asset cache, so every (file, texture) pair counts as its own asset the way
+// AssetKey tells them apart.
+namespace StressScene {
+
+    // a furniture file and how the Generate menu places it
+    struct Asset {
+        std::string file;  // path from the working directory
+        std::string texture;
+        float scale;
+        float rotationZ;
+        std::string name;
+    };
+
+    enum class Layout { Grid, Uniform, Clustered };
+
+    inline const char* LayoutName(Layout layout)
+    {
+        switch (layout)
+        {
+        case Layout::Grid: return "grid";
+        case Layout::Uniform: return "uniform";
+        case Layout::Clustered: return "clustered";
+        }
+        return "";
+    }
+
+    inline bool ParseLayout(const std::string& name, Layout& layout)
+    {
+        for (Layout candidate : { Layout::Grid, Layout::Uniform, Layout::Clustered })
+        {
+            if (name == LayoutName(candidate))
+            {
+                layout = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct Options {
+        int objects = 1000;
+        float uniqueRatio = 0.05f;  // distinct assets per object, at least one and at most every pair
+        Layout layout = Layout::Uniform;
+        float extent = 10.0f;  // objects stay within [-extent, extent] on X and Z
+        float rotationJitter = 180.0f;  // degrees around Y, either way
+        float scaleJitter = 0.2f;  // relative, either way
+        uint32_t seed = 1;
+        std::string room = "room.fbx";
+    };
+
+    // The same seed gives the same scene with every compiler: the distributions of <random> differ
+    // between standard libraries, only the mt19937 sequence itself is specified.
+    class Random
+    {
+    public:
+        explicit Random(uint32_t seed) : engine(seed) {}
+
+        // [0, 1)
+        float next() { return (engine() >> 8) * (1.0f / 16777216.0f); }
+        float range(float low, float high) { return low + (high - low) * next(); }
+        float gaussian()
+        {
+            float u = std::max(next(), 1e-7f);
+            return std::sqrt(-2.0f * std::log(u)) * std::cos(6.2831853f * next());
+        }
+
+    private:
+        std::mt19937 engine;
+    };
+
+    // the textures of the catalog, each once, in catalog order
+    inline std::vector<std::string> Textures(const std::vector<Asset>& catalog)
+    {
+        std::vector<std::string> textures;
+        for (const Asset& asset : catalog)
+        {
+            if (std::find(textures.begin(), textures.end(), asset.texture) == textures.end())
+                textures.push_back(asset.texture);
+        }
+        return textures;
+    }
+
+    // number of distinct assets the options give with this catalog
+    inline int UniqueAssets(const Options& options, const std::vector<Asset>& catalog)
+    {
+        int pairs = static_cast<int>(catalog.size() * std::max<size_t>(Textures(catalog).size(), 1));
+        int wanted = static_cast<int>(std::lround(options.uniqueRatio * options.objects));
+        return std::max(1, std::min({ wanted, pairs, std::max(options.objects, 1) }));
+    }
+
+    // snapshots of the generated objects, in the order they are written
+    inline std::vector<ModelSnapshot> Generate(const Options& options, const std::vector<Asset>& catalog)
+    {
+        std::vector<ModelSnapshot> objects;
+        if (catalog.empty() || options.objects <= 0)
+            return objects;
+
+        // the first variants are the catalog as it is, further ones swap in the other textures
+        std::vector<std::string> textures = Textures(catalog);
+        int variants = UniqueAssets(options, catalog);
+
+        Random random(options.seed);
+        std::vector<glm::vec2> clusters;
+        if (options.layout == Layout::Clustered)
+        {
+            // about fifty objects per cluster
+            for (int i = 0; i < std::max(1, options.objects / 50); i++)
+                clusters.push_back(glm::vec2(random.range(-options.extent, options.extent), random.range(-options.extent, options.extent)));
+        }
+        int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(options.objects))));
+        float spacing = side > 1 ? 2.0f * options.extent / (side - 1) : 0.0f;
+
+        objects.reserve(options.objects);
+        for (int i = 0; i < options.objects; i++)
+        {
+            int variant = i % variants;
+            const Asset& asset = catalog[variant % catalog.size()];
+            size_t ownTexture = std::find(textures.begin(), textures.end(), asset.texture) - textures.begin();
+            const std::string& texture = textures[(ownTexture + variant / catalog.size()) % textures.size()];
+
+            glm::vec2 position;
+            switch (options.layout)
+            {
+            case Layout::Grid:
+                position = side > 1 ? glm::vec2(-options.extent + (i % side) * spacing, -options.extent + (i / side) * spacing) : glm::vec2(0.0f);
+                break;
+            case Layout::Uniform:
+                position = glm::vec2(random.range(-options.extent, options.extent), random.range(-options.extent, options.extent));
+                break;
+            case Layout::Clustered:
+            {
+                glm::vec2 center = clusters[static_cast<size_t>(random.next() * clusters.size())];
+                glm::vec2 offset(random.gaussian(), random.gaussian());
+                position = glm::clamp(center + offset * (0.1f * options.extent), glm::vec2(-options.extent), glm::vec2(options.extent));
+                break;
+            }
+            }
+
+            ModelSnapshot object;
+            object.position = glm::vec3(position.x, 0.0f, position.y);
+            object.rotation = glm::vec3(0.0f, glm::radians(random.range(-options.rotationJitter, options.rotationJitter)), asset.rotationZ);
+            object.scale = glm::vec3(asset.scale * random.range(1.0f - options.scaleJitter, 1.0f + options.scaleJitter));
+            object.modelFilePath = asset.file;
+            object.objectName = asset.name;
+            Texture diffuse;
+            diffuse.id = 0;
+            diffuse.type = "texture_diffuse";
+            diffuse.path = texture;
+            object.textures.push_back(diffuse);
+            objects.push_back(object);
+        }
+        return objects;
+    }
+
+    // a scene file like the one saveGameState writes
+    inline bool Write(const std::string& path, const std::string& room, const std::vector<ModelSnapshot>& objects)
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+            return false;
+        WriteSceneHeader(out, room);
+        for (const ModelSnapshot& object : objects)
+            object.serialize(out);
+        return static_cast<bool>(out);
+    }
+}
+
+#endif
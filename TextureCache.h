@@ -0,0 +1,209 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+
+#include "GpuResources.h"
+#include "LoadTelemetry.h"
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// decoded pixels of an image file, stbi_load is thread safe so decoding can run on the thread pool.
+// When the cache has a compressed copy the context can sample, that is loaded instead of pixels.
+struct ImageData {
+    unsigned char* pixels = nullptr;
+    TextureCompression::CompressedTexture compressed;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    // load telemetry, filled by DecodeImage and UploadTexture
+    size_t fileBytes = 0;
+    double readMs = 0.0;
+    double decodeMs = 0.0;
+    double uploadMs = 0.0;
+    double mipMs = 0.0;
+};
+
+// directory + '/' + path, without doubling the separator
+inline std::string ImagePath(const char* path, const std::string& directory)
+{
+    if (directory.empty())
+        return path;
+    char last = directory.back();
+    return (last == '/' || last == '\\') ? directory + path : directory + '/' + path;
+}
+
+// The file is read whole before decoding so the disk and the decoder are timed apart. A fresh
+// compressed copy from --compress-textures is used as is, there is nothing to decode.
+inline ImageData DecodeImage(const char* path, const std::string& directory)
+{
+    std::string filename = ImagePath(path, directory);
+
+    ImageData image;
+    double start = TraceRecorder::Now();
+    if (TextureCompression::LoadFresh(filename, image.compressed, image.fileBytes))
+    {
+        image.width = image.compressed.width;
+        image.height = image.compressed.height;
+        image.components = TextureCompression::Info(image.compressed.format).alpha ? 4 : 3;
+        image.readMs = (TraceRecorder::Now() - start) * 1e-3;
+        return image;
+    }
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return image;
+    std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+    if (!file)
+        return image;
+    image.fileBytes = bytes.size();
+    double read = TraceRecorder::Now();
+    image.readMs = (read - start) * 1e-3;
+    image.pixels = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &image.width, &image.height, &image.components, 0);
+    image.decodeMs = (TraceRecorder::Now() - read) * 1e-3;
+    return image;
+}
+
+// the telemetry of a texture decoded and uploaded for load, see Model::loadModel
+inline void RecordTextureLoad(const ImageData& image, AssetLoadRecord& load)
+{
+    load.bytesRead += image.fileBytes;
+    load.textureReadMs += image.readMs;
+    load.decodeMs += image.decodeMs;
+    load.textureUploadMs += image.uploadMs;
+    load.mipMs += image.mipMs;
+    if (image.width > 0)
+        load.addTexture(image.width, image.height, image.components);
+}
+
+// creates a GL texture from decoded pixels and frees them, must be called on the GL thread
+inline GLTexture UploadTexture(ImageData& image, const std::string& filename)
+{
+    GLTexture texture = GLTexture::Create("texture " + filename);
+
+    if (!image.compressed.levels.empty())
+    {
+        const TextureCompression::CompressedTexture& compressed = image.compressed;
+        GLenum format = TextureCompression::Info(compressed.format).glFormat;
+        double start = TraceRecorder::Now();
+        glBindTexture(GL_TEXTURE_2D, texture.get());
+        int width = compressed.width, height = compressed.height;
+        for (size_t level = 0; level < compressed.levels.size(); level++)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, width, height, 0,
+                static_cast<GLsizei>(compressed.levels[level].size()), compressed.levels[level].data());
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(compressed.levels.size()) - 1);
+        image.uploadMs = (TraceRecorder::Now() - start) * 1e-3;
+        texture.setBytes(compressed.bytes());
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        image.compressed = TextureCompression::CompressedTexture();
+    }
+    else if (image.pixels)
+    {
+        GLenum format;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 3)
+            format = GL_RGB;
+        else if (image.components == 4)
+            format = GL_RGBA;
+
+        double start = TraceRecorder::Now();
+        glBindTexture(GL_TEXTURE_2D, texture.get());
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+        double uploaded = TraceRecorder::Now();
+        glGenerateMipmap(GL_TEXTURE_2D);
+        image.uploadMs = (uploaded - start) * 1e-3;
+        image.mipMs = (TraceRecorder::Now() - uploaded) * 1e-3;
+        // the mip chain adds a third on top of the base level
+        texture.setBytes(static_cast<size_t>(image.width) * image.height * image.components * 4 / 3);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << filename << std::endl;
+    }
+
+    return texture;
+}
+
+// Textures shared by file name. The cache only holds weak references: a texture is deleted as soon
+// as the last model using it goes away and decoded again if it is needed later.
+class TextureCache
+{
+public:
+    static TextureCache& Get()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<GLTexture> find(const std::string& filename) const
+    {
+        auto it = textures.find(filename);
+        return it != textures.end() ? it->second.lock() : std::shared_ptr<GLTexture>();
+    }
+
+    std::shared_ptr<GLTexture> insert(const std::string& filename, GLTexture texture)
+    {
+        // drop the entries of textures that have been deleted since the last insert
+        for (auto it = textures.begin(); it != textures.end();)
+        {
+            if (it->second.expired())
+                it = textures.erase(it);
+            else
+                ++it;
+        }
+        std::shared_ptr<GLTexture> shared = std::make_shared<GLTexture>(std::move(texture));
+        textures[filename] = shared;
+        return shared;
+    }
+
+private:
+    std::map<std::string, std::weak_ptr<GLTexture>> textures;
+};
+
+// loads an image file into a texture, or returns the one already loaded from the same file
+inline std::shared_ptr<GLTexture> TextureFromFile(const char* path, const std::string& directory, bool gamma = false)
+{
+    std::string filename = ImagePath(path, directory);
+    std::shared_ptr<GLTexture> texture = TextureCache::Get().find(filename);
+    if (texture)
+        return texture;
+    double start = TraceRecorder::Now();
+    ImageData image = DecodeImage(path, directory);
+    std::shared_ptr<GLTexture> loaded = TextureCache::Get().insert(filename, UploadTexture(image, filename));
+    AssetLoadRecord load;
+    load.path = filename;
+    load.source = "texture";
+    RecordTextureLoad(image, load);
+    load.totalMs = (TraceRecorder::Now() - start) * 1e-3;
+    LoadTelemetry::Get().add(load);
+    return loaded;
+}
+
+#endif
@@ -0,0 +1,1145 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <glad/glad.h>
+
+#include "AssetCache.h"
+#include "Ktx2.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// not in the core 3.3 headers, the formats come from extensions
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+// Offline block compression of textures into KTX2 files in the asset cache, and the runtime side
+// that picks a file the context can sample. Every format works on 4x4 blocks:
+//   BC1        RGB, 8 bytes, two 565 endpoints and 2-bit indices
+//   BC3        RGBA, BC1 colors after an 8 byte alpha block
+//   BC7        RGBA, 16 bytes, mode 6 only (one subset, 7777 endpoints + p-bits, 4-bit indices)
+//   ETC2 RGB   8 bytes, written in the ETC1 individual and differential modes, which ETC2 decodes the same
+//   ETC2 RGBA  ETC2 RGB after an 8 byte EAC alpha block
+// The encoders are straightforward (principal axis, one least squares refinement) rather than
+// exhaustive, and the decoders only cover the modes the encoders write.
+namespace TextureCompression {
+
+    enum class Format { BC1, BC3, BC7, ETC2RGB, ETC2RGBA, Count };
+
+    struct FormatInfo {
+        const char* name;
+        uint32_t vkFormat;
+        GLenum glFormat;
+        uint32_t blockBytes;
+        bool alpha;
+    };
+
+    inline const FormatInfo& Info(Format format)
+    {
+        static const FormatInfo infos[] = {
+            { "bc1", 131, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, false },  // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+            { "bc3", 137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, true },  // VK_FORMAT_BC3_UNORM_BLOCK
+            { "bc7", 145, GL_COMPRESSED_RGBA_BPTC_UNORM, 16, true },  // VK_FORMAT_BC7_UNORM_BLOCK
+            { "etc2", 147, GL_COMPRESSED_RGB8_ETC2, 8, false },  // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+            { "etc2a", 151, GL_COMPRESSED_RGBA8_ETC2_EAC, 16, true },  // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+        };
+        return infos[static_cast<int>(format)];
+    }
+
+    inline bool FormatFromVk(uint32_t vkFormat, Format& format)
+    {
+        for (int i = 0; i < static_cast<int>(Format::Count); i++)
+        {
+            if (Info(static_cast<Format>(i)).vkFormat == vkFormat)
+            {
+                format = static_cast<Format>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline std::vector<uint32_t> Descriptor(Format format)
+    {
+        // Khronos data format color models and channels of the block formats
+        const uint32_t modelBC1 = 128, modelBC3 = 130, modelBC7 = 134, modelETC2 = 161;
+        const uint32_t color = 0, etc2Color = 2, alpha = 15;
+        uint32_t blockBytes = Info(format).blockBytes;
+        switch (format)
+        {
+        case Format::BC1: return Ktx2::BlockDescriptor(modelBC1, blockBytes, { { color, 0, 64 } });
+        case Format::BC3: return Ktx2::BlockDescriptor(modelBC3, blockBytes, { { alpha, 0, 64 }, { color, 64, 64 } });
+        case Format::BC7: return Ktx2::BlockDescriptor(modelBC7, blockBytes, { { color, 0, 128 } });
+        case Format::ETC2RGB: return Ktx2::BlockDescriptor(modelETC2, blockBytes, { { etc2Color, 0, 64 } });
+        case Format::ETC2RGBA: return Ktx2::BlockDescriptor(modelETC2, blockBytes, { { alpha, 0, 64 }, { etc2Color, 64, 64 } });
+        case Format::Count: break;
+        }
+        return {};
+    }
+
+    // 8-bit RGBA pixels, rows in the order stb_image gives them
+    struct RgbaImage {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+
+        const unsigned char* at(int x, int y) const { return &pixels[(static_cast<size_t>(y) * width + x) * 4]; }
+        unsigned char* at(int x, int y) { return &pixels[(static_cast<size_t>(y) * width + x) * 4]; }
+    };
+
+    inline RgbaImage ToRgba(const unsigned char* pixels, int width, int height, int components)
+    {
+        RgbaImage image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+        {
+            const unsigned char* source = pixels + i * components;
+            unsigned char* target = &image.pixels[i * 4];
+            target[0] = source[0];
+            target[1] = components >= 3 ? source[1] : source[0];
+            target[2] = components >= 3 ? source[2] : source[0];
+            target[3] = components == 4 ? source[3] : components == 2 ? source[1] : 255;
+        }
+        return image;
+    }
+
+    inline bool HasAlpha(const RgbaImage& image)
+    {
+        for (size_t i = 3; i < image.pixels.size(); i += 4)
+            if (image.pixels[i] != 255)
+                return true;
+        return false;
+    }
+
+    // The next smaller mip level of tightly packed 8-bit pixels, every texel the average of the area
+    // it covers. That is a 2x2 box for even sizes. For odd sizes a texel covers fractions of the
+    // texels at its edges, so every source texel weighs the same and no row or column is dropped.
+    inline void DownsampleLevel(const unsigned char* source, int width, int height, int components, unsigned char* target)
+    {
+        // the source texels and weights of every target row or column, weights of one sum to 1
+        struct Tap {
+            int index;
+            float weight;
+        };
+        auto taps = [](int size, int targetSize) {
+            std::vector<std::vector<Tap>> result(targetSize);
+            float scale = static_cast<float>(size) / targetSize;
+            for (int t = 0; t < targetSize; t++)
+            {
+                float begin = t * scale, end = (t + 1) * scale;
+                for (int s = static_cast<int>(begin); s < size && s < end; s++)
+                {
+                    float overlap = std::min(end, s + 1.0f) - std::max(begin, static_cast<float>(s));
+                    if (overlap > 0.0f)
+                        result[t].push_back({ s, overlap / scale });
+                }
+            }
+            return result;
+        };
+        int targetWidth = std::max(1, width / 2), targetHeight = std::max(1, height / 2);
+        std::vector<std::vector<Tap>> columns = taps(width, targetWidth), rows = taps(height, targetHeight);
+        for (int y = 0; y < targetHeight; y++)
+        {
+            for (int x = 0; x < targetWidth; x++)
+            {
+                float sum[4] = {};
+                for (const Tap& row : rows[y])
+                    for (const Tap& column : columns[x])
+                        for (int c = 0; c < components; c++)
+                            sum[c] += row.weight * column.weight * source[(static_cast<size_t>(row.index) * width + column.index) * components + c];
+                for (int c = 0; c < components; c++)
+                    *target++ = static_cast<unsigned char>(std::min(255.0f, sum[c] + 0.5f));
+            }
+        }
+    }
+
+    inline RgbaImage Downsample(const RgbaImage& image)
+    {
+        RgbaImage level;
+        level.width = std::max(1, image.width / 2);
+        level.height = std::max(1, image.height / 2);
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height * 4);
+        DownsampleLevel(image.pixels.data(), image.width, image.height, 4, level.pixels.data());
+        return level;
+    }
+
+    // ---- shared block helpers ----
+
+    // the 16 texels of block (bx, by), edges repeated past the border of the image
+    inline void FetchBlock(const RgbaImage& image, int bx, int by, unsigned char block[64])
+    {
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+                std::memcpy(block + (y * 4 + x) * 4, image.at(std::min(bx * 4 + x, image.width - 1), std::min(by * 4 + y, image.height - 1)), 4);
+    }
+
+    inline int Clamp255(int value) { return std::min(255, std::max(0, value)); }
+
+    inline int ColorError(const unsigned char* a, const int* b, int channels)
+    {
+        int error = 0;
+        for (int c = 0; c < channels; c++)
+            error += (a[c] - b[c]) * (a[c] - b[c]);
+        return error;
+    }
+
+    // mean and principal direction of the block's colors, channels 3 or 4
+    inline void PrincipalAxis(const unsigned char block[64], int channels, float mean[4], float axis[4])
+    {
+        for (int c = 0; c < 4; c++)
+            mean[c] = axis[c] = 0.0f;
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < channels; c++)
+                mean[c] += block[i * 4 + c] / 16.0f;
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; i++)
+            for (int a = 0; a < channels; a++)
+                for (int b = 0; b < channels; b++)
+                    covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+        // Power iteration, a handful of steps is enough for 16 points. It starts from the column of
+        // the channel that varies most: a fixed start like the grey axis is orthogonal to colors that
+        // only trade one channel for another (red against green) and would never leave it.
+        int widest = 0;
+        for (int c = 1; c < channels; c++)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        for (int c = 0; c < channels; c++)
+            axis[c] = covariance[c][widest];
+        for (int step = 0; step < 8; step++)
+        {
+            float next[4] = {};
+            for (int a = 0; a < channels; a++)
+                for (int b = 0; b < channels; b++)
+                    next[a] += covariance[a][b] * axis[b];
+            float length = 0.0f;
+            for (int c = 0; c < channels; c++)
+                length = std::max(length, std::fabs(next[c]));
+            if (length <= 0.0f)
+                break;
+            for (int c = 0; c < channels; c++)
+                axis[c] = next[c] / length;
+        }
+    }
+
+    // endpoints at the extremes of the projections on the axis, pulled in by 1/16 of the range
+    inline void AxisEndpoints(const unsigned char block[64], int channels, float low[4], float high[4])
+    {
+        float mean[4], axis[4];
+        PrincipalAxis(block, channels, mean, axis);
+        float axisLength = 0.0f;
+        for (int c = 0; c < channels; c++)
+            axisLength += axis[c] * axis[c];
+        float minT = 0.0f, maxT = 0.0f;
+        if (axisLength > 0.0f)
+        {
+            minT = 1e30f;
+            maxT = -1e30f;
+            for (int i = 0; i < 16; i++)
+            {
+                float t = 0.0f;
+                for (int c = 0; c < channels; c++)
+                    t += (block[i * 4 + c] - mean[c]) * axis[c];
+                t /= axisLength;
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            float inset = (maxT - minT) / 16.0f;
+            minT += inset;
+            maxT -= inset;
+        }
+        for (int c = 0; c < 4; c++)
+        {
+            low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT));
+            high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT));
+        }
+    }
+
+    // Least squares endpoints for fixed indices: weights[i] is how much of `high` texel i gets.
+    // False when every texel uses the same weight.
+    inline bool FitEndpoints(const unsigned char block[64], int channels, const float weights[16], float low[4], float high[4])
+    {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float b = weights[i], a = 1.0f - b;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            for (int c = 0; c < channels; c++)
+            {
+                ax[c] += a * block[i * 4 + c];
+                bx[c] += b * block[i * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int c = 0; c < channels; c++)
+        {
+            low[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+            high[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+        }
+        return true;
+    }
+
+    // ---- BC1 / BC3 ----
+
+    inline uint16_t To565(const float color[4])
+    {
+        int r = static_cast<int>(std::lround(color[0] * 31.0f / 255.0f));
+        int g = static_cast<int>(std::lround(color[1] * 63.0f / 255.0f));
+        int b = static_cast<int>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    inline void From565(uint16_t packed, int color[3])
+    {
+        int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = r << 3 | r >> 2;
+        color[1] = g << 2 | g >> 4;
+        color[2] = b << 3 | b >> 2;
+    }
+
+    // the four colors of a four-color BC1 block
+    inline void Bc1Palette(uint16_t color0, uint16_t color1, int palette[4][3])
+    {
+        From565(color0, palette[0]);
+        From565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    // nearest palette entry of every texel, returns the error
+    inline int Bc1Indices(const unsigned char block[64], uint16_t color0, uint16_t color1, uint32_t& indices)
+    {
+        int palette[4][3];
+        Bc1Palette(color0, color1, palette);
+        indices = 0;
+        int total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = ColorError(block + i * 4, palette[0], 3);
+            for (int p = 1; p < 4; p++)
+            {
+                int error = ColorError(block + i * 4, palette[p], 3);
+                if (error < bestError)
+                {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+            total += bestError;
+        }
+        return total;
+    }
+
+    inline void EncodeBc1(const unsigned char block[64], unsigned char out[8])
+    {
+        float low[4], high[4];
+        AxisEndpoints(block, 3, low, high);
+        uint16_t color0 = To565(high), color1 = To565(low);
+        uint32_t indices;
+        int error = Bc1Indices(block, color0, color1, indices);
+
+        // refit the endpoints to the chosen indices once
+        static const float weightOfColor1[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        float weights[16];
+        for (int i = 0; i < 16; i++)
+            weights[i] = weightOfColor1[(indices >> (2 * i)) & 3];
+        float fitted0[4] = {}, fitted1[4] = {};
+        if (FitEndpoints(block, 3, weights, fitted0, fitted1))
+        {
+            uint16_t refit0 = To565(fitted0), refit1 = To565(fitted1);
+            uint32_t refitIndices;
+            int refitError = Bc1Indices(block, refit0, refit1, refitIndices);
+            if (refitError < error)
+            {
+                color0 = refit0;
+                color1 = refit1;
+                indices = refitIndices;
+            }
+        }
+
+        // color0 > color1 selects the four color mode, swapping the endpoints swaps 0/1 and 2/3
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+            indices ^= 0x55555555u;
+        }
+        else if (color0 == color1)
+            indices = 0;
+        out[0] = static_cast<unsigned char>(color0);
+        out[1] = static_cast<unsigned char>(color0 >> 8);
+        out[2] = static_cast<unsigned char>(color1);
+        out[3] = static_cast<unsigned char>(color1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    inline void DecodeBc1(const unsigned char in[8], unsigned char block[64])
+    {
+        uint16_t color0 = static_cast<uint16_t>(in[0] | in[1] << 8), color1 = static_cast<uint16_t>(in[2] | in[3] << 8);
+        uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | static_cast<uint32_t>(in[7]) << 24;
+        int palette[4][3];
+        Bc1Palette(color0, color1, palette);
+        if (color0 <= color1)
+        {
+            // three color mode, never written by EncodeBc1
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            const int* color = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 3; c++)
+                block[i * 4 + c] = static_cast<unsigned char>(color[c]);
+            block[i * 4 + 3] = 255;
+        }
+    }
+
+    inline void AlphaPalette(int alpha0, int alpha1, int palette[8])
+    {
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+    }
+
+    // the alpha block of BC3: the extremes as endpoints with six values between them
+    inline void EncodeBc3Alpha(const unsigned char block[64], unsigned char out[8])
+    {
+        int alpha0 = 0, alpha1 = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            alpha0 = std::max(alpha0, static_cast<int>(block[i * 4 + 3]));
+            alpha1 = std::min(alpha1, static_cast<int>(block[i * 4 + 3]));
+        }
+        uint64_t indices = 0;
+        if (alpha0 > alpha1)
+        {
+            int palette[8];
+            AlphaPalette(alpha0, alpha1, palette);
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                for (int p = 1; p < 8; p++)
+                    if (std::abs(palette[p] - block[i * 4 + 3]) < std::abs(palette[best] - block[i * 4 + 3]))
+                        best = p;
+                indices |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+        out[0] = static_cast<unsigned char>(alpha0);
+        out[1] = static_cast<unsigned char>(alpha1);
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    inline void DecodeBc3Alpha(const unsigned char in[8], unsigned char block[64])
+    {
+        int palette[8];
+        AlphaPalette(in[0], in[1], palette);
+        if (in[0] <= in[1])
+        {
+            // six value mode with 0 and 255, never written by EncodeBc3Alpha
+            for (int i = 2; i < 6; i++)
+                palette[i] = ((6 - i) * in[0] + (i - 1) * in[1]) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+            indices |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+        for (int i = 0; i < 16; i++)
+            block[i * 4 + 3] = static_cast<unsigned char>(palette[(indices >> (3 * i)) & 7]);
+    }
+
+    // ---- BC7 mode 6 ----
+
+    const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Endpoints {
+        int low[4];  // 7 bits per channel
+        int high[4];
+        int lowBit;  // the p-bits
+        int highBit;
+    };
+
+    inline void Bc7Palette(const Bc7Endpoints& endpoints, int palette[16][4])
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int low = endpoints.low[c] << 1 | endpoints.lowBit;
+            int high = endpoints.high[c] << 1 | endpoints.highBit;
+            for (int i = 0; i < 16; i++)
+                palette[i][c] = ((64 - Bc7Weights[i]) * low + Bc7Weights[i] * high + 32) >> 6;
+        }
+    }
+
+    inline int Bc7Indices(const unsigned char block[64], const Bc7Endpoints& endpoints, int indices[16])
+    {
+        int palette[16][4];
+        Bc7Palette(endpoints, palette);
+        int total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = ColorError(block + i * 4, palette[0], 4);
+            for (int p = 1; p < 16; p++)
+            {
+                int error = ColorError(block + i * 4, palette[p], 4);
+                if (error < bestError)
+                {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            indices[i] = best;
+            total += bestError;
+        }
+        return total;
+    }
+
+    // the best of the four p-bit choices for the float endpoints
+    inline int Bc7Quantize(const unsigned char block[64], const float low[4], const float high[4], Bc7Endpoints& best, int indices[16])
+    {
+        int bestError = -1;
+        for (int bits = 0; bits < 4; bits++)
+        {
+            Bc7Endpoints endpoints;
+            endpoints.lowBit = bits & 1;
+            endpoints.highBit = bits >> 1;
+            for (int c = 0; c < 4; c++)
+            {
+                endpoints.low[c] = std::min(127, std::max(0, static_cast<int>(std::lround((low[c] - endpoints.lowBit) / 2.0f))));
+                endpoints.high[c] = std::min(127, std::max(0, static_cast<int>(std::lround((high[c] - endpoints.highBit) / 2.0f))));
+            }
+            int candidate[16];
+            int error = Bc7Indices(block, endpoints, candidate);
+            if (bestError < 0 || error < bestError)
+            {
+                bestError = error;
+                best = endpoints;
+                std::copy(candidate, candidate + 16, indices);
+            }
+        }
+        return bestError;
+    }
+
+    // writes value into the block bit stream, least significant bit first
+    inline void PutBits(unsigned char out[16], int& position, uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; i++, position++)
+            if (value >> i & 1)
+                out[position >> 3] |= static_cast<unsigned char>(1 << (position & 7));
+    }
+
+    inline uint32_t GetBits(const unsigned char in[16], int& position, int bits)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; i++, position++)
+            value |= static_cast<uint32_t>(in[position >> 3] >> (position & 7) & 1) << i;
+        return value;
+    }
+
+    inline void EncodeBc7(const unsigned char block[64], unsigned char out[16])
+    {
+        float low[4], high[4];
+        AxisEndpoints(block, 4, low, high);
+        Bc7Endpoints endpoints;
+        int indices[16];
+        int error = Bc7Quantize(block, low, high, endpoints, indices);
+
+        float weights[16];
+        for (int i = 0; i < 16; i++)
+            weights[i] = Bc7Weights[indices[i]] / 64.0f;
+        float fittedLow[4], fittedHigh[4];
+        if (FitEndpoints(block, 4, weights, fittedLow, fittedHigh))
+        {
+            Bc7Endpoints refit;
+            int refitIndices[16];
+            if (Bc7Quantize(block, fittedLow, fittedHigh, refit, refitIndices) < error)
+            {
+                endpoints = refit;
+                std::copy(refitIndices, refitIndices + 16, indices);
+            }
+        }
+
+        // the first index is stored without its top bit, it has to be below 8
+        if (indices[0] >= 8)
+        {
+            std::swap(endpoints.low, endpoints.high);
+            std::swap(endpoints.lowBit, endpoints.highBit);
+            for (int& index : indices)
+                index = 15 - index;
+        }
+        std::memset(out, 0, 16);
+        int position = 0;
+        PutBits(out, position, 1 << 6, 7);  // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            PutBits(out, position, endpoints.low[c], 7);
+            PutBits(out, position, endpoints.high[c], 7);
+        }
+        PutBits(out, position, endpoints.lowBit, 1);
+        PutBits(out, position, endpoints.highBit, 1);
+        PutBits(out, position, indices[0], 3);
+        for (int i = 1; i < 16; i++)
+            PutBits(out, position, indices[i], 4);
+    }
+
+    // mode 6 blocks only, anything else decodes to black
+    inline void DecodeBc7(const unsigned char in[16], unsigned char block[64])
+    {
+        std::memset(block, 0, 64);
+        int position = 0;
+        if (GetBits(in, position, 7) != 1 << 6)
+            return;
+        Bc7Endpoints endpoints;
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints.low[c] = static_cast<int>(GetBits(in, position, 7));
+            endpoints.high[c] = static_cast<int>(GetBits(in, position, 7));
+        }
+        endpoints.lowBit = static_cast<int>(GetBits(in, position, 1));
+        endpoints.highBit = static_cast<int>(GetBits(in, position, 1));
+        int palette[16][4];
+        Bc7Palette(endpoints, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            int index = static_cast<int>(GetBits(in, position, i == 0 ? 3 : 4));
+            for (int c = 0; c < 4; c++)
+                block[i * 4 + c] = static_cast<unsigned char>(palette[index][c]);
+        }
+    }
+
+    // ---- ETC2 ----
+
+    const int EtcModifiers[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+
+    // pixel index value 0..3 is +small, +large, -small, -large
+    inline int EtcModifier(int table, int index)
+    {
+        int modifier = EtcModifiers[table][index & 1];
+        return index & 2 ? -modifier : modifier;
+    }
+
+    // texel (x, y) of the block is bit x * 4 + y of the index planes and of the EAC indices
+    inline int EtcTexel(int x, int y) { return x * 4 + y; }
+
+    inline bool EtcSubblock(bool flip, int x, int y) { return flip ? y >= 2 : x >= 2; }
+
+    // best table for the subblock around base, its error, and the 2-bit index of each of its texels
+    inline int EtcFitSubblock(const unsigned char block[64], bool flip, int subblock, const int base[3], int& table, int indices[16])
+    {
+        int bestError = -1;
+        for (int t = 0; t < 8; t++)
+        {
+            int error = 0;
+            int chosen[16];
+            for (int y = 0; y < 4; y++)
+            {
+                for (int x = 0; x < 4; x++)
+                {
+                    if (EtcSubblock(flip, x, y) != (subblock == 1))
+                        continue;
+                    const unsigned char* texel = block + (y * 4 + x) * 4;
+                    int bestIndex = 0, bestTexelError = -1;
+                    for (int index = 0; index < 4; index++)
+                    {
+                        int modifier = EtcModifier(t, index);
+                        int color[3] = { Clamp255(base[0] + modifier), Clamp255(base[1] + modifier), Clamp255(base[2] + modifier) };
+                        int texelError = ColorError(texel, color, 3);
+                        if (bestTexelError < 0 || texelError < bestTexelError)
+                        {
+                            bestIndex = index;
+                            bestTexelError = texelError;
+                        }
+                    }
+                    chosen[EtcTexel(x, y)] = bestIndex;
+                    error += bestTexelError;
+                }
+            }
+            if (bestError < 0 || error < bestError)
+            {
+                bestError = error;
+                table = t;
+                for (int y = 0; y < 4; y++)
+                    for (int x = 0; x < 4; x++)
+                        if (EtcSubblock(flip, x, y) == (subblock == 1))
+                            indices[EtcTexel(x, y)] = chosen[EtcTexel(x, y)];
+            }
+        }
+        return bestError;
+    }
+
+    inline void PutBigEndian(uint64_t word, unsigned char out[8])
+    {
+        for (int i = 0; i < 8; i++)
+            out[i] = static_cast<unsigned char>(word >> (56 - 8 * i));
+    }
+
+    inline uint64_t GetBigEndian(const unsigned char in[8])
+    {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; i++)
+            word = word << 8 | in[i];
+        return word;
+    }
+
+    // both orientations, individual (444 + 444) and differential (555 + 333 delta) base colors
+    // at the subblock averages, the lowest error wins
+    inline void EncodeEtc(const unsigned char block[64], unsigned char out[8])
+    {
+        int bestError = -1;
+        uint64_t bestWord = 0;
+        for (int flip = 0; flip < 2; flip++)
+        {
+            float average[2][3] = {};
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++)
+                    for (int c = 0; c < 3; c++)
+                        average[EtcSubblock(flip != 0, x, y)][c] += block[(y * 4 + x) * 4 + c] / 8.0f;
+
+            for (int differential = 0; differential < 2; differential++)
+            {
+                int packed[2][3], base[2][3];
+                bool fits = true;
+                for (int s = 0; s < 2; s++)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        if (differential)
+                        {
+                            packed[s][c] = static_cast<int>(std::lround(average[s][c] * 31.0f / 255.0f));
+                            base[s][c] = packed[s][c] << 3 | packed[s][c] >> 2;
+                        }
+                        else
+                        {
+                            packed[s][c] = static_cast<int>(std::lround(average[s][c] * 15.0f / 255.0f));
+                            base[s][c] = packed[s][c] << 4 | packed[s][c];
+                        }
+                    }
+                }
+                if (differential)
+                    for (int c = 0; c < 3; c++)
+                        fits = fits && packed[1][c] - packed[0][c] >= -4 && packed[1][c] - packed[0][c] <= 3;
+                if (!fits)
+                    continue;
+
+                int tables[2], indices[16];
+                int error = EtcFitSubblock(block, flip != 0, 0, base[0], tables[0], indices) +
+                    EtcFitSubblock(block, flip != 0, 1, base[1], tables[1], indices);
+                if (bestError >= 0 && error >= bestError)
+                    continue;
+                bestError = error;
+                uint64_t word = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int shift = 56 - 8 * c;
+                    if (differential)
+                        word |= static_cast<uint64_t>(packed[0][c] << 3 | ((packed[1][c] - packed[0][c]) & 7)) << shift;
+                    else
+                        word |= static_cast<uint64_t>(packed[0][c] << 4 | packed[1][c]) << shift;
+                }
+                word |= static_cast<uint64_t>(tables[0]) << 37 | static_cast<uint64_t>(tables[1]) << 34;
+                word |= static_cast<uint64_t>(differential) << 33 | static_cast<uint64_t>(flip) << 32;
+                for (int i = 0; i < 16; i++)
+                    word |= static_cast<uint64_t>(indices[i] >> 1) << (16 + i) | static_cast<uint64_t>(indices[i] & 1) << i;
+                bestWord = word;
+            }
+        }
+        PutBigEndian(bestWord, out);
+    }
+
+    // individual and differential blocks only, the ETC2 T, H and planar modes aren't decoded
+    inline void DecodeEtc(const unsigned char in[8], unsigned char block[64])
+    {
+        uint64_t word = GetBigEndian(in);
+        bool differential = word >> 33 & 1, flip = word >> 32 & 1;
+        int base[2][3];
+        for (int c = 0; c < 3; c++)
+        {
+            int bits = static_cast<int>(word >> (56 - 8 * c) & 0xFF);
+            if (differential)
+            {
+                int first = bits >> 3, delta = bits & 7;
+                int second = first + (delta >= 4 ? delta - 8 : delta);
+                base[0][c] = first << 3 | first >> 2;
+                base[1][c] = second << 3 | second >> 2;
+            }
+            else
+            {
+                base[0][c] = (bits >> 4) * 17;
+                base[1][c] = (bits & 15) * 17;
+            }
+        }
+        int tables[2] = { static_cast<int>(word >> 37 & 7), static_cast<int>(word >> 34 & 7) };
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                int texel = EtcTexel(x, y);
+                int index = static_cast<int>((word >> (16 + texel) & 1) << 1 | (word >> texel & 1));
+                int subblock = EtcSubblock(flip, x, y);
+                int modifier = EtcModifier(tables[subblock], index);
+                for (int c = 0; c < 3; c++)
+                    block[(y * 4 + x) * 4 + c] = static_cast<unsigned char>(Clamp255(base[subblock][c] + modifier));
+                block[(y * 4 + x) * 4 + 3] = 255;
+            }
+        }
+    }
+
+    const int EacModifiers[16][8] = {
+        { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 }, { -2, -5, -8, -13, 1, 4, 7, 12 },
+        { -2, -4, -6, -13, 1, 3, 5, 12 }, { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 }, { -2, -6, -8, -10, 1, 5, 7, 9 },
+        { -2, -5, -8, -10, 1, 4, 7, 9 }, { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 }, { -4, -6, -8, -9, 3, 5, 7, 8 },
+        { -3, -5, -7, -9, 2, 4, 6, 8 },
+    };
+
+    // error and indices of an EAC alpha block with the given base, multiplier and table
+    inline int EacFit(const unsigned char block[64], int base, int multiplier, int table, int indices[16])
+    {
+        int total = 0;
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                int alpha = block[(y * 4 + x) * 4 + 3];
+                int best = 0, bestError = -1;
+                for (int i = 0; i < 8; i++)
+                {
+                    int error = std::abs(Clamp255(base + EacModifiers[table][i] * multiplier) - alpha);
+                    if (bestError < 0 || error < bestError)
+                    {
+                        best = i;
+                        bestError = error;
+                    }
+                }
+                indices[EtcTexel(x, y)] = best;
+                total += bestError * bestError;
+            }
+        }
+        return total;
+    }
+
+    inline void EncodeEac(const unsigned char block[64], unsigned char out[8])
+    {
+        int low = 255, high = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            low = std::min(low, static_cast<int>(block[i * 4 + 3]));
+            high = std::max(high, static_cast<int>(block[i * 4 + 3]));
+        }
+        // table 13 has a zero modifier, which reproduces a flat block exactly
+        int bestBase = low, bestMultiplier = 1, bestTable = 13, bestIndices[16];
+        int bestError = EacFit(block, low, 1, 13, bestIndices);
+        for (int table = 0; table < 16 && bestError > 0; table++)
+        {
+            int span = EacModifiers[table][7] - EacModifiers[table][3];
+            int guess = std::max(1, static_cast<int>(std::lround(static_cast<float>(high - low) / span)));
+            for (int multiplier = std::max(1, guess - 1); multiplier <= std::min(15, guess + 1); multiplier++)
+            {
+                int center = (low + high) / 2 - (EacModifiers[table][7] + EacModifiers[table][3]) * multiplier / 2;
+                for (int base = center - 2; base <= center + 2; base++)
+                {
+                    int indices[16];
+                    int error = EacFit(block, Clamp255(base), multiplier, table, indices);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestBase = Clamp255(base);
+                        bestMultiplier = multiplier;
+                        bestTable = table;
+                        std::copy(indices, indices + 16, bestIndices);
+                    }
+                }
+            }
+        }
+        uint64_t word = static_cast<uint64_t>(bestBase) << 56 | static_cast<uint64_t>(bestMultiplier) << 52 | static_cast<uint64_t>(bestTable) << 48;
+        for (int i = 0; i < 16; i++)
+            word |= static_cast<uint64_t>(bestIndices[i]) << (45 - 3 * i);
+        PutBigEndian(word, out);
+    }
+
+    inline void DecodeEac(const unsigned char in[8], unsigned char block[64])
+    {
+        uint64_t word = GetBigEndian(in);
+        int base = static_cast<int>(word >> 56), multiplier = static_cast<int>(word >> 52 & 15), table = static_cast<int>(word >> 48 & 15);
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+                block[(y * 4 + x) * 4 + 3] = static_cast<unsigned char>(Clamp255(base + EacModifiers[table][word >> (45 - 3 * EtcTexel(x, y)) & 7] * multiplier));
+    }
+
+    // ---- levels and textures ----
+
+    inline void EncodeBlock(Format format, const unsigned char block[64], unsigned char* out)
+    {
+        switch (format)
+        {
+        case Format::BC1: EncodeBc1(block, out); break;
+        case Format::BC3: EncodeBc3Alpha(block, out); EncodeBc1(block, out + 8); break;
+        case Format::BC7: EncodeBc7(block, out); break;
+        case Format::ETC2RGB: EncodeEtc(block, out); break;
+        case Format::ETC2RGBA: EncodeEac(block, out); EncodeEtc(block, out + 8); break;
+        case Format::Count: break;
+        }
+    }
+
+    inline void DecodeBlock(Format format, const unsigned char* in, unsigned char block[64])
+    {
+        switch (format)
+        {
+        case Format::BC1: DecodeBc1(in, block); break;
+        case Format::BC3: DecodeBc1(in + 8, block); DecodeBc3Alpha(in, block); break;
+        case Format::BC7: DecodeBc7(in, block); break;
+        case Format::ETC2RGB: DecodeEtc(in, block); break;
+        case Format::ETC2RGBA: DecodeEtc(in + 8, block); DecodeEac(in, block); break;
+        case Format::Count: break;
+        }
+    }
+
+    inline int BlocksAcross(int size) { return (size + 3) / 4; }
+
+    // one level, rows of blocks spread over the shared pool
+    inline std::vector<unsigned char> EncodeLevel(const RgbaImage& image, Format format)
+    {
+        int across = BlocksAcross(image.width), down = BlocksAcross(image.height);
+        size_t blockBytes = Info(format).blockBytes;
+        std::vector<unsigned char> data(static_cast<size_t>(across) * down * blockBytes);
+        ThreadPool::Shared().parallelFor(static_cast<size_t>(down), [&](size_t by) {
+            unsigned char block[64];
+            for (int bx = 0; bx < across; bx++)
+            {
+                FetchBlock(image, bx, static_cast<int>(by), block);
+                EncodeBlock(format, block, &data[(by * across + bx) * blockBytes]);
+            }
+        });
+        return data;
+    }
+
+    inline RgbaImage DecodeLevel(const std::vector<unsigned char>& data, int width, int height, Format format)
+    {
+        RgbaImage image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        int across = BlocksAcross(width), down = BlocksAcross(height);
+        size_t blockBytes = Info(format).blockBytes;
+        if (data.size() < static_cast<size_t>(across) * down * blockBytes)
+            return image;
+        unsigned char block[64];
+        for (int by = 0; by < down; by++)
+        {
+            for (int bx = 0; bx < across; bx++)
+            {
+                DecodeBlock(format, &data[(static_cast<size_t>(by) * across + bx) * blockBytes], block);
+                for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                    for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                        std::memcpy(image.at(bx * 4 + x, by * 4 + y), block + (y * 4 + x) * 4, 4);
+            }
+        }
+        return image;
+    }
+
+    // peak signal to noise ratio in dB over RGB, and alpha too if asked, 99 for identical images
+    inline double Psnr(const RgbaImage& a, const RgbaImage& b, bool alpha)
+    {
+        int channels = alpha ? 4 : 3;
+        double squared = 0.0;
+        for (size_t i = 0; i < a.pixels.size() && i < b.pixels.size(); i += 4)
+            for (int c = 0; c < channels; c++)
+                squared += (a.pixels[i + c] - b.pixels[i + c]) * (a.pixels[i + c] - b.pixels[i + c]);
+        double mse = squared / (static_cast<double>(a.width) * a.height * channels);
+        return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    }
+
+    struct CompressedTexture {
+        Format format = Format::BC1;
+        int width = 0;
+        int height = 0;
+        std::vector<std::vector<unsigned char>> levels;
+
+        size_t bytes() const
+        {
+            size_t total = 0;
+            for (const std::vector<unsigned char>& level : levels)
+                total += level.size();
+            return total;
+        }
+    };
+
+    // the full mip chain down to 1x1, every level encoded from the box filtered one above it
+    inline CompressedTexture Compress(const RgbaImage& image, Format format)
+    {
+        CompressedTexture texture;
+        texture.format = format;
+        texture.width = image.width;
+        texture.height = image.height;
+        RgbaImage level = image;
+        for (;;)
+        {
+            texture.levels.push_back(EncodeLevel(level, format));
+            if (level.width == 1 && level.height == 1)
+                break;
+            level = Downsample(level);
+        }
+        return texture;
+    }
+
+    // ---- cache files and runtime support ----
+
+    // the compressed variants a texture can have in the cache, BC first since desktop GL has it
+    enum class Family { BC, ETC2 };
+
+    inline std::string CachePath(const std::string& sourcePath, Family family)
+    {
+        return AssetCache::CachePath(sourcePath, family == Family::BC ? ".bc.ktx2" : ".etc2.ktx2");
+    }
+
+    inline Format PickFormat(Family family, bool alpha, bool bc7)
+    {
+        if (family == Family::ETC2)
+            return alpha ? Format::ETC2RGBA : Format::ETC2RGB;
+        return bc7 ? Format::BC7 : alpha ? Format::BC3 : Format::BC1;
+    }
+
+    const char* const SourceKey = "InteriorDesigner.source";
+
+    inline std::string SourceStampText(const AssetCache::SourceStamp& stamp)
+    {
+        return std::to_string(stamp.size) + " " + std::to_string(stamp.modified);
+    }
+
+    // The rows are stored as the decoder gave them, which is bottom row first with the flip main
+    // sets, so the orientation says the rows go up.
+    inline bool Save(const std::string& sourcePath, const CompressedTexture& texture, Family family)
+    {
+        AssetCache::SourceStamp stamp;
+        if (!AssetCache::GetSourceStamp(sourcePath, stamp))
+            return false;
+#ifdef _WIN32
+        _mkdir(AssetCache::Directory);
+        int processId = _getpid();
+#else
+        mkdir(AssetCache::Directory, 0755);
+        int processId = static_cast<int>(getpid());
+#endif
+        Ktx2::Image image;
+        image.vkFormat = Info(texture.format).vkFormat;
+        image.width = static_cast<uint32_t>(texture.width);
+        image.height = static_cast<uint32_t>(texture.height);
+        image.dfd = Descriptor(texture.format);
+        image.keyValues = { { "KTXorientation", "ru" }, { "KTXwriter", "InteriorDesigner --compress-textures" }, { SourceKey, SourceStampText(stamp) } };
+        image.levels = texture.levels;
+        // written aside and renamed into place like the baked meshes, the app may be reading the cache
+        std::string path = CachePath(sourcePath, family);
+        std::string temporaryPath = path + "." + std::to_string(processId) + ".tmp";
+        if (!Ktx2::Write(temporaryPath, image, Info(texture.format).blockBytes))
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // formats the current context samples, set on the GL thread by DetectSupport
+    inline std::atomic<unsigned>& SupportedFormats()
+    {
+        static std::atomic<unsigned> formats(0);
+        return formats;
+    }
+
+    inline bool IsSupported(Format format) { return (SupportedFormats().load() >> static_cast<int>(format) & 1) != 0; }
+
+    // reads the extensions of the current context, call after loading GL
+    inline void DetectSupport()
+    {
+        GLint major = 0, minor = 0, count = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        int version = major * 10 + minor;
+        bool s3tc = false, bptc = version >= 42, etc2 = version >= 43;
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (!name)
+                continue;
+            std::string extension = name;
+            s3tc = s3tc || extension == "GL_EXT_texture_compression_s3tc";
+            bptc = bptc || extension == "GL_ARB_texture_compression_bptc";
+            etc2 = etc2 || extension == "GL_ARB_ES3_compatibility";
+        }
+        unsigned formats = 0;
+        if (s3tc)
+            formats |= 1u << static_cast<int>(Format::BC1) | 1u << static_cast<int>(Format::BC3);
+        if (bptc)
+            formats |= 1u << static_cast<int>(Format::BC7);
+        if (etc2)
+            formats |= 1u << static_cast<int>(Format::ETC2RGB) | 1u << static_cast<int>(Format::ETC2RGBA);
+        SupportedFormats() = formats;
+    }
+
+    // the cached compressed texture of the source image if one is fresh and the context can sample
+    // it, BC before ETC2. fileBytes is the size of the file that was read.
+    inline bool LoadFresh(const std::string& sourcePath, CompressedTexture& texture, size_t& fileBytes)
+    {
+        if (SupportedFormats().load() == 0)
+            return false;
+        AssetCache::SourceStamp stamp;
+        if (!AssetCache::GetSourceStamp(sourcePath, stamp))
+            return false;
+        for (Family family : { Family::BC, Family::ETC2 })
+        {
+            Ktx2::Image image;
+            Format format;
+            if (!Ktx2::Read(CachePath(sourcePath, family), image, &fileBytes) || !FormatFromVk(image.vkFormat, format) || !IsSupported(format))
+                continue;
+            if (image.value(SourceKey) != SourceStampText(stamp))
+                continue;
+            texture.format = format;
+            texture.width = static_cast<int>(image.width);
+            texture.height = static_cast<int>(image.height);
+            texture.levels = std::move(image.levels);
+            return true;
+        }
+        return false;
+    }
+}
+
+#endif
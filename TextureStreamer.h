@@ -0,0 +1,601 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+
+#include "GpuResources.h"
+#include "LoadTelemetry.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// GL 4.4 / ARB_buffer_storage, not in the 3.3 loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// Decodes textures on the thread pool and uploads them over the next frames. A texture starts as a
+// 1x1 grey placeholder. A worker decodes the image and writes its whole mip chain into a ring of
+// pixel buffer memory, and pump() on the GL thread then only issues glTexSubImage2D from the ring,
+// smallest level first, raising the base level as the finer levels arrive so the texture sharpens
+// in place. Every frame uploads at most uploadBudgetMB (always at least one level). A fence after
+// the last level of a texture tells when its part of the ring can be written again.
+// With glBufferStorage the ring is one persistently mapped buffer the workers write into directly.
+// Without it the workers write into a CPU copy of the ring and pump() copies each level into a
+// plain buffer mapped unsynchronized, the fences keep that safe the same way.
+class TextureStreamer
+{
+public:
+    struct Stats {
+        const char* mode = "off";
+        size_t ringBytes = 0;
+        size_t ringUsed = 0;
+        size_t decoding = 0;  // queued or running on the pool
+        size_t waiting = 0;  // decoded, no room in the ring yet
+        size_t uploading = 0;  // in the ring, levels left to upload
+        size_t fenced = 0;  // uploaded, the GPU may still read the ring
+        size_t lastFrameBytes = 0;
+        size_t uploadedBytes = 0;
+        size_t textures = 0;
+    };
+
+    // uploads per frame, the one level that doesn't fit is still uploaded when nothing else was
+    double uploadBudgetMB = 16.0;
+    // called when a texture is requested and from a worker when one is ready to upload, e.g. to
+    // request a frame
+    std::function<void()> onReady;
+
+    static TextureStreamer& Get()
+    {
+        static TextureStreamer streamer;
+        return streamer;
+    }
+
+    // creates the ring on the GL thread, persistently mapped when the context can
+    void init(GLADloadproc loader, size_t ringBytes = 64u << 20)
+    {
+        typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+        GLint major = 0, minor = 0, count = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        bool bufferStorage = major * 10 + minor >= 44;
+        for (GLint i = 0; i < count && !bufferStorage; i++)
+        {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            bufferStorage = name && std::string(name) == "GL_ARB_buffer_storage";
+        }
+        BufferStorageProc bufferStorageProc = bufferStorage ? reinterpret_cast<BufferStorageProc>(loader("glBufferStorage")) : nullptr;
+
+        capacity = ringBytes;
+        ring = GLBuffer::Create("texture streaming ring");
+        ring.setBytes(capacity);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.get());
+        if (bufferStorageProc)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorageProc(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, flags);
+            mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(capacity), flags));
+        }
+        if (!mapped)
+        {
+            // a buffer created by glBufferStorage can't be resized, start over with a plain one
+            if (bufferStorageProc)
+            {
+                ring = GLBuffer::Create("texture streaming ring");
+                ring.setBytes(capacity);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.get());
+            }
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+            MEMORY_SCOPE(Textures);
+            staging.assign(capacity, 0);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        running = true;
+    }
+
+    // waits for the workers and releases the ring, call on the GL thread before the context goes away
+    void shutdown()
+    {
+        if (!running)
+            return;
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return inFlight == 0; });
+        for (const std::shared_ptr<Job>& job : fenced)
+            glDeleteSync(job->fence);
+        pending.clear();
+        waiting.clear();
+        ready.clear();
+        uploading.clear();
+        fenced.clear();
+        allocations.clear();
+        if (mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.get());
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            mapped = nullptr;
+        }
+        ring.reset();
+        staging.clear();
+        staging.shrink_to_fit();
+        running = false;
+    }
+
+    bool enabled() const { return running; }
+
+    // the texture models hold until the streamed one has its first level
+    static GLTexture Placeholder(const std::string& filename)
+    {
+        GLTexture texture = GLTexture::Create("texture " + filename);
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        glBindTexture(GL_TEXTURE_2D, texture.get());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        texture.setBytes(sizeof(grey));
+        return texture;
+    }
+
+    // Queues the decode of filename into texture, which only has to stay alive if it is still
+    // wanted. The decode starts at the next pump, so a texture replaced right after the request
+    // (AttachTextures swapping a model's own) is dropped without being read. GL thread.
+    void request(const std::string& filename, const std::shared_ptr<GLTexture>& texture)
+    {
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->filename = filename;
+        job->texture = texture;
+        job->requested = TraceRecorder::Now();
+        pending.push_back(job);
+        if (onReady)
+            onReady();  // the next pump starts it
+    }
+
+    // Uploads what is ready, up to the budget, and releases the ring behind finished textures. Call
+    // on the GL thread once per frame, true while there is work only more frames can finish.
+    bool pump()
+    {
+        if (!running)
+            return false;
+        PROFILE_SCOPE("Stream textures");
+        retireFenced();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const std::shared_ptr<Job>& job : pending)
+            {
+                if (job->texture.expired())
+                    continue;
+                inFlight++;
+                ThreadPool::Shared().submit([this, job]() { decode(job); });
+            }
+            pending.clear();
+            // ring space freed above goes to the oldest waiting textures first
+            while (!waiting.empty() && (waiting.front()->texture.expired() || reserve(*waiting.front())))
+            {
+                std::shared_ptr<Job> job = waiting.front();
+                waiting.pop_front();
+                if (job->texture.expired())
+                    continue;
+                inFlight++;
+                ThreadPool::Shared().submit([this, job]() { fill(job); });
+            }
+            uploading.insert(uploading.end(), ready.begin(), ready.end());
+            ready.clear();
+        }
+
+        size_t budget = static_cast<size_t>(std::max(0.0, uploadBudgetMB) * 1024.0 * 1024.0);
+        size_t uploaded = 0;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        while (!uploading.empty())
+        {
+            std::shared_ptr<Job> job = uploading.front();
+            std::shared_ptr<GLTexture> texture = job->texture.lock();
+            if (texture && !job->failed)
+                uploadLevels(*job, *texture, budget, uploaded);
+            if (texture && !job->failed && job->nextLevel >= 0)
+                break;  // out of budget
+            uploading.pop_front();
+            if (job->failed)
+                std::cout << "Texture failed to load at path: " << job->filename << std::endl;
+            if (job->allocation)
+            {
+                // the GPU may still be reading the ring, the fence says when it is done
+                job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                fenced.push_back(job);
+            }
+            else
+                finish(*job);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        lastFrameBytes = uploaded;
+        uploadedBytes += uploaded;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return !uploading.empty() || !fenced.empty() || !waiting.empty() || !ready.empty();
+    }
+
+    // GL thread, like pump
+    Stats stats() const
+    {
+        Stats stats;
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.mode = !running ? "off" : mapped ? "persistent mapped" : "buffer copy";
+        stats.ringBytes = running ? capacity : 0;
+        for (const Allocation& allocation : allocations)
+            stats.ringUsed += allocation.size;
+        stats.decoding = inFlight + pending.size();
+        stats.waiting = waiting.size();
+        stats.uploading = uploading.size() + ready.size();
+        stats.fenced = fenced.size();
+        stats.lastFrameBytes = lastFrameBytes;
+        stats.uploadedBytes = uploadedBytes;
+        stats.textures = finished;
+        return stats;
+    }
+
+private:
+    struct Level {
+        size_t offset;  // from the start of the texture's data
+        size_t size;
+        int width;
+        int height;
+    };
+
+    struct Job {
+        std::string filename;
+        std::weak_ptr<GLTexture> texture;
+        ImageData image;
+        bool compressed = false;
+        GLenum format = GL_RGBA;
+        std::vector<Level> levels;
+        size_t bytes = 0;  // every level, aligned
+        size_t allocation = 0;  // id of the ring allocation, 0 for none
+        size_t ringOffset = 0;
+        std::vector<unsigned char> direct;  // the levels of a texture bigger than the ring
+        int nextLevel = -1;  // the next to upload, levels go from the smallest to 0
+        bool storage = false;  // the levels are defined on the texture
+        bool failed = false;
+        GLsync fence = nullptr;
+        double requested = 0.0;
+
+        ~Job()
+        {
+            if (image.pixels)
+                stbi_image_free(image.pixels);
+        }
+    };
+
+    struct Allocation {
+        size_t id;
+        size_t offset;
+        size_t size;
+        bool released;
+    };
+
+    static const size_t Alignment = 16;
+
+    mutable std::mutex mutex;
+    std::condition_variable idle;
+    bool running = false;
+    GLBuffer ring;
+    unsigned char* mapped = nullptr;
+    std::vector<unsigned char> staging;  // the ring's CPU copy without persistent mapping
+    size_t capacity = 0;
+    std::deque<Allocation> allocations;  // oldest first, guarded by mutex
+    size_t nextAllocation = 1;
+    size_t inFlight = 0;  // guarded by mutex
+    std::deque<std::shared_ptr<Job>> waiting;  // guarded by mutex
+    std::deque<std::shared_ptr<Job>> ready;  // guarded by mutex
+    // GL thread only
+    std::vector<std::shared_ptr<Job>> pending;  // requested, decoded from the next pump
+    std::deque<std::shared_ptr<Job>> uploading;
+    std::vector<std::shared_ptr<Job>> fenced;
+    size_t lastFrameBytes = 0;
+    size_t uploadedBytes = 0;
+    size_t finished = 0;
+
+    static size_t Align(size_t bytes) { return (bytes + Alignment - 1) / Alignment * Alignment; }
+
+    // worker: decode, lay out the levels and write them into the ring when there is room
+    void decode(std::shared_ptr<Job> job)
+    {
+        if (job->texture.expired())
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done(lock);
+            return;
+        }
+        {
+            TRACE_SCOPE("Decode texture", "load");
+            MEMORY_SCOPE(Textures);
+            job->image = DecodeImage(job->filename.c_str(), "");
+        }
+        ImageData& image = job->image;
+        job->compressed = !image.compressed.levels.empty();
+        if (!job->compressed && !image.pixels)
+            job->failed = true;
+        else if (job->compressed)
+        {
+            job->format = TextureCompression::Info(image.compressed.format).glFormat;
+            int width = image.width, height = image.height;
+            for (const std::vector<unsigned char>& level : image.compressed.levels)
+            {
+                job->levels.push_back({ job->bytes, level.size(), width, height });
+                job->bytes += Align(level.size());
+                width = std::max(1, width / 2);
+                height = std::max(1, height / 2);
+            }
+        }
+        else
+        {
+            job->format = image.components == 1 ? GL_RED : image.components == 2 ? GL_RG : image.components == 3 ? GL_RGB : GL_RGBA;
+            int width = image.width, height = image.height;
+            for (;;)
+            {
+                size_t size = static_cast<size_t>(width) * height * image.components;
+                job->levels.push_back({ job->bytes, size, width, height });
+                job->bytes += Align(size);
+                if (width == 1 && height == 1)
+                    break;
+                width = std::max(1, width / 2);
+                height = std::max(1, height / 2);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (job->failed)
+        {
+            ready.push_back(job);
+            done(lock);
+            return;
+        }
+        // textures that can never fit keep their levels in memory of their own
+        bool oversized = job->bytes > capacity;
+        if (!oversized && (!waiting.empty() || !reserve(*job)))
+        {
+            waiting.push_back(job);
+            done(lock);
+            return;
+        }
+        lock.unlock();
+        if (oversized)
+        {
+            MEMORY_SCOPE(Textures);
+            job->direct.resize(job->bytes);
+        }
+        fill(job);
+    }
+
+    // worker: writes the levels to where the upload reads them. Reads only from the decoded image
+    // and CPU scratch, the mapped ring is write-combined memory that is slow to read back. Ends the
+    // worker task that called it, which was counted in inFlight.
+    void fill(std::shared_ptr<Job> job)
+    {
+        {
+            TRACE_SCOPE("Fill texture ring", "load");
+            MEMORY_SCOPE(Textures);
+            unsigned char* target = !job->direct.empty() ? job->direct.data() : (mapped ? mapped : staging.data()) + job->ringOffset;
+            ImageData& image = job->image;
+            if (job->compressed)
+            {
+                for (size_t i = 0; i < job->levels.size(); i++)
+                    std::memcpy(target + job->levels[i].offset, image.compressed.levels[i].data(), job->levels[i].size);
+                image.compressed = TextureCompression::CompressedTexture();
+            }
+            else
+            {
+                double mipStart = TraceRecorder::Now();
+                std::memcpy(target, image.pixels, job->levels[0].size);
+                std::vector<unsigned char> previous, next;
+                const unsigned char* source = image.pixels;
+                for (size_t i = 1; i < job->levels.size(); i++)
+                {
+                    const Level& above = job->levels[i - 1];
+                    const Level& level = job->levels[i];
+                    next.resize(level.size);
+                    TextureCompression::DownsampleLevel(source, above.width, above.height, image.components, next.data());
+                    std::memcpy(target + level.offset, next.data(), level.size);
+                    previous.swap(next);
+                    source = previous.data();
+                }
+                stbi_image_free(image.pixels);
+                image.pixels = nullptr;
+                image.mipMs = (TraceRecorder::Now() - mipStart) * 1e-3;
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.push_back(job);
+        done(lock);
+    }
+
+    // A worker task ended, the caller holds the lock. onReady runs while the task still counts:
+    // shutdown() waits for the count and the window onReady talks to goes away right after.
+    void done(std::unique_lock<std::mutex>& lock)
+    {
+        if (onReady)
+            onReady();
+        inFlight--;
+        bool last = inFlight == 0;
+        lock.unlock();
+        if (last)
+            idle.notify_all();
+    }
+
+    // space for the job at the head of the ring, the caller holds the lock
+    bool reserve(Job& job)
+    {
+        size_t size = job.bytes;
+        size_t offset;
+        if (allocations.empty())
+        {
+            if (size > capacity)
+                return false;
+            offset = 0;
+        }
+        else
+        {
+            size_t tail = allocations.front().offset;
+            size_t head = allocations.back().offset + allocations.back().size;
+            if (head > tail)
+            {
+                // free space is after the head and before the tail
+                if (head + size <= capacity)
+                    offset = head;
+                else if (size < tail)
+                    offset = 0;
+                else
+                    return false;
+            }
+            else if (head + size < tail)
+                offset = head;
+            else
+                return false;
+        }
+        job.allocation = nextAllocation++;
+        job.ringOffset = offset;
+        allocations.push_back({ job.allocation, offset, size, false });
+        return true;
+    }
+
+    // GL thread: releases the ring behind the textures the GPU has finished reading
+    void retireFenced()
+    {
+        for (size_t i = 0; i < fenced.size();)
+        {
+            Job& job = *fenced[i];
+            GLenum status = glClientWaitSync(job.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            {
+                i++;
+                continue;
+            }
+            glDeleteSync(job.fence);
+            job.fence = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (Allocation& allocation : allocations)
+                    if (allocation.id == job.allocation)
+                        allocation.released = true;
+                while (!allocations.empty() && allocations.front().released)
+                    allocations.pop_front();
+            }
+            finish(job);
+            fenced.erase(fenced.begin() + i);
+        }
+    }
+
+    // GL thread: defines the texture's levels and uploads as many as the budget allows
+    void uploadLevels(Job& job, const GLTexture& texture, size_t budget, size_t& uploaded)
+    {
+        double start = TraceRecorder::Now();
+        glBindTexture(GL_TEXTURE_2D, texture.get());
+        if (!job.storage)
+        {
+            // contents undefined until uploaded, the base level hides them
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            for (size_t i = 0; i < job.levels.size(); i++)
+            {
+                const Level& level = job.levels[i];
+                if (job.compressed)
+                    glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), job.format, level.width, level.height, 0, static_cast<GLsizei>(level.size), nullptr);
+                else
+                    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), job.format, level.width, level.height, 0, job.format, GL_UNSIGNED_BYTE, nullptr);
+            }
+            size_t bytes = 0;
+            for (const Level& level : job.levels)
+                bytes += level.size;
+            texture.setBytes(bytes);
+            job.nextLevel = static_cast<int>(job.levels.size()) - 1;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, job.nextLevel);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.nextLevel);
+            job.storage = true;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.direct.empty() ? ring.get() : 0);
+        for (; job.nextLevel >= 0; job.nextLevel--)
+        {
+            const Level& level = job.levels[job.nextLevel];
+            if (uploaded > 0 && uploaded + level.size > budget)
+                break;
+            const void* pixels;
+            if (!job.direct.empty())
+                pixels = job.direct.data() + level.offset;
+            else
+            {
+                size_t offset = job.ringOffset + level.offset;
+                if (!mapped)
+                {
+                    // the fences keep the GPU off this range, so the driver needn't wait for it either
+                    void* target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(level.size),
+                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+                    if (target)
+                    {
+                        std::memcpy(target, staging.data() + offset, level.size);
+                        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                    }
+                }
+                pixels = reinterpret_cast<const void*>(offset);
+            }
+            if (job.compressed)
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, job.nextLevel, 0, 0, level.width, level.height, job.format, static_cast<GLsizei>(level.size), pixels);
+            else
+                glTexSubImage2D(GL_TEXTURE_2D, job.nextLevel, 0, 0, level.width, level.height, job.format, GL_UNSIGNED_BYTE, pixels);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.nextLevel);
+            uploaded += level.size;
+        }
+        job.image.uploadMs += (TraceRecorder::Now() - start) * 1e-3;
+    }
+
+    // GL thread: the texture is complete, or given up on
+    void finish(Job& job)
+    {
+        finished++;
+        if (job.failed || job.texture.expired())
+            return;
+        AssetLoadRecord load;
+        load.path = job.filename;
+        load.source = "texture stream";
+        load.totalMs = (TraceRecorder::Now() - job.requested) * 1e-3;
+        RecordTextureLoad(job.image, load);
+        LoadTelemetry::Get().add(load);
+    }
+};
+
+// a placeholder in the texture cache that the streamer fills in, GL thread
+inline std::shared_ptr<GLTexture> StreamTexture(const std::string& filename)
+{
+    std::shared_ptr<GLTexture> texture = TextureCache::Get().insert(filename, TextureStreamer::Placeholder(filename));
+    TextureStreamer::Get().request(filename, texture);
+    return texture;
+}
+
+// TextureFromFile, streamed while the streamer runs
+inline std::shared_ptr<GLTexture> AcquireTexture(const char* path, const std::string& directory)
+{
+    if (!TextureStreamer::Get().enabled())
+        return TextureFromFile(path, directory);
+    std::string filename = ImagePath(path, directory);
+    std::shared_ptr<GLTexture> texture = TextureCache::Get().find(filename);
+    return texture ? texture : StreamTexture(filename);
+}
+
+#endif
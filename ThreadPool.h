@@ -0,0 +1,198 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Trace.h"
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own work from the back
+// and, once empty, steals the oldest task from the front of another worker's deque.
+// Threads that are not part of the pool (the GL thread) help out while they wait in parallelFor.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount)
+        : stopping(false), nextQueue(0), queued(0)
+    {
+        threadCount = std::max(1u, threadCount);
+#if PROFILER_ENABLED
+        // created first so it is destroyed after the pool, workers record until they are joined
+        TraceRecorder::Get();
+#endif
+        for (unsigned int i = 0; i < threadCount; i++)
+            queues.emplace_back(new WorkerQueue());
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // process-wide pool, one thread is left for the caller of parallelFor
+    static ThreadPool& Shared()
+    {
+        static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    // queues a task, tasks submitted from a worker go to that worker's own deque
+    void submit(std::function<void()> task)
+    {
+        int self = CurrentWorker();
+        size_t index = self >= 0 ? static_cast<size_t>(self) : nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // runs body(i) for every i in [0, count) and returns once all of them have finished.
+    // Work is split into a few chunks per thread so that stealing can balance uneven items.
+    // An exception thrown by body ends its chunk and is rethrown here after every chunk is done.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body)
+    {
+        if (count == 0)
+            return;
+        if (count == 1)
+        {
+            body(0);
+            return;
+        }
+        size_t chunkCount = std::min(count, static_cast<size_t>(size() + 1) * 4);
+        size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        std::atomic<size_t> remaining(chunkCount);
+        std::mutex errorMutex;
+        std::exception_ptr error;  // the first one thrown
+        for (size_t c = 0; c < chunkCount; c++)
+        {
+            size_t begin = c * chunkSize;
+            size_t end = std::min(count, begin + chunkSize);
+            submit([&body, &remaining, &errorMutex, &error, begin, end]() {
+                try
+                {
+                    for (size_t i = begin; i < end; i++)
+                        body(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                remaining--;
+            });
+        }
+        // help until every chunk is done instead of blocking the calling thread
+        while (remaining > 0)
+        {
+            std::function<void()> task;
+            if (takeTask(CurrentWorker(), task))
+                task();
+            else
+                std::this_thread::yield();
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::atomic<size_t> nextQueue;
+    // guarded by sleepMutex, lets idle workers sleep instead of spinning. It is signed because a
+    // task can be taken between being pushed and being counted.
+    long queued;
+
+    static int& CurrentWorker()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    // own deque first (newest task, still warm in cache), then steal the oldest task of the others
+    bool takeTask(int self, std::function<void()>& task)
+    {
+        size_t count = queues.size();
+        size_t start = self >= 0 ? static_cast<size_t>(self) : 0;
+        for (size_t n = 0; n < count; n++)
+        {
+            size_t index = (start + n) % count;
+            WorkerQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            if (static_cast<int>(index) == self)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            std::lock_guard<std::mutex> sleepLock(sleepMutex);
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned int index)
+    {
+        CurrentWorker() = static_cast<int>(index);
+        TRACE_THREAD_NAME("Worker " + std::to_string(index));
+        for (;;)
+        {
+            std::function<void()> task;
+            if (takeTask(static_cast<int>(index), task))
+            {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping && queued <= 0)
+                return;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timers. Define PROFILER_ENABLED to 0 to compile the PROFILE_* and TRACE_* macros out
+// entirely, the overlay then only says so.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+struct TraceEvent {
+    const char* name;  // string literal
+    const char* category;
+    double start;     // microseconds since the trace epoch
+    double duration;  // microseconds
+    long long value;  // shown as args.value, -1 for none
+};
+
+// Events of one thread. Only the owning thread writes, with a plain store into the slot and a
+// release store of the counter, so recording never takes a lock. Old events are overwritten once
+// the ring is full. A reader copies the ring and afterwards drops the slots the writer may have
+// overwritten during the copy.
+class TraceBuffer
+{
+public:
+    static const size_t Capacity = 1 << 15;
+
+    explicit TraceBuffer(int threadId) : threadId(threadId), events(Capacity) {}
+
+    const int threadId;
+
+    void push(const TraceEvent& event)
+    {
+        uint64_t index = written.load(std::memory_order_relaxed);
+        events[index & (Capacity - 1)] = event;
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    // appends the events still in the ring, oldest first
+    void snapshot(std::vector<TraceEvent>& out) const
+    {
+        uint64_t end = written.load(std::memory_order_acquire);
+        uint64_t begin = end > Capacity ? end - Capacity : 0;
+        size_t first = out.size();
+        for (uint64_t i = begin; i < end; i++)
+            out.push_back(events[i & (Capacity - 1)]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = written.load(std::memory_order_relaxed);
+        // slots below after + 1 - Capacity were reused while they were copied, the one of event
+        // after too: a push still running writes it before it counts the event
+        if (after + 1 > Capacity && after + 1 - Capacity > begin)
+        {
+            size_t torn = static_cast<size_t>(std::min(after + 1 - Capacity, end) - begin);
+            out.erase(out.begin() + first, out.begin() + first + torn);
+        }
+    }
+
+private:
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> written{ 0 };
+};
+
+// Flight recorder for a Chrome Trace Event file (chrome://tracing, ui.perfetto.dev). Every thread
+// that records gets its own TraceBuffer on its first event, the registry lock is only taken then and
+// when the trace is written. Buffers outlive their threads so a finished worker still shows up.
+class TraceRecorder
+{
+public:
+    static TraceRecorder& Get()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    // microseconds on a monotonic clock, 0 is the first call
+    static double Now()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void record(const char* name, const char* category, double start, double end, long long value = -1)
+    {
+        TraceEvent event = { name, category, start, end - start, value };
+        buffer().push(event);
+    }
+
+    // label of the calling thread in the trace viewer
+    void nameThread(const std::string& name)
+    {
+        TraceBuffer& own = buffer();
+        std::lock_guard<std::mutex> lock(mutex);
+        threadNames[own.threadId - 1] = name;
+    }
+
+    // writes everything still in the rings, returns the number of events or -1 if the file can't be written
+    long write(const std::string& path)
+    {
+        std::vector<std::pair<int, std::string>> threads;
+        std::vector<std::pair<int, std::vector<TraceEvent>>> events;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const std::unique_ptr<TraceBuffer>& thread : buffers)
+            {
+                threads.emplace_back(thread->threadId, threadNames[thread->threadId - 1]);
+                events.emplace_back(thread->threadId, std::vector<TraceEvent>());
+                thread->snapshot(events.back().second);
+            }
+        }
+
+        std::ofstream out(path);
+        if (!out)
+            return -1;
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"InteriorDesigner\"}}";
+        for (const auto& thread : threads)
+        {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first
+                << ",\"args\":{\"name\":\"" << Escape(thread.second) << "\"}}";
+        }
+        long count = 0;
+        char line[512];
+        for (const auto& thread : events)
+        {
+            for (const TraceEvent& event : thread.second)
+            {
+                // names are literals from the code, they don't need escaping
+                int length = event.value >= 0
+                    ? snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%lld}}",
+                        event.name, event.category, thread.first, event.start, event.duration, event.value)
+                    : snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        event.name, event.category, thread.first, event.start, event.duration);
+                out.write(line, std::min(length, static_cast<int>(sizeof(line)) - 1));
+                count++;
+            }
+        }
+        out << "\n]}\n";
+        return out ? count : -1;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<std::string> threadNames;
+
+    TraceBuffer& buffer()
+    {
+        thread_local TraceBuffer* own = nullptr;
+        if (!own)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            int threadId = static_cast<int>(buffers.size()) + 1;
+            buffers.emplace_back(new TraceBuffer(threadId));
+            threadNames.push_back("Thread " + std::to_string(threadId));
+            own = buffers.back().get();
+        }
+        return *own;
+    }
+
+    static std::string Escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+                continue;
+            escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// records the rest of the enclosing block as one event
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category) : name(name), category(category), start(TraceRecorder::Now()) {}
+    ~TraceScope() { TraceRecorder::Get().record(name, category, start, TraceRecorder::Now()); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    double start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+// trace only, for work off the main thread or that doesn't belong in the frame overlay
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
+#define TRACE_THREAD_NAME(name) TraceRecorder::Get().nameThread(name)
+#else
+#define TRACE_SCOPE(name, category) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
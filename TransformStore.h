@@ -0,0 +1,240 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <glm/glm.hpp>
+
+#include "Simd.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if SIMD_SSE2
+// sin and cos of 4 angles in radians (cephes single precision polynomials, ~1e-7 error for
+// angles in the range of a few thousand radians)
+inline void SinCos4(__m128 x, __m128& sine, __m128& cosine)
+{
+    // quadrant j = round(x / (pi / 2)), r = x - j * pi / 2 in three steps to keep the precision
+    __m128i j = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236758134f)));
+    __m128 jf = _mm_cvtepi32_ps(j);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(jf, _mm_set1_ps(1.5703125f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(jf, _mm_set1_ps(4.837512969970703125e-4f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(jf, _mm_set1_ps(7.54978995489188216e-8f)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    // polynomials on [-pi/4, pi/4]
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+    c = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c, r2), r2), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))));
+
+    // odd quadrants swap sin and cos, the sign follows bit 1 of j for sin and of j + 1 for cos
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+    cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+}
+#endif
+
+// Position, rotation (degrees, applied Y then X then Z like Model::GetTransformMatrix) and scale
+// of the scene objects, stored per component so the matrices can be rebuilt 4 objects at a time.
+// Setters only mark an object dirty, update() rebuilds the matrices of the dirty objects.
+// Indices are the dense indices of SceneStore.
+class TransformStore
+{
+public:
+    size_t size() const { return dirty.size(); }
+
+    size_t add(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+    {
+        size_t index = size();
+        for (int k = 0; k < 3; k++)
+        {
+            positions[k].push_back(position[k]);
+            rotations[k].push_back(rotation[k]);
+            scales[k].push_back(scale[k]);
+        }
+        matrices.push_back(glm::mat4(1.0f));
+        dirty.push_back(0);
+        markDirty(index);
+        return index;
+    }
+
+    // the last object takes the place of the removed one, like the other components of SceneStore
+    void remove(size_t index)
+    {
+        size_t last = size() - 1;
+        if (dirty[index] || dirty[last])
+        {
+            // the removed index leaves the queue, the moved one is queued under its new index
+            for (size_t i = 0; i < dirtyList.size();)
+            {
+                if (dirtyList[i] == index)
+                {
+                    dirtyList[i] = dirtyList.back();
+                    dirtyList.pop_back();
+                    continue;
+                }
+                if (dirtyList[i] == last)
+                    dirtyList[i] = static_cast<unsigned int>(index);
+                i++;
+            }
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            positions[k][index] = positions[k][last];
+            rotations[k][index] = rotations[k][last];
+            scales[k][index] = scales[k][last];
+            positions[k].pop_back();
+            rotations[k].pop_back();
+            scales[k].pop_back();
+        }
+        matrices[index] = matrices[last];
+        matrices.pop_back();
+        dirty[index] = dirty[last];
+        dirty.pop_back();
+    }
+
+    void clear()
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            positions[k].clear();
+            rotations[k].clear();
+            scales[k].clear();
+        }
+        matrices.clear();
+        dirty.clear();
+        dirtyList.clear();
+    }
+
+    glm::vec3 position(size_t index) const { return glm::vec3(positions[0][index], positions[1][index], positions[2][index]); }
+    glm::vec3 rotation(size_t index) const { return glm::vec3(rotations[0][index], rotations[1][index], rotations[2][index]); }
+    glm::vec3 scale(size_t index) const { return glm::vec3(scales[0][index], scales[1][index], scales[2][index]); }
+
+    void setPosition(size_t index, const glm::vec3& value) { set(positions, index, value); }
+    void setRotation(size_t index, const glm::vec3& value) { set(rotations, index, value); }
+    void setScale(size_t index, const glm::vec3& value) { set(scales, index, value); }
+
+    bool isDirty(size_t index) const { return dirty[index] != 0; }
+    size_t dirtyCount() const { return dirtyList.size(); }
+
+    // cached object to world matrix, current as of the last update()
+    const glm::mat4& world(size_t index) const { return matrices[index]; }
+
+    // rebuilds the matrices of the dirty objects and calls changed(index) for each of them
+    template <typename Callback>
+    size_t update(Callback changed)
+    {
+        size_t count = dirtyList.size();
+        size_t i = 0;
+#if SIMD_SSE2
+        for (; i + 4 <= count; i += 4)
+            compose4(&dirtyList[i]);
+#endif
+        for (; i < count; i++)
+            compose(dirtyList[i]);
+        for (unsigned int index : dirtyList)
+        {
+            dirty[index] = 0;
+            changed(index);
+        }
+        dirtyList.clear();
+        return count;
+    }
+
+    size_t update() { return update([](size_t) {}); }
+
+private:
+    std::vector<float> positions[3];
+    std::vector<float> rotations[3];
+    std::vector<float> scales[3];
+    std::vector<glm::mat4> matrices;
+    std::vector<unsigned char> dirty;
+    std::vector<unsigned int> dirtyList;  // every dirty index once, in the order they were marked
+
+    void set(std::vector<float> (&components)[3], size_t index, const glm::vec3& value)
+    {
+        for (int k = 0; k < 3; k++)
+            components[k][index] = value[k];
+        markDirty(index);
+    }
+
+    void markDirty(size_t index)
+    {
+        if (dirty[index])
+            return;
+        dirty[index] = 1;
+        dirtyList.push_back(static_cast<unsigned int>(index));
+    }
+
+    // translate * rotateY * rotateX * rotateZ * scale, written out so every sin/cos is computed once
+    void compose(unsigned int index)
+    {
+        const float toRadians = 0.017453292519943295f;
+        float sx = std::sin(rotations[0][index] * toRadians), cx = std::cos(rotations[0][index] * toRadians);
+        float sy = std::sin(rotations[1][index] * toRadians), cy = std::cos(rotations[1][index] * toRadians);
+        float sz = std::sin(rotations[2][index] * toRadians), cz = std::cos(rotations[2][index] * toRadians);
+        // rows of Ry * Rx
+        float a00 = cy, a01 = sy * sx, a02 = sy * cx;
+        float a11 = cx, a12 = -sx;
+        float a20 = -sy, a21 = cy * sx, a22 = cy * cx;
+
+        glm::mat4& m = matrices[index];
+        float scaleX = scales[0][index], scaleY = scales[1][index], scaleZ = scales[2][index];
+        m[0] = glm::vec4((a00 * cz + a01 * sz) * scaleX, a11 * sz * scaleX, (a20 * cz + a21 * sz) * scaleX, 0.0f);
+        m[1] = glm::vec4((a01 * cz - a00 * sz) * scaleY, a11 * cz * scaleY, (a21 * cz - a20 * sz) * scaleY, 0.0f);
+        m[2] = glm::vec4(a02 * scaleZ, a12 * scaleZ, a22 * scaleZ, 0.0f);
+        m[3] = glm::vec4(positions[0][index], positions[1][index], positions[2][index], 1.0f);
+    }
+
+#if SIMD_SSE2
+    // same as compose for 4 objects, one lane each
+    void compose4(const unsigned int* indices)
+    {
+        auto gather = [&](const std::vector<float>& component) {
+            return _mm_setr_ps(component[indices[0]], component[indices[1]], component[indices[2]], component[indices[3]]);
+        };
+        const __m128 toRadians = _mm_set1_ps(0.017453292519943295f);
+        __m128 sx, cx, sy, cy, sz, cz;
+        SinCos4(_mm_mul_ps(gather(rotations[0]), toRadians), sx, cx);
+        SinCos4(_mm_mul_ps(gather(rotations[1]), toRadians), sy, cy);
+        SinCos4(_mm_mul_ps(gather(rotations[2]), toRadians), sz, cz);
+        const __m128 zero = _mm_setzero_ps();
+
+        __m128 a00 = cy, a01 = _mm_mul_ps(sy, sx), a02 = _mm_mul_ps(sy, cx);
+        __m128 a11 = cx, a12 = _mm_sub_ps(zero, sx);
+        __m128 a20 = _mm_sub_ps(zero, sy), a21 = _mm_mul_ps(cy, sx), a22 = _mm_mul_ps(cy, cx);
+        __m128 scaleX = gather(scales[0]), scaleY = gather(scales[1]), scaleZ = gather(scales[2]);
+
+        // one register per matrix element, lane i belongs to object i
+        __m128 columns[4][4] = {
+            { _mm_mul_ps(_mm_add_ps(_mm_mul_ps(a00, cz), _mm_mul_ps(a01, sz)), scaleX),
+              _mm_mul_ps(_mm_mul_ps(a11, sz), scaleX),
+              _mm_mul_ps(_mm_add_ps(_mm_mul_ps(a20, cz), _mm_mul_ps(a21, sz)), scaleX),
+              zero },
+            { _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a01, cz), _mm_mul_ps(a00, sz)), scaleY),
+              _mm_mul_ps(_mm_mul_ps(a11, cz), scaleY),
+              _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a21, cz), _mm_mul_ps(a20, sz)), scaleY),
+              zero },
+            { _mm_mul_ps(a02, scaleZ), _mm_mul_ps(a12, scaleZ), _mm_mul_ps(a22, scaleZ), zero },
+            { gather(positions[0]), gather(positions[1]), gather(positions[2]), _mm_set1_ps(1.0f) }
+        };
+        // transposing a column turns the 4 lanes into the 4 objects
+        for (int column = 0; column < 4; column++)
+        {
+            __m128 x = columns[column][0], y = columns[column][1], z = columns[column][2], w = columns[column][3];
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(&matrices[indices[0]][column][0], x);
+            _mm_storeu_ps(&matrices[indices[1]][column][0], y);
+            _mm_storeu_ps(&matrices[indices[2]][column][0], z);
+            _mm_storeu_ps(&matrices[indices[3]][column][0], w);
+        }
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Triangle {
+    glm::vec3 v0, v1, v2;
+};
+
+// appends the triangles of an indexed mesh, positions are read with a byte stride like BuildMeshlets
+inline void AppendTriangles(const float* positions, size_t strideBytes, const unsigned int* indices, size_t indexCount, std::vector<Triangle>& triangles)
+{
+    auto position = [&](unsigned int index) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * strideBytes);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    triangles.reserve(triangles.size() + indexCount / 3);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+        triangles.push_back(Triangle{ position(indices[i]), position(indices[i + 1]), position(indices[i + 2]) });
+}
+
+// Static BVH over the triangles of one asset, in object space, used to pick objects with the mouse.
+// Leaves hold up to 4 triangles stored as one SoA block (v0, edge1, edge2) so a single SSE
+// Moller-Trumbore test checks the whole leaf. Built once per asset and shared by every instance.
+class TriangleBVH
+{
+public:
+    TriangleBVH() = default;
+
+    explicit TriangleBVH(std::vector<Triangle> triangles)
+    {
+        build(std::move(triangles));
+    }
+
+    void build(std::vector<Triangle> triangles)
+    {
+        nodes.clear();
+        blocks.clear();
+        triangleCount = triangles.size();
+        if (triangles.empty())
+            return;
+
+        std::vector<BuildItem> items(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            items[i].box.expand(triangles[i].v0);
+            items[i].box.expand(triangles[i].v1);
+            items[i].box.expand(triangles[i].v2);
+            items[i].centroid = items[i].box.center();
+            items[i].triangle = static_cast<unsigned int>(i);
+        }
+        nodes.reserve(2 * (triangles.size() / BlockSize + 1));
+        blocks.reserve(triangles.size() / BlockSize + 1);
+        buildNode(items, 0, items.size(), triangles);
+    }
+
+    size_t triangles() const { return triangleCount; }
+    size_t bytes() const { return nodes.capacity() * sizeof(Node) + blocks.capacity() * sizeof(Block); }
+    AABB bounds() const { return nodes.empty() ? AABB() : nodes[0].box; }
+
+    // closest hit along the ray in (0, maxT), both faces count. t is in units of direction,
+    // so a ray transformed into object space with an unnormalized direction keeps world distances.
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxT, float& t) const
+    {
+        if (nodes.empty())
+            return false;
+        glm::vec3 inverseDirection = 1.0f / direction;
+        float closest = maxT;
+        float entry;
+        if (!nodes[0].box.intersectsRay(origin, inverseDirection, closest, entry))
+            return false;
+
+        int stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const Node& node = nodes[stack[--stackSize]];
+            if (!node.box.intersectsRay(origin, inverseDirection, closest, entry))
+                continue;
+            if (node.count > 0)
+            {
+                intersectBlock(blocks[node.index], origin, direction, closest);
+                continue;
+            }
+            // visit the nearer child first, the far one is often pruned by its hit
+            int left = static_cast<int>(&node - nodes.data()) + 1;
+            int right = node.index;
+            float tLeft, tRight;
+            bool hitLeft = nodes[left].box.intersectsRay(origin, inverseDirection, closest, tLeft);
+            bool hitRight = nodes[right].box.intersectsRay(origin, inverseDirection, closest, tRight);
+            if (hitLeft && hitRight)
+            {
+                stack[stackSize++] = tLeft <= tRight ? right : left;
+                stack[stackSize++] = tLeft <= tRight ? left : right;
+            }
+            else if (hitLeft)
+                stack[stackSize++] = left;
+            else if (hitRight)
+                stack[stackSize++] = right;
+        }
+        if (closest >= maxT)
+            return false;
+        t = closest;
+        return true;
+    }
+
+private:
+    static const int BlockSize = 4;
+
+    // internal nodes: count 0, the left child follows the node, index is the right child.
+    // leaves: count triangles in blocks[index]
+    struct Node {
+        AABB box;
+        int index = 0;
+        int count = 0;
+    };
+
+    // 4 triangles, unused lanes are zero and never hit (their determinant is 0)
+    struct alignas(16) Block {
+        float v0[3][BlockSize];
+        float e1[3][BlockSize];
+        float e2[3][BlockSize];
+    };
+
+    struct BuildItem {
+        AABB box;
+        glm::vec3 centroid;
+        unsigned int triangle;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Block> blocks;
+    size_t triangleCount = 0;
+
+    // median split on the longest centroid axis, depth stays around log2(n / 4) which fits the traversal stack
+    void buildNode(std::vector<BuildItem>& items, size_t begin, size_t end, const std::vector<Triangle>& triangles)
+    {
+        size_t nodeIndex = nodes.size();
+        nodes.push_back(Node());
+        AABB box, centroids;
+        for (size_t i = begin; i < end; i++)
+        {
+            box.expand(items[i].box);
+            centroids.expand(items[i].centroid);
+        }
+        nodes[nodeIndex].box = box;
+
+        if (end - begin <= BlockSize)
+        {
+            nodes[nodeIndex].index = static_cast<int>(blocks.size());
+            nodes[nodeIndex].count = static_cast<int>(end - begin);
+            blocks.push_back(makeBlock(items, begin, end, triangles));
+            return;
+        }
+
+        glm::vec3 size = centroids.max - centroids.min;
+        int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+        size_t middle = begin + (end - begin) / 2;
+        std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+            [axis](const BuildItem& a, const BuildItem& b) { return a.centroid[axis] < b.centroid[axis]; });
+
+        buildNode(items, begin, middle, triangles);
+        int right = static_cast<int>(nodes.size());
+        buildNode(items, middle, end, triangles);
+        nodes[nodeIndex].index = right;
+    }
+
+    static Block makeBlock(const std::vector<BuildItem>& items, size_t begin, size_t end, const std::vector<Triangle>& triangles)
+    {
+        Block block = {};
+        for (size_t i = begin; i < end; i++)
+        {
+            const Triangle& triangle = triangles[items[i].triangle];
+            glm::vec3 e1 = triangle.v1 - triangle.v0;
+            glm::vec3 e2 = triangle.v2 - triangle.v0;
+            size_t lane = i - begin;
+            for (int k = 0; k < 3; k++)
+            {
+                block.v0[k][lane] = triangle.v0[k];
+                block.e1[k][lane] = e1[k];
+                block.e2[k][lane] = e2[k];
+            }
+        }
+        return block;
+    }
+
+    // Moller-Trumbore against the 4 triangles of a block, closest is lowered to the nearest hit
+    static void intersectBlock(const Block& block, const glm::vec3& origin, const glm::vec3& direction, float& closest)
+    {
+#if SIMD_SSE2
+        const __m128 epsilon = _mm_set1_ps(1e-12f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+        __m128 e1x = _mm_load_ps(block.e1[0]), e1y = _mm_load_ps(block.e1[1]), e1z = _mm_load_ps(block.e1[2]);
+        __m128 e2x = _mm_load_ps(block.e2[0]), e2y = _mm_load_ps(block.e2[1]), e2z = _mm_load_ps(block.e2[2]);
+
+        // p = direction x e2, det = e1 . p
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 valid = _mm_cmpgt_ps(_mm_and_ps(det, absMask), epsilon);
+        // lanes with det 0 give inf/nan here, they are masked out by valid
+        __m128 inverseDet = _mm_div_ps(one, det);
+
+        // s = origin - v0, u = (s . p) / det
+        __m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_load_ps(block.v0[0]));
+        __m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_load_ps(block.v0[1]));
+        __m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_load_ps(block.v0[2]));
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+
+        // q = s x e1, v = (direction . q) / det, t = (e2 . q) / det
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+        valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, zero));
+        valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+        int mask = _mm_movemask_ps(valid);
+        if (mask == 0)
+            return;
+        alignas(16) float distances[BlockSize];
+        _mm_store_ps(distances, t);
+        for (int lane = 0; lane < BlockSize; lane++)
+            if (mask & (1 << lane))
+                closest = std::min(closest, distances[lane]);
+#else
+        for (int lane = 0; lane < BlockSize; lane++)
+        {
+            glm::vec3 e1(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+            glm::vec3 e2(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+            glm::vec3 p = glm::cross(direction, e2);
+            float det = glm::dot(e1, p);
+            if (std::abs(det) <= 1e-12f)
+                continue;
+            float inverseDet = 1.0f / det;
+            glm::vec3 s = origin - glm::vec3(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+            float u = glm::dot(s, p) * inverseDet;
+            glm::vec3 q = glm::cross(s, e1);
+            float v = glm::dot(direction, q) * inverseDet;
+            float t = glm::dot(e2, q) * inverseDet;
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < closest)
+                closest = t;
+        }
+#endif
+    }
+};
+
+// Triangle BVHs shared by asset path. Like TextureCache only weak references are kept, the
+// BVH goes away with the last model using it.
+class TriangleBVHCache
+{
+public:
+    static TriangleBVHCache& Get()
+    {
+        static TriangleBVHCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const TriangleBVH> find(const std::string& path) const
+    {
+        auto it = entries.find(path);
+        return it != entries.end() ? it->second.lock() : std::shared_ptr<const TriangleBVH>();
+    }
+
+    std::shared_ptr<const TriangleBVH> insert(const std::string& path, std::vector<Triangle> triangles)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+        std::shared_ptr<const TriangleBVH> bvh = std::make_shared<TriangleBVH>(std::move(triangles));
+        entries[path] = bvh;
+        return bvh;
+    }
+
+private:
+    std::map<std::string, std::weak_ptr<const TriangleBVH>> entries;
+};
+
+#endif
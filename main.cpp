@@ -13,14 +13,76 @@
 #include "Camera.h"
 #include "Shader.h"
 #include "Snapshot.h"
+#include "Benchmark.h"
+#include "MicroBench.h"
+#include "SceneStore.h"
+#include "Outliner.h"
 
 #include <iostream>
 #include <chrono>
+#include <ctime>
+#include <future>
 #define NOMINMAX
 #ifdef _WIN32
 #include <windows.h>
+#include <commdlg.h>
+#endif
+
+#include "ProcessStats.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "Offscreen.h"
+#include "PngWriter.h"
+#include "BatchRender.h"
+#include "CameraPath.h"
+#include "StressScene.h"
+#include "MemoryTracker.h"
+#include "AssetAudit.h"
+
+#if MEMORY_TRACKING_ENABLED
+// every C++ heap block of the program goes through MemoryTracker, see MemoryTracker.h
+void* operator new(size_t size)
+{
+    for (;;)
+    {
+        if (void* memory = MemoryTracker::Allocate(size))
+            return memory;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, size_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, size_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { MemoryTracker::Free(memory); }
 #endif
-#include <commdlg.h>  
 
 
 
@@ -34,6 +96,12 @@ Camera camera(CAM_WIDTH, CAM_HEIGHT, 45.0f, glm::vec3(0.0f, 0.0f, 2.0f));
 // room
 Model room;
 
+// draws only when something changed, --continuous draws every frame
+FrameScheduler frameScheduler(1.0 / 60.0, false);
+// textures of the window's models are decoded and uploaded over the following frames, --no-streaming
+// loads them before the model like the command line modes do
+bool textureStreaming = true;
+
 Shader ourShader;
 
 
@@ -45,16 +113,16 @@ bool showChooseWindow = false;
 bool ImGuiHandlingInput = false;
 
 
-std::vector<Model> models;  //vector of objects
-std::vector<std::string> modelNames;    //vector of objects names
-    
-int selectedId = -1; // id of the selected model
+SceneStore scene;  // placed objects
+SceneHandle selected;  // selected object, a default handle selects nothing
 
 //transform variables
 glm::vec3 posXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
 float rot = 0.0f;
 
+// the file dialogs are Windows only, elsewhere they return "" as if cancelled
 std::string OpenFileDialog() {
+#ifdef _WIN32
     OPENFILENAME ofn;       // common dialog box structure
     char szFile[260];       // buffer for file name
     HWND hwnd = NULL;       // owner window
@@ -95,9 +163,11 @@ std::string OpenFileDialog() {
         CloseHandle(hf);
         return ofn.lpstrFile;
     }
+#endif
     return "";
 }
 std::string SaveFileDialog() {
+#ifdef _WIN32
     OPENFILENAME ofn;
     char szFile[260];
     HWND hwnd = NULL;
@@ -130,56 +200,102 @@ std::string SaveFileDialog() {
             (HANDLE)NULL);
         return filepath;
     }
+#endif
     return "";
 }
 
 std::string object;
-// function to handle the names of generated objects in the dropdown menu
-std::string GenerateUniqueName(const std::string& defaultName) {
-    int cnt = 0;
-    std::string newName = defaultName;
-    while (std::find(modelNames.begin(), modelNames.end(), newName) != modelNames.end()) {
-        newName = defaultName + std::to_string(cnt);
-        cnt++;
-    }
-    return newName;
-}
 
-// function to generate and render an object
-void GenerateObject(std::string name, const std::string& texName, Shader& ourShader, int id, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale,std::string menuName) {
-    // load the model
-    Model ourModel("resources/objects/" + name, id, position, rotation, scale);
-    ourModel.objectName = menuName;
-    //ourModel.textureName = texName;
+// textures of an asset are part of its key, the same file can be placed with different textures
+std::string AssetKey(const std::string& path, const std::vector<Texture>& textures) {
+    std::string key = path;
+    for (const Texture& texture : textures)
+        key += "|" + texture.path;
+    return key;
+}
 
-    std::string uniqueName = GenerateUniqueName(menuName); 
-    modelNames.push_back(uniqueName);
+// replaces the material textures of a model, ids come from the texture cache
+void AttachTextures(Model& model, const std::vector<Texture>& textures) {
+    model.textures_loaded.clear(); // clear existing textures (if any)
+    model.textureHandles.clear();
+    for (Texture texture : textures) {
+        std::shared_ptr<GLTexture> textureHandle = AcquireTexture(texture.path.c_str(), "resources/objects");
+        texture.id = textureHandle->get();
+        model.textures_loaded.push_back(texture);
+        model.textureHandles.push_back(textureHandle);
+    }
+}
 
-    GLuint textureID = TextureFromFile(texName.c_str(), "resources/objects");
+// loads an asset, or returns the one already used by other objects, textures replace its own materials
+std::shared_ptr<Model> AcquireAsset(const std::string& path, const std::vector<Texture>& textures, const std::string& objectName) {
+    std::string key = AssetKey(path, textures);
+    std::shared_ptr<Model> asset = AssetLibrary::Get().find(key);
+    if (asset)
+        return asset;
+
+    Model model(path, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+    model.objectName = objectName;
+    AttachTextures(model, textures);
+    model.buildPickBVH();
+    return AssetLibrary::Get().insert(key, std::move(model));
+}
 
-    // set the texture for the generated model
-    ourModel.textures_loaded.clear(); // clear existing textures (if any)
+// function to generate and render an object
+SceneHandle GenerateObject(std::string name, const std::string& texName, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale,std::string menuName) {
+    PROFILE_SCOPE("Generate object");
     Texture texture;
-    texture.id = textureID;
-    texture.type = "texture_diffuse"; 
+    texture.id = 0;
+    texture.type = "texture_diffuse";
     texture.path = texName;
-    ourModel.textures_loaded.push_back(texture);
-    
-    std::cout << "Texture ID for model " << menuName << ": " << textureID << std::endl;
-    models.push_back(ourModel);
+    std::shared_ptr<Model> asset = AcquireAsset("resources/objects/" + name, std::vector<Texture>(1, texture), menuName);
+    return scene.add(asset, menuName, position, rotation, scale);
+}
+
+// the objects of the Generate menu, with the texture and scale they are placed with
+struct FurnitureItem {
+    const char* label;
+    const char* file;
+    const char* texture;
+    float rotationZ;
+    float scale;
+    const char* name;
+};
+
+const FurnitureItem furnitureCatalog[] = {
+    { "Chair1", "chair1.fbx", "texture_diffuse1.jpg", 0.0f, 0.8f, "Chair1" },
+    { "Dresser", "Dresser.fbx", "texture_diffuse3.jpg", 0.0f, 0.5f, "Dresser" },
+    { "Table", "table1.fbx", "texture_diffuse4.jpg", 0.0f, 0.5f, "Table" },
+    { "Dresser2", "dresser2.fbx", "texture_diffuse5.jpg", 0.0f, 0.7f, "Dresser2" },
+    { "Desk", "desk.fbx", "texture_diffuse6.jpg", 0.0f, 0.4f, "Desk" },
+    { "Table2", "table2.fbx", "texture_diffuse1.jpg", 0.0f, 0.1f, "Table2" },
+    { "Couch1", "couch1.fbx", "texture_diffuse7.jpg", 45.0f, 0.3f, "couch1" },
+    { "Couch2", "couch2.fbx", "texture_diffuse7.jpg", 45.0f, 0.3f, "couch2" },
+    { "Chair2", "chair2.fbx", "texture_diffuse8.jpg", 0.0f, 0.4f, "Chair2" },
+};
+const int furnitureCount = sizeof(furnitureCatalog) / sizeof(furnitureCatalog[0]);
+
+SceneHandle GenerateFurniture(const FurnitureItem& item, glm::vec3 position, float rotationY) {
+    return GenerateObject(item.file, item.texture, position, glm::vec3(0.0f, rotationY, item.rotationZ), glm::vec3(item.scale), item.name);
+}
+
+// the furniture catalog as the stress scene generator takes it
+std::vector<StressScene::Asset> StressAssets() {
+    std::vector<StressScene::Asset> assets;
+    for (const FurnitureItem& item : furnitureCatalog)
+        assets.push_back(StressScene::Asset{ std::string("resources/objects/") + item.file, item.texture, item.scale, item.rotationZ, item.name });
+    return assets;
 }
 
 // function to delete a specific object
-void DeleteObject(std::string name,int id) {
-    models.erase(models.begin()+id);
-    modelNames.erase(modelNames.begin() + id);
+void DeleteObject(SceneHandle handle) {
+    scene.remove(handle);
 }
 // vector to determine which room to load
 std::vector<std::string> roomModelNames = { "room.fbx", "room1.fbx" };
 std::string selectedRoomModel;
 
-void saveGameState(const std::string& filepath, const std::vector<Model>& models, const std::string& selectedRoomModel);
-void loadGameState(const std::string& filepath, std::vector<Model>& models, Shader& ourShader, string& selectedRoomModel);
+void saveGameState(const std::string& filepath, const SceneStore& scene, const std::string& selectedRoomModel);
+bool loadGameState(const std::string& filepath, SceneStore& scene, Shader& ourShader, string& selectedRoomModel);
 
 void DisplaySecondaryWindow() {
     showMainMenu = false;
@@ -235,7 +351,7 @@ void MainMenu() {
         std::string filepath = OpenFileDialog();
         if (!filepath.empty()) {
             // Handle button click and loading scene
-            loadGameState(filepath, models, ourShader, selectedRoomModel);
+            loadGameState(filepath, scene, ourShader, selectedRoomModel);
             DisplayModelWindow();
         }
     }
@@ -267,17 +383,17 @@ void SecondaryWindow() {
     ImGui::End();
 }
 // load and store textures for icons
-GLuint LoadTexture(const char* filename) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
+GLTexture LoadTexture(const char* filename) {
+    GLTexture texture = GLTexture::Create(std::string("icon ") + filename);
 
     int width, height, channels;
     unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
     if (image) {
         GLenum format = (channels == 3) ? GL_RGB : GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        glBindTexture(GL_TEXTURE_2D, texture.get());
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
+        texture.setBytes(static_cast<size_t>(width) * height * channels * 4 / 3);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -292,11 +408,11 @@ GLuint LoadTexture(const char* filename) {
         std::cerr << "Failed to load texture: " << filename << " | Reason: " << stbi_failure_reason() << std::endl;
     }
 
-    return textureID;
+    return texture;
 }
 
 //global variables of textures
-GLuint texture1, texture2, texture3, texture4;
+GLTexture texture1, texture2;
 
 void LoadTextures() {
     texture1 = LoadTexture("resources/images/image1.png");
@@ -327,8 +443,8 @@ void ChooseWindow() {
     float buttonWidth = 150.0f;  // Adjusted button width
 
     ImTextureID imguiTextureIDs[] = {
-        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture1)),
-        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture2))
+        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture1.get())),
+        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture2.get()))
     };
 
     // Check if there are enough textures for buttons
@@ -367,71 +483,181 @@ void ChooseWindow() {
     ImGui::End();
 }
 
+// meshlet culling switches for the room and the counters of the last frame
+MeshletCullContext meshletCulling;
+MeshletStats meshletStats;
+
+// room preset currently held in room, it is only reloaded when the selection changes
+std::string loadedRoomModel;
+
 void initializeScene(Shader& ourShader,const char* texName,const std::string roomObj) {
-    room = Model("resources/objects/" + roomObj,glm::vec3(0.0f,0.0f,0.0f),glm::vec3(0.0f,0.0f,0.0f),glm::vec3(1.0f,1.0f,1.0f));
-    TextureFromFile(texName, "resources/objects");
+    if (roomObj != loadedRoomModel) {
+        room = Model("resources/objects/" + roomObj,glm::vec3(0.0f,0.0f,0.0f),glm::vec3(0.0f,0.0f,0.0f),glm::vec3(1.0f,1.0f,1.0f));
+        // the room is drawn with this texture on unit 0 unless its own materials override it
+        std::shared_ptr<GLTexture> textureHandle = AcquireTexture(texName, "resources/objects");
+        Texture texture;
+        texture.id = textureHandle->get();
+        texture.type = "texture_diffuse";
+        texture.path = texName;
+        room.textures_loaded.push_back(texture);
+        room.textureHandles.push_back(textureHandle);
+        room.buildMeshlets();
+        loadedRoomModel = roomObj;
+    }
     ourShader.use();
     glActiveTexture(GL_TEXTURE0);
 }
+// camera movement runs in fixed steps, the same distance per second at any frame rate
+FixedTimestep cameraStep(1.0 / 120.0);
+double lastCameraUpdate = 0.0;
+bool cameraMoving = false;
+
 void UpdateCamera(GLFWwindow* window, Camera& camera, bool ImGuiHandlingInput) {
+    double now = glfwGetTime();
+    // after the camera stood still (maybe for a long idle wait) it starts moving from this frame on
+    double frameTime = cameraMoving ? now - lastCameraUpdate : 0.0;
+    lastCameraUpdate = now;
+    if (!cameraMoving)
+        cameraStep.reset();
+    cameraMoving = false;
     if (!ImGuiHandlingInput) {
         camera.updateMatrix(camera.zoom, 0.1f, 100.0f);
-        camera.Inputs(window);
+        camera.Look(window);
+        int steps = cameraStep.advance(frameTime);
+        for (int i = 0; i < steps; i++)
+            camera.Move(window, static_cast<float>(cameraStep.step));
+        // a held key keeps the camera moving without new events, so the next frame is requested here
+        cameraMoving = camera.MoveKeysHeld(window);
+        if (cameraMoving)
+            frameScheduler.invalidate();
     }
 }
-void RenderGUI(int& selectedId, std::vector<Model>& models, std::vector<std::string>& modelNames) {
-    // dropdown menu for every object
-    const char* combo_preview = selectedId >= 0 ? modelNames[selectedId].c_str() : "Select a model";
-    if (ImGui::BeginCombo("Model", combo_preview)) {
-        for (int i = 0; i < modelNames.size(); i++) {
-            bool isSelected = (selectedId == i);
-            if (ImGui::Selectable(modelNames[i].c_str(), isSelected)) {
-                selectedId = i;
-            }
-            if (isSelected) {
-                ImGui::SetItemDefaultFocus();
-            }
-        }
-        ImGui::EndCombo();
-    }
+void RenderGUI(SceneHandle& selected, SceneStore& scene) {
+    // objects are chosen in the outliner or by right clicking them
+    int selectedIndex = scene.indexOf(selected);
+    ImGui::Text("Model: %s", selectedIndex >= 0 ? scene.names[selectedIndex].c_str() : "none (select one in the Outliner)");
     // options for every object generated
-    if (selectedId >= 0 && selectedId < models.size()) {
+    if (selectedIndex >= 0) {
         // Sliders for changing position and rotation
-        ImGui::SliderFloat("X Position", &models[selectedId].position.x, -30.0f, 30.0f);
-        ImGui::SliderFloat("Y Position", &models[selectedId].position.y, -30.0f, 30.0f);
-        ImGui::SliderFloat("Z Position", &models[selectedId].position.z, -30.0f, 30.0f);
-        ImGui::SliderFloat("Rotation Y", &models[selectedId].rotation.y, -180.0f, 180.0f);
-        ImGui::SliderFloat("Rotation X", &models[selectedId].rotation.x, -180.0f, 180.0f);
-        ImGui::SliderFloat("Rotation Z", &models[selectedId].rotation.z, -180.0f, 180.0f);
+        glm::vec3 position = scene.transforms.position(selectedIndex);
+        glm::vec3 rotation = scene.transforms.rotation(selectedIndex);
+        bool moved = false;
+        moved |= ImGui::SliderFloat("X Position", &position.x, -30.0f, 30.0f);
+        moved |= ImGui::SliderFloat("Y Position", &position.y, -30.0f, 30.0f);
+        moved |= ImGui::SliderFloat("Z Position", &position.z, -30.0f, 30.0f);
+        moved |= ImGui::SliderFloat("Rotation Y", &rotation.y, -180.0f, 180.0f);
+        moved |= ImGui::SliderFloat("Rotation X", &rotation.x, -180.0f, 180.0f);
+        moved |= ImGui::SliderFloat("Rotation Z", &rotation.z, -180.0f, 180.0f);
+        if (moved) {
+            scene.transforms.setPosition(selectedIndex, position);
+            scene.transforms.setRotation(selectedIndex, rotation);
+            scene.update();
+        }
 
-        if (ImGui::Button("Delete")) {
-            DeleteObject(modelNames[selectedId], selectedId);
-            // after deleting an object update the id, and check if the vector is empty
-            if (models.empty()) {
-                selectedId = -1;
-            }
-            else {
-                selectedId = std::min(selectedId, static_cast<int>(models.size()) - 1);
+        // other objects whose bounds intersect the selected one
+        AABB selectedBounds = scene.worldBounds(selectedIndex);
+        std::string overlapping;
+        scene.queryOverlap(selectedBounds, [&](int index) {
+            if (index != selectedIndex && scene.worldBounds(index).overlaps(selectedBounds)) {
+                overlapping += (overlapping.empty() ? "" : ", ") + scene.names[index];
             }
+        });
+        ImGui::TextWrapped("Overlaps: %s", overlapping.empty() ? "none" : overlapping.c_str());
+
+        if (ImGui::Button("Delete")) {
+            DeleteObject(selected);
+            selected = SceneHandle();
         }
     }
 }
 
-void RenderModels(Shader& ourShader, const std::vector<Model>& models) {
-    for (const Model& model : models) {
+// object culling switch, the counters of the last frame and the radius of the "near the camera" query
+bool objectCulling = true;
+size_t objectsDrawn = 0;
+size_t objectDrawCalls = 0;
+size_t objectTriangles = 0;
+float nearRadius = 3.0f;
+std::vector<int> visibleModels;
+
+// fills visibleModels with the objects to draw this frame
+void CullModels(SceneStore& scene) {
+    PROFILE_SCOPE("Object culling");
+    scene.update();
+    visibleModels.clear();
+    if (objectCulling) {
+        Frustum frustum = Frustum::FromMatrix(camera.cameraMatrix);
+        scene.queryFrustum(frustum, [&](int index) {
+            // the tree only knows the enlarged boxes
+            if (frustum.intersectsAABB(scene.worldBounds(index)))
+                visibleModels.push_back(index);
+        });
+        // keep the order of the dense arrays
+        std::sort(visibleModels.begin(), visibleModels.end());
+    }
+    else {
+        for (int i = 0; i < static_cast<int>(scene.size()); i++)
+            visibleModels.push_back(i);
+    }
+    objectsDrawn = visibleModels.size();
+}
+
+void RenderModels(Shader& ourShader, SceneStore& scene) {
+    CullModels(scene);
+
+    PROFILE_SCOPE("Object submission");
+    PROFILE_GPU_SCOPE("Objects");
+    objectDrawCalls = 0;
+    objectTriangles = 0;
+    for (int index : visibleModels) {
+        const Model& model = *scene.assets[index];
+        for (const Mesh& mesh : model.meshes)
+            objectTriangles += mesh.indexCount / 3;
+        objectDrawCalls += model.meshes.size();
         if (!model.textures_loaded.empty()) {
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, model.textures_loaded[0].id);
             ourShader.setInt("texture_diffuse", 0);
 
         }
-        glm::mat4 modelMatrix = model.GetTransformMatrix();
-        ourShader.setMat4("model", modelMatrix);
+        ourShader.setMat4("model", scene.transforms.world(index));
         model.Draw(ourShader);
     }
 }
 
-void HandleInput(GLFWwindow* window, std::vector<Model>& models, Shader& outShader,int& selectedId) {
+// object under the cursor, a handle that doesn't resolve if the ray hits nothing
+SceneHandle PickObject(GLFWwindow* window, const SceneStore& scene) {
+    double mouseX, mouseY;
+    int width, height;
+    glfwGetCursorPos(window, &mouseX, &mouseY);
+    glfwGetWindowSize(window, &width, &height);
+    if (width <= 0 || height <= 0)
+        return SceneHandle();
+    Ray ray = ScreenPointToRay(mouseX, mouseY, width, height, camera.cameraMatrix);
+
+    // candidates come front to back from the BVH, an exact hit prunes everything behind it
+    int picked = -1;
+    float closest = FLT_MAX;
+    scene.queryRay(ray.origin, ray.direction, FLT_MAX, [&](int index, float) {
+        float t;
+        if (scene.assets[index]->intersectRay(ray, scene.transforms.world(index), closest, t)) {
+            closest = t;
+            picked = index;
+        }
+        return closest;
+    });
+    return picked >= 0 ? scene.handleAt(picked) : SceneHandle();
+}
+
+bool rightButtonWasPressed = false;
+
+void HandleInput(GLFWwindow* window, SceneStore& scene, SceneHandle& selected) {
+    // right click selects the object under the cursor, clicking the empty room clears the selection
+    bool rightButtonPressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+    if (rightButtonPressed && !rightButtonWasPressed && !ImGui::GetIO().WantCaptureMouse) {
+        selected = PickObject(window, scene);
+    }
+    rightButtonWasPressed = rightButtonPressed;
+
     // after clicking the R button show the list of objects to generate
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
     {
@@ -440,87 +666,550 @@ void HandleInput(GLFWwindow* window, std::vector<Model>& models, Shader& outShad
 
     if (ImGui::BeginPopup("Generate"))
     {
-        if (ImGui::Button("Chair1")) {
-            GenerateObject("chair1.fbx", "texture_diffuse1.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.8), "Chair1");
+        for (const FurnitureItem& item : furnitureCatalog) {
+            if (ImGui::Button(item.label)) {
+                GenerateFurniture(item, posXYZ, glm::radians(rot));
+            }
         }
-
-        if (ImGui::Button("Dresser")) {
-            GenerateObject("dresser.fbx", "texture_diffuse3.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.5), "Dresser");
+        ImGui::EndPopup();
+    }
+    // Handle 'Q' key for Save
+    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+        std::string filepath = SaveFileDialog();
+        if (!filepath.empty()) {
+            saveGameState(filepath, scene, selectedRoomModel);
+            std::cout << filepath << std::endl;
+            std::cout << "Scene has been successfully saved to " << filepath << std::endl;
         }
+    }
+}
+// culling switches for the objects and the room meshlets, and how much they removed this frame
+void RenderCullingWindow() {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Culling");
+    ImGui::Checkbox("Frustum culling", &meshletCulling.frustumCulling);
+    ImGui::Checkbox("Back-face cone culling", &meshletCulling.coneCulling);
+    ImGui::Separator();
+    ImGui::Checkbox("Object culling (BVH)", &objectCulling);
+    ImGui::Separator();
+    ImGui::Text("Objects: %zu / %zu", objectsDrawn, scene.size());
+    ImGui::Text("Draw calls: %zu objects + %zu room, triangles: %zu objects", objectDrawCalls, meshletStats.drawCalls, objectTriangles);
+    ImGui::Text("BVH height: %d", scene.bvhHeight());
+    size_t nearObjects = 0;
+    scene.queryRadius(camera.Position, nearRadius, [&](int index) {
+        if (scene.worldBounds(index).distanceSquared(camera.Position) <= nearRadius * nearRadius)
+            nearObjects++;
+    });
+    ImGui::SliderFloat("Near radius", &nearRadius, 0.5f, 20.0f);
+    ImGui::Text("Objects near the camera: %zu", nearObjects);
+    ImGui::Separator();
+    ImGui::Text("Room meshlets: %zu / %zu", meshletStats.meshletsDrawn, meshletStats.meshlets);
+    ImGui::Text("Room triangles: %zu / %zu", meshletStats.trianglesDrawn, meshletStats.triangles);
+    if (meshletStats.triangles > 0) {
+        ImGui::Text("Reduction: %.1f%% in %zu draw ranges", 100.0 * (1.0 - double(meshletStats.trianglesDrawn) / meshletStats.triangles), meshletStats.drawRanges);
+    }
+    ImGui::End();
+}
 
-        if (ImGui::Button("Table")) {
-            GenerateObject("table1.fbx", "texture_diffuse4.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.5), "Table");
-        }
+// frame rate, frame time percentiles and CPU usage of the process, and the render mode switch
+void RenderFrameWindow() {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Frames");
+    ImGui::Checkbox("Continuous rendering", &frameScheduler.continuous);
+    ImGui::Text("%.1f FPS, CPU %.1f%% of a core", frameScheduler.fps(), frameScheduler.cpu() * 100.0);
+
+    const FrameTimeStats& frames = frameScheduler.frameTimes;
+    const FrameTimeStats& work = frameScheduler.workTimes;
+    ImGui::Text("Target %.2f ms, last %zu frames drawn back to back:", frameScheduler.pacer.period * 1e3, frames.count());
+    ImGui::Text("interval p50 %.2f ms  p99 %.2f ms  max %.2f ms", frames.percentile(0.5) * 1e3, frames.percentile(0.99) * 1e3, frames.max() * 1e3);
+    ImGui::Text("work     p50 %.2f ms  p99 %.2f ms  max %.2f ms", work.percentile(0.5) * 1e3, work.percentile(0.99) * 1e3, work.max() * 1e3);
+    if (frames.count() > 0) {
+        ImGui::PlotLines("##intervals", frames.values().data(), static_cast<int>(frames.count()), static_cast<int>(frames.offset()),
+            "interval", 0.0f, static_cast<float>(frameScheduler.pacer.period * 2.0), ImVec2(0, 60));
+    }
+    if (ImGui::Button("Reset")) {
+        frameScheduler.frameTimes.clear();
+        frameScheduler.workTimes.clear();
+    }
+    ImGui::End();
+}
 
-        if (ImGui::Button("Dresser2")) {
-            GenerateObject("dresser2.fbx", "texture_diffuse5.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.7), "Dresser2");
-        }
-        if (ImGui::Button("Desk")) {
-            GenerateObject("desk.fbx", "texture_diffuse6.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.4), "Desk");
-        }
-        if (ImGui::Button("Table2")) {
-            GenerateObject("table2.fbx", "texture_diffuse1.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.1), "Table2");
-        }
-        if (ImGui::Button("Couch1")) {
-            GenerateObject("couch1.fbx", "texture_diffuse7.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 45.0f), glm::vec3(0.3), "couch1");
+// trace written with F9 or the Profiler window, --trace names the one written at exit
+std::string traceExitPath;
+std::string traceStatus;
+bool traceKeyWasPressed = false;
+
+// writes the events still held by the trace rings to a Chrome Trace Event file
+void SaveTrace(const std::string& path) {
+    long events = TraceRecorder::Get().write(path);
+    traceStatus = events < 0 ? "Failed to write " + path : std::to_string(events) + " events written to " + path;
+    std::cout << traceStatus << std::endl;
+}
+
+// file name without directories and extension
+std::string FileStem(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    return name.substr(0, name.find_last_of('.'));
+}
+
+// format is a strftime pattern
+std::string TimestampedFileName(const char* format) {
+    std::time_t now = std::time(nullptr);
+    char name[64];
+    std::strftime(name, sizeof(name), format, std::localtime(&now));
+    return name;
+}
+
+// trace-YYYYMMDD-HHMMSS.json in the working directory
+std::string TraceFileName() {
+    return TimestampedFileName("trace-%Y%m%d-%H%M%S.json");
+}
+
+// timings of the last frame as a tree of scopes, the GPU passes and the recent frame times
+void RenderProfilerWindow() {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Profiler");
+#if PROFILER_ENABLED
+    Profiler& profiler = Profiler::Get();
+    double frameTime = profiler.lastFrameTime();
+    ImGui::Text("CPU %.2f ms", frameTime);
+    const FrameTimeStats& cpuFrames = profiler.cpuFrames;
+    if (cpuFrames.count() > 0) {
+        ImGui::PlotLines("##cpu", cpuFrames.values().data(), static_cast<int>(cpuFrames.count()), static_cast<int>(cpuFrames.offset()),
+            "CPU", 0.0f, static_cast<float>(cpuFrames.percentile(0.99) * 1.5), ImVec2(0, 60));
+    }
+    if (ImGui::BeginTable("cpu scopes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableSetupColumn("%");
+        ImGui::TableHeadersRow();
+        for (const Profiler::Scope& scope : profiler.lastFrame()) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%*s%s", scope.depth * 2, "", scope.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.duration);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", frameTime > 0.0 ? scope.duration / frameTime * 100.0 : 0.0);
         }
-        if (ImGui::Button("Couch2")) {
-            GenerateObject("couch2.fbx", "texture_diffuse7.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 45.0f), glm::vec3(0.3), "couch2");
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    const FrameTimeStats& gpuFrames = profiler.gpuFrames;
+    ImGui::Text("GPU (results %zu dropped)", profiler.droppedGpuFrames());
+    if (gpuFrames.count() > 0) {
+        ImGui::PlotLines("##gpu", gpuFrames.values().data(), static_cast<int>(gpuFrames.count()), static_cast<int>(gpuFrames.offset()),
+            "GPU", 0.0f, static_cast<float>(gpuFrames.percentile(0.99) * 1.5), ImVec2(0, 60));
+    }
+    for (const Profiler::GpuScope& scope : profiler.lastGpuFrame()) {
+        ImGui::Text("%-12s %.3f ms", scope.name, scope.duration);
+    }
+
+    ImGui::Separator();
+    // the last events of every thread, for chrome://tracing or ui.perfetto.dev
+    if (ImGui::Button("Save trace (F9)")) {
+        SaveTrace(TraceFileName());
+    }
+    if (!traceStatus.empty()) {
+        ImGui::TextWrapped("%s", traceStatus.c_str());
+    }
+#else
+    ImGui::Text("The profiler is compiled out (PROFILER_ENABLED 0)");
+#endif
+    ImGui::End();
+}
+
+// replaces the objects of the scene with a generated one, the room stays
+StressScene::Options stressOptions;
+std::string stressStatus;
+
+void GenerateStressScene(SceneStore& scene, SceneHandle& selected) {
+    double start = FramePacer::Now();
+    std::vector<ModelSnapshot> objects = StressScene::Generate(stressOptions, StressAssets());
+    scene.clear();
+    selected = SceneHandle();
+    for (const ModelSnapshot& object : objects) {
+        std::shared_ptr<Model> asset = AcquireAsset(object.modelFilePath, object.textures, object.objectName);
+        scene.add(asset, object.objectName, object.position, object.rotation, object.scale);
+    }
+    char status[128];
+    snprintf(status, sizeof(status), "%zu objects, %zu assets in %.2f s", scene.size(), AssetLibrary::Get().live().size(), FramePacer::Now() - start);
+    stressStatus = status;
+}
+
+void RenderStressSceneWindow(SceneStore& scene, SceneHandle& selected) {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Stress scene");
+    ImGui::SliderInt("Objects", &stressOptions.objects, 1, 20000);
+    ImGui::SliderFloat("Unique assets", &stressOptions.uniqueRatio, 0.0f, 1.0f);
+    int layout = static_cast<int>(stressOptions.layout);
+    if (ImGui::Combo("Layout", &layout, "Grid\0Uniform\0Clustered\0"))
+        stressOptions.layout = static_cast<StressScene::Layout>(layout);
+    ImGui::SliderFloat("Extent", &stressOptions.extent, 1.0f, 50.0f);
+    ImGui::SliderFloat("Rotation jitter", &stressOptions.rotationJitter, 0.0f, 180.0f);
+    ImGui::SliderFloat("Scale jitter", &stressOptions.scaleJitter, 0.0f, 0.9f);
+    int seed = static_cast<int>(stressOptions.seed);
+    if (ImGui::InputInt("Seed", &seed))
+        stressOptions.seed = static_cast<uint32_t>(seed);
+    ImGui::Text("%d distinct assets", StressScene::UniqueAssets(stressOptions, StressAssets()));
+    if (ImGui::Button("Generate (replaces the objects)"))
+        GenerateStressScene(scene, selected);
+    if (!stressStatus.empty())
+        ImGui::Text("%s, Q saves it", stressStatus.c_str());
+    ImGui::End();
+}
+
+// every asset load of the session with the time of its stages, slowest first, and the CSV export
+std::string assetCsvStatus;
+
+void RenderAssetsWindow() {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Assets");
+    std::vector<AssetLoadRecord> loads = LoadTelemetry::Get().records();
+    double totalMs = 0.0;
+    for (const AssetLoadRecord& load : loads)
+        totalMs += load.totalMs;
+    ImGui::Text("%zu loads, %.1f ms", loads.size(), totalMs);
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV")) {
+        std::string path = TimestampedFileName("assets-%Y%m%d-%H%M%S.csv");
+        long rows = LoadTelemetry::Get().writeCsv(path);
+        assetCsvStatus = rows < 0 ? "Failed to write " + path : std::to_string(rows) + " loads written to " + path;
+    }
+    if (!assetCsvStatus.empty()) {
+        ImGui::TextWrapped("%s", assetCsvStatus.c_str());
+    }
+
+    TextureStreamer& streamer = TextureStreamer::Get();
+    TextureStreamer::Stats streaming = streamer.stats();
+    ImGui::Text("Texture streaming: %s, ring %.1f / %.1f MB", streaming.mode, streaming.ringUsed / (1024.0 * 1024.0), streaming.ringBytes / (1024.0 * 1024.0));
+    if (streamer.enabled()) {
+        float budget = static_cast<float>(streamer.uploadBudgetMB);
+        if (ImGui::SliderFloat("Upload budget (MB / frame)", &budget, 1.0f, 256.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
+            streamer.uploadBudgetMB = budget;
+        ImGui::Text("%zu decoding, %zu waiting for the ring, %zu uploading, %zu fenced", streaming.decoding, streaming.waiting, streaming.uploading, streaming.fenced);
+        ImGui::Text("%zu textures, %.1f MB uploaded, %.2f MB last frame", streaming.textures, streaming.uploadedBytes / (1024.0 * 1024.0), streaming.lastFrameBytes / (1024.0 * 1024.0));
+    }
+
+    std::sort(loads.begin(), loads.end(), [](const AssetLoadRecord& a, const AssetLoadRecord& b) { return a.totalMs > b.totalMs; });
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("loads", 11, flags, ImVec2(0.0f, 300.0f))) {
+        const char* columns[] = { "Asset", "Source", "Total ms", "Read", "Parse", "Postprocess", "Convert", "Decode", "Upload + mips", "KB read", "Triangles" };
+        ImGui::TableSetupScrollFreeze(0, 1);
+        for (const char* column : columns)
+            ImGui::TableSetupColumn(column);
+        ImGui::TableHeadersRow();
+        for (const AssetLoadRecord& load : loads) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(FileStem(load.path).c_str());
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s\nflip UVs %.2f, triangulate %.2f, smooth normals %.2f, tangents %.2f ms\n"
+                    "texture reads %.2f, mips %.2f, mesh upload %.2f, cache bake %.2f ms\n%zu meshes, %zu vertices, %zu textures (%.1f MB) %s",
+                    load.path.c_str(), load.flipUVsMs, load.triangulateMs, load.smoothNormalsMs, load.tangentsMs,
+                    load.textureReadMs, load.mipMs, load.meshUploadMs, load.bakeMs,
+                    load.meshes, load.vertices, load.textures, load.textureBytes / (1024.0 * 1024.0), load.textureSizes.c_str());
+            }
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(load.source.c_str());
+            double postprocessMs = load.flipUVsMs + load.triangulateMs + load.smoothNormalsMs + load.tangentsMs;
+            const double stages[] = { load.totalMs, load.readMs + load.textureReadMs, load.parseMs, postprocessMs,
+                load.convertMs, load.decodeMs, load.textureUploadMs + load.mipMs + load.meshUploadMs };
+            for (double ms : stages) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", ms);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.0f", load.bytesRead / 1024.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", load.triangles);
         }
-        if (ImGui::Button("Chair2")) {
-            GenerateObject("chair2.fbx", "texture_diffuse8.jpg", ourShader, models.size(), posXYZ, glm::vec3(0.0f, glm::radians(rot), 0.0f), glm::vec3(0.4), "Chair2");
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+// the audit of resources/objects, run off the GL thread so the window stays responsive
+AssetAudit::Budgets auditBudgets;
+std::future<std::vector<AssetAudit::Report>> auditRun;
+std::vector<AssetAudit::Report> auditReports;
+
+void RenderAuditWindow() {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Audit");
+    int maxTriangles = static_cast<int>(auditBudgets.maxTriangles);
+    ImGui::SetNextItemWidth(120.0f);
+    if (ImGui::InputInt("Max triangles", &maxTriangles, 1000, 10000))
+        auditBudgets.maxTriangles = static_cast<size_t>(std::max(maxTriangles, 0));
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::InputInt("Max texture size", &auditBudgets.maxTextureSize, 256, 1024);
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::InputDouble("Max GPU MB", &auditBudgets.maxGpuMB, 1.0, 16.0, "%.1f");
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::InputDouble("Max ACMR", &auditBudgets.maxAcmr, 0.1, 0.5, "%.2f");
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::InputDouble("Max vertices per position", &auditBudgets.maxDuplication, 0.1, 1.0, "%.2f");
+    ImGui::Checkbox("Allow non-power-of-two", &auditBudgets.allowNonPowerOfTwo);
+    ImGui::SameLine();
+    ImGui::Checkbox("Allow unused channels", &auditBudgets.allowUnusedChannels);
+
+    bool running = auditRun.valid();
+    if (running && auditRun.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        auditReports = auditRun.get();
+        running = false;
+    }
+    if (running) {
+        ImGui::Text("Auditing...");
+    }
+    else if (ImGui::Button("Audit resources/objects")) {
+        AssetAudit::Budgets budgets = auditBudgets;
+        auditRun = std::async(std::launch::async, [budgets]() {
+            return AssetAudit::Run(AssetAudit::ListAssets("resources/objects"), budgets);
+        });
+    }
+
+    size_t failed = 0;
+    for (const AssetAudit::Report& report : auditReports)
+        failed += report.failed();
+    if (!auditReports.empty()) {
+        ImGui::SameLine();
+        ImGui::Text("%zu assets, %zu over budget", auditReports.size(), failed);
+    }
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+    if (!auditReports.empty() && ImGui::BeginTable("audit", 7, flags, ImVec2(0.0f, 300.0f))) {
+        const char* columns[] = { "Asset", "Status", "Triangles", "Verts/pos", "ACMR", "GPU MB", "Textures" };
+        ImGui::TableSetupScrollFreeze(0, 1);
+        for (const char* column : columns)
+            ImGui::TableSetupColumn(column);
+        ImGui::TableHeadersRow();
+        for (const AssetAudit::Report& report : auditReports) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(FileStem(report.path).c_str());
+            if (ImGui::IsItemHovered() && (report.failed() || !report.warnings.empty())) {
+                std::string details = report.path;
+                if (!report.error.empty())
+                    details += "\nerror: " + report.error;
+                for (const std::string& failure : report.failures)
+                    details += "\nover budget: " + failure;
+                for (const std::string& warning : report.warnings)
+                    details += "\n" + warning;
+                ImGui::SetTooltip("%s", details.c_str());
+            }
+            ImGui::TableNextColumn();
+            if (report.failed())
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "fail");
+            else if (!report.warnings.empty())
+                ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "warn");
+            else
+                ImGui::TextUnformatted("ok");
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", report.triangles);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", report.duplication);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", report.acmr);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", report.gpuBytes() / (1024.0 * 1024.0));
+            ImGui::TableNextColumn();
+            for (const AssetAudit::TextureInfo& texture : report.textures) {
+                ImGui::Text("%dx%d %s", texture.width, texture.height, texture.format.c_str());
+                ImGui::SameLine();
+            }
+            ImGui::NewLine();
         }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
 
+// searchable list of every object, grouped by asset
+Outliner outliner;
 
-        ImGui::EndPopup();
+void RenderOutlinerWindow(const SceneStore& scene, SceneHandle& selected) {
+    ImGui::SetNextWindowSize(ImVec2(300, 400), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Outliner");
+    outliner.draw(scene, selected);
+    ImGui::End();
+}
+
+// budgets of the Memory window in MB, 0 for none
+int cpuBudgetMB = 0;
+int gpuBudgetMB = 0;
+size_t residentPeakBytes = 0;
+
+// used / budget, red once the high-water mark went over the budget
+void MemoryBudgetLine(const char* label, size_t bytes, size_t peakBytes, int budgetMB) {
+    const double MB = 1024.0 * 1024.0;
+    bool over = budgetMB > 0 && peakBytes > static_cast<size_t>(budgetMB) * 1024 * 1024;
+    if (over)
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+    if (budgetMB > 0)
+        ImGui::Text("%-9s %8.2f MB  peak %8.2f MB  budget %d MB (%.0f%%)", label, bytes / MB, peakBytes / MB, budgetMB, 100.0 * peakBytes / (budgetMB * MB));
+    else
+        ImGui::Text("%-9s %8.2f MB  peak %8.2f MB", label, bytes / MB, peakBytes / MB);
+    if (over)
+        ImGui::PopStyleColor();
+}
+
+// memory by subsystem with high-water marks, then the loaded geometry grouped by residency
+// policy, with a policy switch per asset
+void RenderMemoryWindow() {
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Memory");
+
+    const int policyCount = 3;
+    const Residency policies[policyCount] = { Residency::GpuOnly, Residency::CpuRetained, Residency::OnDemand };
+    size_t assets[policyCount] = {};
+    size_t cpuBytes[policyCount] = {};
+    size_t gpuBytes[policyCount] = {};
+    auto account = [&](const Model& model) {
+        int policy = static_cast<int>(model.residency);
+        assets[policy]++;
+        cpuBytes[policy] += model.cpuBytes();
+        gpuBytes[policy] += model.gpuBytes();
+    };
+    // objects placed from the same file share one asset, it is counted once
+    std::vector<std::pair<std::string, std::shared_ptr<Model>>> liveAssets = AssetLibrary::Get().live();
+    account(room);
+    for (const auto& asset : liveAssets)
+        account(*asset.second);
+
+    const double MB = 1024.0 * 1024.0;
+    GpuResourceRegistry& registry = GpuResourceRegistry::Get();
+    MemoryTracker& tracker = MemoryTracker::Get();
+    size_t residentBytes = CurrentResidentBytes();
+    residentPeakBytes = std::max(residentPeakBytes, residentBytes);
+    MemoryBudgetLine("Resident", residentBytes, residentPeakBytes, 0);
+#if MEMORY_TRACKING_ENABLED
+    MemoryBudgetLine("Heap", tracker.totalBytes(), tracker.totalPeakBytes(), cpuBudgetMB);
+#endif
+    MemoryBudgetLine("GPU", registry.liveBytes(), registry.peakBytes(), gpuBudgetMB);
+    ImGui::SetNextItemWidth(100.0f);
+    ImGui::InputInt("Heap budget (MB)", &cpuBudgetMB, 64, 256);
+    ImGui::SetNextItemWidth(100.0f);
+    ImGui::InputInt("GPU budget (MB)", &gpuBudgetMB, 64, 256);
+    cpuBudgetMB = std::max(cpuBudgetMB, 0);
+    gpuBudgetMB = std::max(gpuBudgetMB, 0);
+    if (ImGui::Button("Reset peaks")) {
+        tracker.resetPeaks();
+        registry.resetPeak();
+        residentPeakBytes = residentBytes;
     }
-    // Handle 'Q' key for Save
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-        std::string filepath = SaveFileDialog();
-        if (!filepath.empty()) {
-            saveGameState(filepath, models,selectedRoomModel);
-            std::cout << filepath << std::endl;
-            std::cout << "Scene has been successfully saved to " << filepath << std::endl;
+#if MEMORY_TRACKING_ENABLED
+    // blocks are charged to the subsystem that allocated them, whichever thread frees them
+    if (ImGui::BeginTable("heap", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Heap");
+        ImGui::TableSetupColumn("MB");
+        ImGui::TableSetupColumn("Peak MB");
+        ImGui::TableSetupColumn("Blocks");
+        ImGui::TableSetupColumn("Allocations");
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < MemoryTracker::TagCount; i++) {
+            MemoryTracker::TagStats stats = tracker.stats(static_cast<MemoryTag>(i));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(MemoryTagName(static_cast<MemoryTag>(i)));
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.bytes / MB);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.peakBytes / MB);
+            ImGui::TableNextColumn(); ImGui::Text("%zu", stats.blocks);
+            ImGui::TableNextColumn(); ImGui::Text("%zu", stats.allocations);
+        }
+        ImGui::EndTable();
+    }
+#else
+    ImGui::Text("Heap tracking is compiled out (MEMORY_TRACKING_ENABLED 0)");
+#endif
+    ImGui::Separator();
+    for (int i = 0; i < policyCount; i++) {
+        ImGui::Text("%-12s %5zu assets  CPU %8.2f MB  GPU %8.2f MB", ResidencyName(policies[i]), assets[i], cpuBytes[i] / MB, gpuBytes[i] / MB);
+    }
+    ImGui::Separator();
+
+    if (ImGui::TreeNode("gpu", "GPU objects: %zu (%.2f MB)", registry.liveObjects(), registry.liveBytes() / MB)) {
+        for (const auto& owner : registry.byOwner()) {
+            ImGui::Text("%5zu  %8.2f MB  %s", owner.second.objects, owner.second.bytes / MB, owner.first.c_str());
         }
+        ImGui::TreePop();
     }
+    ImGui::Separator();
+
+    for (int i = 0; i < static_cast<int>(liveAssets.size()); i++) {
+        Model& asset = *liveAssets[i].second;
+        int policy = static_cast<int>(asset.residency);
+        ImGui::PushID(i);
+        ImGui::SetNextItemWidth(120.0f);
+        if (ImGui::Combo("##residency", &policy, "GPU only\0CPU retained\0On demand\0")) {
+            asset.setResidency(static_cast<Residency>(policy));
+        }
+        ImGui::SameLine();
+        // one reference is held by liveAssets itself, textures may be shared with other assets
+        ImGui::Text("%s  x%ld  CPU %.2f MB  GPU %.2f MB + textures %.2f MB", asset.objectName.c_str(), liveAssets[i].second.use_count() - 1,
+            asset.cpuBytes() / MB, asset.gpuBytes() / MB, asset.textureBytes() / MB);
+        ImGui::PopID();
+    }
+    ImGui::End();
 }
-void RenderModelWindow(GLFWwindow* window, Shader& ourShader, std::vector<Model>& models, int& selectedId) {
+
+// the room as seen by the camera, its meshlets culled against the frustum
+void DrawRoom(Shader& ourShader) {
     ourShader.use();
     ourShader.setMat4("camMatrix", camera.cameraMatrix);
 
     ourShader.setMat4("model", room.GetTransformMatrix());
-    room.Draw(ourShader);
+    if (!room.textures_loaded.empty()) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, room.textures_loaded[0].id);
+    }
+    meshletStats = MeshletStats();
+    PROFILE_SCOPE("Room");
+    PROFILE_GPU_SCOPE("Room");
+    room.DrawCulled(ourShader, camera.cameraMatrix, camera.Position, meshletCulling, meshletStats);
+}
+
+void RenderModelWindow(GLFWwindow* window, Shader& ourShader, SceneStore& scene, SceneHandle& selected) {
+    DrawRoom(ourShader);
 
     ImGuiHandlingInput = ImGui::GetIO().WantCaptureMouse;
     ImGui::Begin("Viewport", &showModelWindow);
 
-    for (auto& name : modelNames) {
-        if (name.empty()) {
-            std::cerr << "ERROR: empty model name!" << std::endl;
-            name = "none";
-        }
-    }
     UpdateCamera(window, camera, ImGuiHandlingInput);
-    RenderGUI(selectedId, models, modelNames);
-    HandleInput(window, models, ourShader, selectedId);
-    RenderModels(ourShader, models);
+    RenderGUI(selected, scene);
+    {
+        PROFILE_SCOPE("Input");
+        HandleInput(window, scene, selected);
+    }
+    RenderModels(ourShader, scene);
 
     ImGui::End();
+
+    PROFILE_SCOPE("Tool windows");
+    RenderOutlinerWindow(scene, selected);
+    RenderMemoryWindow();
+    RenderCullingWindow();
+    RenderFrameWindow();
+    RenderProfilerWindow();
+    RenderStressSceneWindow(scene, selected);
+    RenderAssetsWindow();
+    RenderAuditWindow();
 }
-void saveGameState(const std::string& filepath, const std::vector<Model>& models, const std::string& selectedRoomModel) {
+void saveGameState(const std::string& filepath, const SceneStore& scene, const std::string& selectedRoomModel) {
     std::ofstream outFile(filepath, std::ios::binary);
     if (!outFile) {
         throw std::runtime_error("Failed to open file for saving");
     }
 
-    // Serialize the selected room model
-    size_t roomModelLength = selectedRoomModel.length();
-    outFile.write(reinterpret_cast<const char*>(&roomModelLength), sizeof(roomModelLength));
-    outFile.write(selectedRoomModel.c_str(), roomModelLength);
+    WriteSceneHeader(outFile, selectedRoomModel);
 
-    for (const auto& model : models) {
-        std::cout << model.objectName << std::endl;
-        ModelSnapshot snapshot(model);
+    for (size_t i = 0; i < scene.size(); i++) {
+        std::cout << scene.names[i] << std::endl;
+        // the asset is shared, the placement comes from the scene
+        ModelSnapshot snapshot(*scene.assets[i]);
+        snapshot.position = scene.transforms.position(i);
+        snapshot.rotation = scene.transforms.rotation(i);
+        snapshot.scale = scene.transforms.scale(i);
+        snapshot.textureName = scene.textureNames[i];
         snapshot.serialize(outFile);
     }
 
@@ -537,66 +1226,882 @@ void saveGameState(const std::string& filepath, const std::vector<Model>& models
 }
 
 
-void loadGameState(const std::string& filepath, std::vector<Model>& models, Shader& shader, std::string& selectedRoomModel) {
+// false if the file can't be opened, the scene is left as it was then
+bool loadGameState(const std::string& filepath, SceneStore& scene, Shader& shader, std::string& selectedRoomModel) {
+    PROFILE_SCOPE("Load scene");
     std::cout << "Attempting to load from file: " << filepath << std::endl;
     std::ifstream inFile(filepath, std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Failed to open scene file: " << filepath << std::endl;
+        return false;
+    }
 
     // Deserialize the selected room model
-    size_t roomModelLength;
+    size_t roomModelLength = 0;
     inFile.read(reinterpret_cast<char*>(&roomModelLength), sizeof(roomModelLength));
+    if (!inFile || roomModelLength > 4096) {
+        std::cerr << "Not a scene file: " << filepath << std::endl;
+        return false;
+    }
     char* roomModelBuffer = new char[roomModelLength + 1];
     inFile.read(roomModelBuffer, roomModelLength);
     roomModelBuffer[roomModelLength] = '\0';
     selectedRoomModel = std::string(roomModelBuffer);
     delete[] roomModelBuffer;
 
-    models.clear(); // Clear existing models
+    scene.clear(); // Clear existing models
+    selected = SceneHandle();
 
+    // every object carries the shader, the first one that names its files is applied once
+    ShaderSnapshot shaderSnapshot;
     while (inFile.peek() != EOF) {
         ModelSnapshot snapshot;
         snapshot.deserialize(inFile);
 
-        Model model("resources/objects/"+snapshot.objectName, snapshot.position, snapshot.rotation, snapshot.scale);
-        model.setPosition(snapshot.position);
-        model.setRotation(snapshot.rotation);
-        model.setScale(snapshot.scale);
-        model.objectName = snapshot.objectName;
-        model.textureName = snapshot.textureName;
+        std::string key = AssetKey(snapshot.modelFilePath, snapshot.textures);
+        std::shared_ptr<Model> asset = AssetLibrary::Get().find(key);
+        if (!asset && !snapshot.meshes.empty()) {
+            // files written by older versions embed the geometry of every object
+            Model model;
+            model.filePath = snapshot.modelFilePath;
+            for (auto& meshSnapshot : snapshot.meshes) {
+                Mesh mesh;
+                meshSnapshot.applyToMesh(mesh);
+                model.meshes.push_back(std::move(mesh));
+            }
+            model.releaseCpuGeometry();
+            model.objectName = snapshot.objectName;
+            AttachTextures(model, snapshot.textures);
+            model.buildPickBVH();
+            asset = AssetLibrary::Get().insert(key, std::move(model));
+        }
+        if (!asset) {
+            // the file only references the asset, load it like GenerateObject does
+            asset = AcquireAsset(snapshot.modelFilePath, snapshot.textures, snapshot.objectName);
+        }
+
+        // every object needs an entry in the dropdown menu, the scene makes the names unique
+        scene.add(asset, snapshot.objectName.empty() ? "Object" : snapshot.objectName, snapshot.position, snapshot.rotation, snapshot.scale, snapshot.textureName);
+
+        if (shaderSnapshot.vertexShaderPath.empty() || shaderSnapshot.fragmentShaderPath.empty())
+            shaderSnapshot = snapshot.shader;
+    }
+    // generated scenes leave the paths empty, the app shader stays as it is then
+    if (!shaderSnapshot.vertexShaderPath.empty() && !shaderSnapshot.fragmentShaderPath.empty())
+        shaderSnapshot.applyToShader(shader);
+    initializeScene(shader, "texture_diffuse2.jpg", selectedRoomModel);
+    return true;
+}
 
-        if (!model.objectName.empty()) {
-            modelNames.push_back(model.objectName);
+// headless renders: saved scenes drawn into an offscreen framebuffer and written as PNGs
+struct RenderStats {
+    size_t scenes = 0;
+    size_t failed = 0;
+    size_t images = 0;
+    double loadSeconds = 0.0;
+    double renderSeconds = 0.0;  // drawing and reading the pixels back
+    double writeSeconds = 0.0;
+};
+
+struct RenderOptions {
+    std::string outputDirectory = "renders";
+    int width = 1280;
+    int height = 720;
+    GLBackend backend = GLBackend::Native;
+};
+
+// renders one saved scene from every pose into <outputPrefix>_<pose>.png
+bool RenderSceneFile(const RenderJob& job, const std::string& outputPrefix, OffscreenTarget& target, Shader& shader, RenderStats& stats) {
+    PROFILE_SCOPE("Render scene file");
+    double start = FramePacer::Now();
+    if (!loadGameState(job.scenePath, scene, shader, selectedRoomModel))
+        return false;
+    stats.loadSeconds += FramePacer::Now() - start;
+
+    camera.width = target.width;
+    camera.height = target.height;
+    std::vector<uint8_t> pixels;
+    for (size_t i = 0; i < job.poses.size(); i++) {
+        double renderStart = FramePacer::Now();
+        job.poses[i].apply(camera);
+        camera.updateMatrix(camera.zoom, 0.1f, 100.0f);
+        target.bind();
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        DrawRoom(shader);
+        RenderModels(shader, scene);
+        target.read(pixels);
+        double renderEnd = FramePacer::Now();
+        stats.renderSeconds += renderEnd - renderStart;
+
+        std::string imagePath = outputPrefix + "_" + std::to_string(i) + ".png";
+        if (!PngWriter::Write(imagePath, target.width, target.height, pixels, true)) {
+            std::cerr << "Failed to write " << imagePath << std::endl;
+            return false;
         }
+        stats.writeSeconds += FramePacer::Now() - renderEnd;
+        stats.images++;
+    }
+    return true;
+}
 
-        // Load model meshes
-        for (auto& meshSnapshot : snapshot.meshes) {
-            Mesh mesh;
-            meshSnapshot.applyToMesh(mesh);
-            model.meshes.push_back(mesh);
+// the requested backend first, then the ones that can run on the software rasterizer
+GLFWwindow* CreateRenderContext(GLBackend requested) {
+    std::vector<GLBackend> order(1, requested);
+    for (GLBackend fallback : { GLBackend::Egl, GLBackend::OSMesa }) {
+        if (fallback != requested)
+            order.push_back(fallback);
+    }
+    for (GLBackend backend : order) {
+        GLFWwindow* context = CreateOffscreenContext(backend);
+        if (context) {
+            std::cout << "GL " << glGetString(GL_VERSION) << " on " << glGetString(GL_RENDERER) << " (" << GLBackendName(backend) << ")" << std::endl;
+            return context;
         }
+        std::cerr << "No " << GLBackendName(backend) << " GL context" << std::endl;
+    }
+    return nullptr;
+}
 
-        // Load model textures
-        for (const auto& textureSnapshot : snapshot.textures) {
-            Texture texture;
-            texture.id = TextureFromFile(textureSnapshot.path.c_str(), "resources/objects/");
-            texture.type = textureSnapshot.type;
-            texture.path = textureSnapshot.path;
-            model.textures_loaded.push_back(texture);
+// renders the jobs in this process, a scene that fails is reported and skipped.
+// With a csvPath every scene gets a row there, worker numbers the rows of a batch worker.
+int RenderJobs(const std::vector<RenderJob>& jobs, const RenderOptions& options, const std::string& csvPath, int worker) {
+    TRACE_THREAD_NAME("Main");
+    GLFWwindow* context = CreateRenderContext(options.backend);
+    if (!context) {
+        std::cerr << "Failed to create a GL context" << std::endl;
+        return 1;
+    }
+    std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    stbi_set_flip_vertically_on_load(true);
+    glEnable(GL_DEPTH_TEST);
+    BatchRender::MakeDirectory(options.outputDirectory);
+    std::ofstream csv;
+    if (!csvPath.empty()) {
+        csv.open(csvPath);
+        csv << BatchRender::CsvHeader << "\n";
+    }
+
+    RenderStats stats;
+    double start = FramePacer::Now();
+    {
+        Shader shader("default.vert", "default.frag");
+        OffscreenTarget target;
+        bool targetReady = target.create(options.width, options.height);
+        if (!targetReady) {
+            std::cerr << "Offscreen framebuffer " << options.width << "x" << options.height << " is not complete" << std::endl;
+            stats.failed = stats.scenes = jobs.size();
+        }
+        // assets stay loaded from one scene to the next, most scenes use the same furniture
+        std::vector<std::shared_ptr<Model>> warmAssets;
+        for (size_t i = 0; i < jobs.size() && targetReady; i++) {
+            RenderStats before = stats;
+            bool rendered = false;
+            try {
+                rendered = RenderSceneFile(jobs[i], options.outputDirectory + "/" + FileStem(jobs[i].scenePath), target, shader, stats);
+            }
+            catch (const std::exception& e) {
+                std::cerr << jobs[i].scenePath << ": " << e.what() << std::endl;
+            }
+            stats.scenes++;
+            if (!rendered) {
+                stats.failed++;
+                std::cerr << "Failed to render " << jobs[i].scenePath << std::endl;
+            }
+            for (const auto& asset : AssetLibrary::Get().live()) {
+                if (std::find(warmAssets.begin(), warmAssets.end(), asset.second) == warmAssets.end())
+                    warmAssets.push_back(asset.second);
+            }
+            if (csv.is_open()) {
+                csv << BatchRender::CsvField(jobs[i].scenePath) << "," << (rendered ? "ok" : "failed") << "," << stats.images - before.images << ","
+                    << (stats.loadSeconds - before.loadSeconds) * 1e3 << "," << (stats.renderSeconds - before.renderSeconds) * 1e3 << ","
+                    << (stats.writeSeconds - before.writeSeconds) * 1e3 << "," << worker << "," << BatchRender::CsvField(renderer) << "\n";
+                csv.flush();
+            }
         }
 
-        // Apply shader snapshot
-        ShaderSnapshot shaderSnapshot = snapshot.shader;
-        shader.vertexShaderPath = shaderSnapshot.vertexShaderPath;
-        shader.fragmentShaderPath = shaderSnapshot.fragmentShaderPath;
-        shader.recompileAndRelink();
+        scene.clear();
+        warmAssets.clear();
+        room = Model();
+        loadedRoomModel.clear();
+        target.reset();
+    }
+    double total = FramePacer::Now() - start;
+    std::cout << stats.images << " images of " << stats.scenes - stats.failed << " scenes (" << stats.failed << " failed) at "
+        << options.width << "x" << options.height << " in " << total << " s" << std::endl;
+    if (stats.images > 0) {
+        std::cout << "load " << stats.loadSeconds << " s, render " << stats.renderSeconds << " s, PNG " << stats.writeSeconds << " s, "
+            << stats.images / stats.renderSeconds << " renders/s (draw + readback), " << stats.images / total << " images/s overall" << std::endl;
+    }
+    GpuResourceRegistry::Get().reportLeaks(std::cout);
+    glfwDestroyWindow(context);
+    glfwTerminate();
+    return stats.failed > 0 ? 1 : 0;
+}
 
-        models.push_back(model);
+// parses the options shared by --render and --batch, other arguments are handed back in inputs
+bool ParseRenderOptions(int argc, char** argv, RenderOptions& options, std::vector<CameraPose>& poses, std::vector<std::string>& inputs,
+    int& jobs, std::string& csvPath, int& worker) {
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            options.outputDirectory = argv[++i];
+        }
+        else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+                std::cerr << "Bad size " << argv[i] << ", expected WxH" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--pose" && hasValue) {
+            CameraPose pose;
+            if (!CameraPose::Parse(argv[++i], pose)) {
+                std::cerr << "Bad pose " << argv[i] << ", expected x,y,z[,yaw[,pitch]]" << std::endl;
+                return false;
+            }
+            poses.push_back(pose);
+        }
+        else if (arg == "--gl" && hasValue) {
+            if (!ParseGLBackend(argv[++i], options.backend)) {
+                std::cerr << "Unknown GL backend " << argv[i] << ", expected native, egl or osmesa" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--jobs" && hasValue) {
+            jobs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--csv" && hasValue) {
+            csvPath = argv[++i];
+        }
+        else if (arg == "--worker" && hasValue) {
+            worker = std::atoi(argv[++i]);
+        }
+        else {
+            inputs.push_back(arg);
+        }
+    }
+    if (poses.empty())
+        poses = CameraPose::Defaults();
+    return true;
+}
 
+// Images are named after the scene file, <stem>_<pose>.png, so two scenes with the same name in
+// different directories would overwrite each other's. False and a message for the first such pair.
+bool CheckImageNames(const std::vector<RenderJob>& jobs) {
+    std::map<std::string, std::string> scenes;
+    for (const RenderJob& job : jobs) {
+        auto inserted = scenes.insert(std::make_pair(FileStem(job.scenePath), job.scenePath));
+        if (!inserted.second && inserted.first->second != job.scenePath) {
+            std::cerr << job.scenePath << " and " << inserted.first->second << " would write the same images, rename one of them" << std::endl;
+            return false;
+        }
     }
-    initializeScene(shader, "texture_diffuse2.jpg", selectedRoomModel);
+    return true;
 }
 
-int main()
+// --render scene.bin [scene.bin ...] [--out dir] [--size WxH] [--pose x,y,z[,yaw[,pitch]]]... [--gl native|egl|osmesa]
+int RunHeadless(int argc, char** argv) {
+    RenderOptions options;
+    std::vector<CameraPose> poses;
+    std::vector<std::string> scenePaths;
+    int jobCount = 1, worker = 0;
+    std::string csvPath;
+    if (!ParseRenderOptions(argc, argv, options, poses, scenePaths, jobCount, csvPath, worker))
+        return 1;
+    if (scenePaths.empty()) {
+        std::cerr << "Usage: --render scene.bin [scene.bin ...] [--out dir] [--size WxH] [--pose x,y,z[,yaw[,pitch]]]... [--gl native|egl|osmesa]" << std::endl;
+        return 1;
+    }
+    std::vector<RenderJob> jobs;
+    for (const std::string& scenePath : scenePaths)
+        jobs.push_back(RenderJob{ scenePath, poses });
+    if (!CheckImageNames(jobs))
+        return 1;
+    return RenderJobs(jobs, options, csvPath, worker);
+}
+
+// --batch <directory|manifest> [--jobs N] [--csv report.csv] and the --render options.
+// With more than one job the scenes are split into shards, each rendered by a copy of this
+// program with its own GL context; the copies share the baked asset cache in cache/.
+int RunBatch(int argc, char** argv) {
+    RenderOptions options;
+    std::vector<CameraPose> poses;
+    std::vector<std::string> inputs;
+    int jobCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+    int worker = 0;
+    std::string csvPath = "batch.csv";
+    if (!ParseRenderOptions(argc, argv, options, poses, inputs, jobCount, csvPath, worker))
+        return 1;
+    if (inputs.size() != 1) {
+        std::cerr << "Usage: --batch <directory|manifest> [--jobs N] [--csv report.csv] [--out dir] [--size WxH] [--pose x,y,z[,yaw[,pitch]]]... [--gl native|egl|osmesa]" << std::endl;
+        return 1;
+    }
+
+    std::vector<RenderJob> jobs;
+    if (BatchRender::IsDirectory(inputs[0])) {
+        for (const std::string& scenePath : BatchRender::ListSceneFiles(inputs[0]))
+            jobs.push_back(RenderJob{ scenePath, poses });
+    }
+    else {
+        std::string error;
+        if (!BatchRender::ReadManifest(inputs[0], poses, jobs, error)) {
+            std::cerr << "Bad manifest: " << error << std::endl;
+            return 1;
+        }
+    }
+    if (jobs.empty()) {
+        std::cerr << "No scenes in " << inputs[0] << std::endl;
+        return 1;
+    }
+    if (!CheckImageNames(jobs))
+        return 1;
+    jobCount = std::min(jobCount, static_cast<int>(jobs.size()));
+    if (jobCount == 1)
+        return RenderJobs(jobs, options, csvPath, worker);
+
+    BatchRender::MakeDirectory(options.outputDirectory);
+    std::cout << jobs.size() << " scenes on " << jobCount << " workers" << std::endl;
+    double start = FramePacer::Now();
+    std::vector<std::string> shardCsvs;
+    std::vector<std::string> shardManifests;
+    std::vector<int> exitCodes(jobCount, 0);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < jobCount; w++) {
+        std::string shardBase = options.outputDirectory + "/batch_worker" + std::to_string(w);
+        shardManifests.push_back(shardBase + ".txt");
+        shardCsvs.push_back(shardBase + ".csv");
+        BatchRender::WriteManifest(shardManifests.back(), BatchRender::Shard(jobs, w, jobCount));
+        std::string command = BatchRender::ShellQuote(argv[0]) + " --batch " + BatchRender::ShellQuote(shardManifests.back()) +
+            " --jobs 1 --worker " + std::to_string(w) + " --csv " + BatchRender::ShellQuote(shardCsvs.back()) +
+            " --out " + BatchRender::ShellQuote(options.outputDirectory) + " --size " + std::to_string(options.width) + "x" + std::to_string(options.height) +
+            " --gl " + GLBackendName(options.backend) + " > " + BatchRender::ShellQuote(shardBase + ".log") + " 2>&1";
+        workers.emplace_back([command, w, &exitCodes]() { exitCodes[w] = BatchRender::RunCommand(command); });
+    }
+    for (std::thread& thread : workers)
+        thread.join();
+    double total = FramePacer::Now() - start;
+
+    std::ofstream csv(csvPath);
+    csv << BatchRender::CsvHeader << "\n";
+    size_t rows = 0;
+    for (int w = 0; w < jobCount; w++) {
+        rows += BatchRender::AppendCsvRows(shardCsvs[w], csv);
+        std::remove(shardCsvs[w].c_str());
+        std::remove(shardManifests[w].c_str());
+        if (exitCodes[w] != 0)
+            std::cerr << "Worker " << w << " exited with " << exitCodes[w] << ", see " << options.outputDirectory << "/batch_worker" << w << ".log" << std::endl;
+    }
+    std::cout << rows << " of " << jobs.size() << " scenes reported in " << total << " s (" << jobs.size() / total << " scenes/s), see " << csvPath << std::endl;
+    for (int code : exitCodes) {
+        if (code != 0)
+            return 1;
+    }
+    return rows == jobs.size() ? 0 : 1;
+}
+
+// Scripted camera flight through one scene for comparing builds and machines: every frame is sampled
+// at the same path time, so two runs draw exactly the same views. The CPU time is the submission of
+// the room and objects, the GPU time a GL_TIME_ELAPSED query around it and the frame time includes
+// waiting for the GPU to finish. The room and camera path are loaded before the timed frames.
+struct FlythroughFrame {
+    double cpuMs = 0.0;
+    double gpuMs = 0.0;
+    double frameMs = 0.0;
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+};
+
+nlohmann::json PercentileJson(const std::vector<double>& values) {
+    FrameTimeStats stats(values.size());
+    double sum = 0.0;
+    for (double value : values) {
+        stats.add(value);
+        sum += value;
+    }
+    return {
+        { "mean", values.empty() ? 0.0 : sum / values.size() },
+        { "p50", stats.percentile(0.50) },
+        { "p95", stats.percentile(0.95) },
+        { "p99", stats.percentile(0.99) },
+        { "max", stats.max() },
+    };
+}
+
+// a square grid of furniture around the origin, for a flythrough without a saved scene
+void GenerateFurnitureGrid(int count) {
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position((i % side - side / 2) * 1.5f, 0.0f, (i / side - side / 2) * 1.5f);
+        GenerateFurniture(furnitureCatalog[i % furnitureCount], position, glm::radians(37.0f * i));
+    }
+}
+
+// --bench-flythrough [scene.bin] [--objects N] [--path camera.json] [--frames N] [--json out.json]
+// [--size WxH] [--gl native|egl|osmesa]
+int RunFlythrough(int argc, char** argv) {
+    RenderOptions options;
+    std::vector<CameraPose> poses;
+    std::vector<std::string> arguments;
+    int jobCount = 1, worker = 0;
+    std::string csvPath;
+    if (!ParseRenderOptions(argc, argv, options, poses, arguments, jobCount, csvPath, worker))
+        return 1;
+    std::string scenePath, pathFile, jsonPath;
+    int frames = 600, warmup = 30, objects = 64;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        bool hasValue = i + 1 < arguments.size();
+        if (arguments[i] == "--path" && hasValue)
+            pathFile = arguments[++i];
+        else if (arguments[i] == "--frames" && hasValue)
+            frames = std::max(1, std::atoi(arguments[++i].c_str()));
+        else if (arguments[i] == "--json" && hasValue)
+            jsonPath = arguments[++i];
+        else if (arguments[i] == "--objects" && hasValue)
+            objects = std::max(0, std::atoi(arguments[++i].c_str()));
+        else if (scenePath.empty() && arguments[i].compare(0, 2, "--") != 0)
+            scenePath = arguments[i];
+        else {
+            std::cerr << "Usage: --bench-flythrough [scene.bin] [--objects N] [--path camera.json] [--frames N] [--json out.json] [--size WxH] [--gl native|egl|osmesa]" << std::endl;
+            return 1;
+        }
+    }
+    CameraPath path = CameraPath::Orbit(glm::vec3(0.0f, 0.5f, 0.0f), 6.0f, 2.0f, 20.0);
+    std::string error;
+    if (!pathFile.empty() && !CameraPath::Load(pathFile, path, error)) {
+        std::cerr << "Bad camera path " << pathFile << ": " << error << std::endl;
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+    GLFWwindow* context = CreateRenderContext(options.backend);
+    if (!context) {
+        std::cerr << "Failed to create a GL context" << std::endl;
+        return 1;
+    }
+    std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    stbi_set_flip_vertically_on_load(true);
+    glEnable(GL_DEPTH_TEST);
+
+    int result = 0;
+    {
+        Shader shader("default.vert", "default.frag");
+        OffscreenTarget target;
+        bool ready = target.create(options.width, options.height);
+        if (!ready) {
+            std::cerr << "Offscreen framebuffer " << options.width << "x" << options.height << " is not complete" << std::endl;
+        }
+        else if (!scenePath.empty()) {
+            ready = loadGameState(scenePath, scene, shader, selectedRoomModel);
+        }
+        else {
+            selectedRoomModel = roomModelNames[0];
+            GenerateFurnitureGrid(objects);
+            initializeScene(shader, "texture_diffuse2.jpg", selectedRoomModel);
+        }
+
+        std::vector<FlythroughFrame> samples;
+        std::vector<GLQuery> queries;
+        for (int i = 0; i < frames; i++)
+            queries.push_back(GLQuery::Create("Flythrough"));
+        camera.width = target.width;
+        camera.height = target.height;
+        // the warmup frames fly the start of the path, they fill the driver caches and aren't timed
+        for (int i = -warmup; i < frames && ready; i++) {
+            double time = path.duration() * std::max(i, 0) / frames;
+            double frameStart = FramePacer::Now();
+            path.sample(time).apply(camera);
+            camera.updateMatrix(camera.zoom, 0.1f, 100.0f);
+            target.bind();
+            if (i >= 0)
+                glBeginQuery(GL_TIME_ELAPSED, queries[i].get());
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            DrawRoom(shader);
+            RenderModels(shader, scene);
+            if (i >= 0)
+                glEndQuery(GL_TIME_ELAPSED);
+            double submitted = FramePacer::Now();
+            glFinish();
+            if (i < 0)
+                continue;
+            FlythroughFrame frame;
+            frame.cpuMs = (submitted - frameStart) * 1e3;
+            frame.frameMs = (FramePacer::Now() - frameStart) * 1e3;
+            frame.drawCalls = objectDrawCalls + meshletStats.drawCalls;
+            frame.triangles = objectTriangles + meshletStats.trianglesDrawn;
+            samples.push_back(frame);
+        }
+        // after glFinish every result is available
+        for (size_t i = 0; i < samples.size(); i++) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(queries[i].get(), GL_QUERY_RESULT, &nanoseconds);
+            samples[i].gpuMs = nanoseconds * 1e-6;
+        }
+
+        if (!ready || samples.empty()) {
+            std::cerr << "Flythrough failed" << std::endl;
+            result = 1;
+        }
+        else {
+            std::vector<double> cpu, gpu, frameTimes, drawCalls, triangles;
+            for (const FlythroughFrame& frame : samples) {
+                cpu.push_back(frame.cpuMs);
+                gpu.push_back(frame.gpuMs);
+                frameTimes.push_back(frame.frameMs);
+                drawCalls.push_back(static_cast<double>(frame.drawCalls));
+                triangles.push_back(static_cast<double>(frame.triangles));
+            }
+            nlohmann::json report = {
+                { "scene", scenePath.empty() ? "generated " + std::to_string(objects) + " objects" : scenePath },
+                { "path", pathFile.empty() ? "orbit" : pathFile },
+                { "renderer", renderer },
+                { "width", target.width },
+                { "height", target.height },
+                { "frames", samples.size() },
+                { "objects", scene.size() },
+                { "cpu_ms", PercentileJson(cpu) },
+                { "gpu_ms", PercentileJson(gpu) },
+                { "frame_ms", PercentileJson(frameTimes) },
+                { "draw_calls", PercentileJson(drawCalls) },
+                { "triangles", PercentileJson(triangles) },
+            };
+            std::cout << report.dump(2) << std::endl;
+            if (!jsonPath.empty()) {
+                std::ofstream out(jsonPath);
+                out << report.dump(2) << "\n";
+                if (!out) {
+                    std::cerr << "Failed to write " << jsonPath << std::endl;
+                    result = 1;
+                }
+            }
+        }
+
+        queries.clear();
+        scene.clear();
+        room = Model();
+        loadedRoomModel.clear();
+        target.reset();
+    }
+    GpuResourceRegistry::Get().reportLeaks(std::cout);
+    glfwDestroyWindow(context);
+    glfwTerminate();
+    return result;
+}
+
+// --generate-scene out.bin [--objects N] [--unique R] [--layout grid|uniform|clustered] [--extent M]
+// [--rotation DEG] [--scale-jitter F] [--seed S] [--room room.fbx] [--scenes K]
+// With more than one scene they go to out_0.bin ... out_K-1.bin, each with the next seed.
+int RunGenerateScene(int argc, char** argv) {
+    StressScene::Options options;
+    std::string outputPath;
+    int scenes = 1;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--objects" && hasValue)
+            options.objects = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--unique" && hasValue)
+            options.uniqueRatio = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--layout" && hasValue) {
+            if (!StressScene::ParseLayout(argv[++i], options.layout)) {
+                std::cerr << "Unknown layout " << argv[i] << ", expected grid, uniform or clustered" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--extent" && hasValue)
+            options.extent = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--rotation" && hasValue)
+            options.rotationJitter = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--scale-jitter" && hasValue)
+            options.scaleJitter = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--seed" && hasValue)
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--room" && hasValue) {
+            options.room = argv[++i];
+            if (std::find(roomModelNames.begin(), roomModelNames.end(), options.room) == roomModelNames.end()) {
+                std::cerr << "Unknown room " << options.room << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--scenes" && hasValue)
+            scenes = std::max(1, std::atoi(argv[++i]));
+        else if (outputPath.empty() && arg.compare(0, 2, "--") != 0)
+            outputPath = arg;
+        else {
+            std::cerr << "Unexpected argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (outputPath.empty()) {
+        std::cerr << "Usage: --generate-scene out.bin [--objects N] [--unique R] [--layout grid|uniform|clustered] [--extent M] "
+            "[--rotation DEG] [--scale-jitter F] [--seed S] [--room room.fbx] [--scenes K]" << std::endl;
+        return 1;
+    }
+
+    std::vector<StressScene::Asset> catalog = StressAssets();
+    std::string stem = outputPath.substr(0, outputPath.size() - (outputPath.size() > 4 && outputPath.compare(outputPath.size() - 4, 4, ".bin") == 0 ? 4 : 0));
+    for (int k = 0; k < scenes; k++) {
+        StressScene::Options sceneOptions = options;
+        sceneOptions.seed = options.seed + k;
+        std::string path = scenes == 1 ? outputPath : stem + "_" + std::to_string(k) + ".bin";
+        std::vector<ModelSnapshot> objects = StressScene::Generate(sceneOptions, catalog);
+        if (!StressScene::Write(path, sceneOptions.room, objects)) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return 1;
+        }
+        std::cout << path << ": " << objects.size() << " objects, " << StressScene::UniqueAssets(sceneOptions, catalog)
+            << " distinct assets, " << StressScene::LayoutName(sceneOptions.layout) << " in +-" << sceneOptions.extent << ", seed " << sceneOptions.seed << std::endl;
+    }
+    return 0;
+}
+
+// --audit [dir|file...] [--budgets budgets.json] [--max-triangles N] [--max-texture PX] [--max-gpu-mb MB]
+// [--max-acmr R] [--max-duplication R] [--no-npot] [--no-unused-channels] [--json report.json].
+// Exits with 1 when an asset is over a budget or can't be read.
+int RunAudit(int argc, char** argv) {
+    AssetAudit::Budgets budgets;
+    std::vector<std::string> paths;
+    std::string jsonPath;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--budgets" && hasValue) {
+            std::string error;
+            if (!AssetAudit::LoadBudgets(argv[++i], budgets, error)) {
+                std::cerr << "Failed to read budgets: " << error << std::endl;
+                return 2;
+            }
+        }
+        else if (arg == "--max-triangles" && hasValue)
+            budgets.maxTriangles = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--max-texture" && hasValue)
+            budgets.maxTextureSize = std::atoi(argv[++i]);
+        else if (arg == "--max-gpu-mb" && hasValue)
+            budgets.maxGpuMB = std::atof(argv[++i]);
+        else if (arg == "--max-acmr" && hasValue)
+            budgets.maxAcmr = std::atof(argv[++i]);
+        else if (arg == "--max-duplication" && hasValue)
+            budgets.maxDuplication = std::atof(argv[++i]);
+        else if (arg == "--no-npot")
+            budgets.allowNonPowerOfTwo = false;
+        else if (arg == "--no-unused-channels")
+            budgets.allowUnusedChannels = false;
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg.compare(0, 2, "--") != 0)
+            paths.push_back(arg);
+        else {
+            std::cerr << "Unexpected argument " << arg << std::endl;
+            return 2;
+        }
+    }
+    if (paths.empty())
+        paths.push_back("resources/objects");
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        std::vector<std::string> listed = BatchRender::IsDirectory(path) ? AssetAudit::ListAssets(path) : std::vector<std::string>{ path };
+        files.insert(files.end(), listed.begin(), listed.end());
+    }
+
+    double start = TraceRecorder::Now();
+    std::vector<AssetAudit::Report> reports = AssetAudit::Run(files, budgets);
+    double elapsedMs = (TraceRecorder::Now() - start) * 1e-3;
+    AssetAudit::Print(std::cout, reports);
+
+    size_t failed = 0, warned = 0;
+    for (const AssetAudit::Report& report : reports) {
+        failed += report.failed();
+        warned += !report.failed() && !report.warnings.empty();
+    }
+    std::cout << reports.size() << " assets, " << failed << " failed, " << warned << " with warnings, "
+        << elapsedMs << " ms on " << ThreadPool::Shared().size() + 1 << " threads" << std::endl;
+    if (!jsonPath.empty() && !AssetAudit::WriteJson(jsonPath, reports, budgets)) {
+        std::cerr << "Failed to write " << jsonPath << std::endl;
+        return 2;
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+// --compress-textures [dir|file...] [--format auto|bc1|bc3|bc7] [--etc2] [--json report.json]
+// Writes the mip chain of every image block compressed into cache/, where texture loads pick it up
+// while the image is unchanged. auto is BC1 for opaque and BC3 for images with alpha, --etc2 also
+// writes an ETC2 copy for contexts without BC.
+int RunCompressTextures(int argc, char** argv) {
+    std::vector<std::string> paths;
+    std::string format = "auto";
+    std::string jsonPath;
+    bool etc2 = false;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--format" && hasValue) {
+            format = argv[++i];
+            if (format != "auto" && format != "bc1" && format != "bc3" && format != "bc7") {
+                std::cerr << "Unknown format " << format << ", expected auto, bc1, bc3 or bc7" << std::endl;
+                return 2;
+            }
+        }
+        else if (arg == "--etc2")
+            etc2 = true;
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg.compare(0, 2, "--") != 0)
+            paths.push_back(arg);
+        else {
+            std::cerr << "Unexpected argument " << arg << std::endl;
+            return 2;
+        }
+    }
+    if (paths.empty())
+        paths.push_back("resources/objects");
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        std::vector<std::string> listed = BatchRender::IsDirectory(path) ? AssetAudit::ListAssets(path) : std::vector<std::string>{ path };
+        for (const std::string& file : listed)
+            if (AssetAudit::IsImage(file))
+                files.push_back(AssetCache::NormalPath(file));  // as the application names it
+    }
+
+    // the same rows the application uploads
+    stbi_set_flip_vertically_on_load(true);
+    nlohmann::json report = nlohmann::json::array();
+    size_t rawTotal = 0, compressedTotal = 0;
+    int failed = 0;
+    char line[256];
+    for (const std::string& file : files) {
+        int width, height, components;
+        unsigned char* pixels = stbi_load(file.c_str(), &width, &height, &components, 0);
+        if (!pixels) {
+            std::cerr << file << ": " << stbi_failure_reason() << std::endl;
+            failed++;
+            continue;
+        }
+        TextureCompression::RgbaImage image = TextureCompression::ToRgba(pixels, width, height, components);
+        stbi_image_free(pixels);
+        bool alpha = TextureCompression::HasAlpha(image);
+        size_t rawBytes = static_cast<size_t>(width) * height * components * 4 / 3;
+
+        std::vector<std::pair<TextureCompression::Family, TextureCompression::Format>> outputs;
+        if (format == "auto")
+            outputs.push_back({ TextureCompression::Family::BC, TextureCompression::PickFormat(TextureCompression::Family::BC, alpha, false) });
+        else
+            outputs.push_back({ TextureCompression::Family::BC, format == "bc1" ? TextureCompression::Format::BC1 : format == "bc3" ? TextureCompression::Format::BC3 : TextureCompression::Format::BC7 });
+        if (etc2)
+            outputs.push_back({ TextureCompression::Family::ETC2, TextureCompression::PickFormat(TextureCompression::Family::ETC2, alpha, false) });
+
+        for (const auto& output : outputs) {
+            const TextureCompression::FormatInfo& info = TextureCompression::Info(output.second);
+            double start = TraceRecorder::Now();
+            TextureCompression::CompressedTexture compressed = TextureCompression::Compress(image, output.second);
+            double encodeMs = (TraceRecorder::Now() - start) * 1e-3;
+            TextureCompression::RgbaImage decoded = TextureCompression::DecodeLevel(compressed.levels[0], width, height, output.second);
+            double psnr = TextureCompression::Psnr(image, decoded, info.alpha && alpha);
+            if (!TextureCompression::Save(file, compressed, output.first)) {
+                std::cerr << "Failed to write " << TextureCompression::CachePath(file, output.first) << std::endl;
+                failed++;
+                continue;
+            }
+            rawTotal += rawBytes;
+            compressedTotal += compressed.bytes();
+            snprintf(line, sizeof(line), "%-5s %5dx%-5d %5.1f dB  %8.2f -> %7.2f MB  %8.1f ms  ", info.name, width, height, psnr,
+                rawBytes / (1024.0 * 1024.0), compressed.bytes() / (1024.0 * 1024.0), encodeMs);
+            std::cout << line << file << std::endl;
+            report.push_back({
+                { "path", file }, { "cache", TextureCompression::CachePath(file, output.first) }, { "format", info.name },
+                { "width", width }, { "height", height }, { "components", components }, { "alpha", alpha },
+                { "levels", compressed.levels.size() }, { "psnr_db", psnr }, { "raw_bytes", rawBytes },
+                { "compressed_bytes", compressed.bytes() }, { "encode_ms", encodeMs },
+            });
+        }
+    }
+    std::cout << report.size() << " textures written, " << failed << " failed, VRAM " << rawTotal / (1024.0 * 1024.0) << " -> "
+        << compressedTotal / (1024.0 * 1024.0) << " MB, encoded on " << ThreadPool::Shared().size() + 1 << " threads" << std::endl;
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        out << report.dump(2) << std::endl;
+        if (!out) {
+            std::cerr << "Failed to write " << jsonPath << std::endl;
+            return 2;
+        }
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv)
 {
+    // command line benchmarks don't need a window
+    if (argc > 1 && std::string(argv[1]) == "--bench-import") {
+        std::string path = argc > 2 ? argv[2] : "resources/objects/desk.fbx";
+        int iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 200;
+        return Benchmark::RunImport(path, iterations);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-meshlets") {
+        // both room presets unless a file is given
+        if (argc > 2)
+            return Benchmark::RunMeshlets(argv[2]);
+        int result = 0;
+        for (const std::string& roomModel : roomModelNames)
+            result |= Benchmark::RunMeshlets("resources/objects/" + roomModel);
+        return result;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-bvh") {
+        return Benchmark::RunBVH();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-pick") {
+        std::string path = argc > 2 ? argv[2] : "resources/objects/couch1.fbx";
+        size_t instances = argc > 3 ? std::max(1, std::atoi(argv[3])) : 10000;
+        return Benchmark::RunPick(path, instances);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-transforms") {
+        return Benchmark::RunTransforms();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-scene") {
+        return Benchmark::RunSceneStore();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-names") {
+        return Benchmark::RunNames();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-outliner") {
+        return Benchmark::RunOutliner();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-pacing") {
+        return Benchmark::RunPacing();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-micro") {
+        return MicroBench::Run(argc, argv, 2);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--audit") {
+        return RunAudit(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--compress-textures") {
+        return RunCompressTextures(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--generate-scene") {
+        return RunGenerateScene(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-flythrough") {
+        return RunFlythrough(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--render") {
+        return RunHeadless(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        return RunBatch(argc, argv);
+    }
+
+    // render every frame instead of on demand, for measurements
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--continuous")
+            frameScheduler.continuous = true;
+        if (std::string(argv[i]) == "--trace")
+            traceExitPath = i + 1 < argc ? argv[++i] : TraceFileName();
+        if (std::string(argv[i]) == "--no-streaming")
+            textureStreaming = false;
+        if (std::string(argv[i]) == "--upload-budget" && i + 1 < argc)
+            TextureStreamer::Get().uploadBudgetMB = std::max(0.0, std::atof(argv[++i]));
+    }
+    TRACE_THREAD_NAME("Main");
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -630,6 +2135,12 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // textures compressed by --compress-textures are only used in formats this context has
+    TextureCompression::DetectSupport();
+    if (textureStreaming) {
+        TextureStreamer::Get().init((GLADloadproc)glfwGetProcAddress);
+        TextureStreamer::Get().onReady = []() { frameScheduler.invalidate(); };
+    }
 
     // flip on y-axis
     stbi_set_flip_vertically_on_load(true);
@@ -640,70 +2151,97 @@ int main()
     Shader ourShader("default.vert", "default.frag");
 
     IMGUI_CHECKVERSION();
+#if MEMORY_TRACKING_ENABLED
+    // ImGui allocates with malloc unless told otherwise
+    ImGui::SetAllocatorFunctions(
+        [](size_t size, void*) { MemoryScope scope(MemoryTag::UI); return MemoryTracker::Allocate(size); },
+        [](void* memory, void*) { MemoryTracker::Free(memory); });
+#endif
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     ImGui::StyleColorsDark();
+    // before the ImGui backend, which chains the callbacks installed here
+    frameScheduler.attach(window);
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
-    const double targetFrameTime = 1.0 / 60.0; // 60 fps
-    double lastFrameTime = glfwGetTime();
-    double lastFPSUpdateTime = lastFrameTime; // Initialize lastFPSUpdateTime
-    int frameCount = 0;
-
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();  // Process GLFW events
-
-        // Calculate elapsed time since the last frame
-        double currentFrameTime = glfwGetTime();
-        double deltaTime = currentFrameTime - lastFrameTime;
-
-        if (deltaTime >= targetFrameTime)
-        {
-            // Update last frame time
-            lastFrameTime = currentFrameTime;
-
-            frameCount++;
-
-            ImGui_ImplOpenGL3_NewFrame();
-            ImGui_ImplGlfw_NewFrame();
-            ImGui::NewFrame();
-
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            if (showMainMenu) {
-                MainMenu();
-            }
+        // sleeps until input arrives or a redraw was requested
+        frameScheduler.waitForFrame();
+        if (glfwWindowShouldClose(window))
+            break;
+        PROFILE_BEGIN_FRAME();
+        // levels over this frame's budget and ring space held by the GPU need the next frames
+        if (TextureStreamer::Get().pump())
+            frameScheduler.invalidate(1);
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        if (showMainMenu) {
+            MainMenu();
+        }
 
-            if (showSecondaryWindow) {
-                SecondaryWindow();
-            }
+        if (showSecondaryWindow) {
+            SecondaryWindow();
+        }
 
-            if (showChooseWindow) {
-                ChooseWindow();
-            }
+        if (showChooseWindow) {
+            ChooseWindow();
+        }
 
-            if (showModelWindow) {
-                initializeScene(ourShader, "texture_diffuse2.jpg", selectedRoomModel);
-                RenderModelWindow(window, ourShader, models,selectedId);
-            }
+        if (showModelWindow) {
+            initializeScene(ourShader, "texture_diffuse2.jpg", selectedRoomModel);
+            RenderModelWindow(window, ourShader, scene, selected);
+        }
 
+        {
+            PROFILE_SCOPE("ImGui");
+            PROFILE_GPU_SCOPE("ImGui");
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
+        {
+            PROFILE_SCOPE("Swap");
             glfwSwapBuffers(window);
         }
-        // Calculate FPS every second
-        if (currentFrameTime - lastFPSUpdateTime >= 1.0)
-        {
-            double fps = frameCount / (currentFrameTime - lastFPSUpdateTime);
-            std::cout << "FPS: " << fps << std::endl;
+        PROFILE_END_FRAME();
+        frameScheduler.frameDrawn();
 
-            // Reset frame count and update last FPS update time
-            frameCount = 0;
-            lastFPSUpdateTime = currentFrameTime;
+#if PROFILER_ENABLED
+        bool traceKeyPressed = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+        if (traceKeyPressed && !traceKeyWasPressed) {
+            SaveTrace(TraceFileName());
         }
+        traceKeyWasPressed = traceKeyPressed;
+#endif
+    }
+#if PROFILER_ENABLED
+    if (!traceExitPath.empty()) {
+        SaveTrace(traceExitPath);
+    }
+#endif
+
+    // release everything that holds GL objects while the context is still alive,
+    // whatever the registry still knows about afterwards has leaked
+    TextureStreamer::Get().shutdown();
+    scene.clear();
+    room = Model();
+    ::ourShader = Shader();
+    ourShader = Shader();
+    texture1.reset();
+    texture2.reset();
+    Profiler::Get().releaseGpu();
+    GpuResourceRegistry::Get().reportLeaks(std::cout);
+    const FrameTimeStats& frames = frameScheduler.frameTimes;
+    if (frames.count() > 0) {
+        std::cout << "Frame intervals (" << frames.count() << " frames): p50 " << frames.percentile(0.5) * 1e3 << " ms, p99 "
+            << frames.percentile(0.99) * 1e3 << " ms, max " << frames.max() * 1e3 << " ms" << std::endl;
     }
 
     // delete all resources
@@ -1,2 +1,2 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include"stb\stb_image.h"
\ No newline at end of file
+#include"stb/stb_image.h"
\ No newline at end of file
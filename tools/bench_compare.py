@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Compares two --bench-micro JSON reports, benchmark by benchmark.
+
+    python3 tools/bench_compare.py baseline.json current.json [--threshold 10]
+
+Times are the medians of the repetitions. A benchmark counts as slower or faster when its time
+changed by more than the threshold (percent) and the ranges of the two runs (min to max) don't
+overlap, so a noisy benchmark isn't flagged on its median alone. The exit code is 1 when anything
+got slower, which lets a CI job fail on regressions, and 2 for bad input.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    try:
+        with open(path) as f:
+            report = json.load(f)
+        return {b["name"]: b for b in report["benchmarks"]}, report.get("context", {})
+    except (OSError, ValueError, KeyError) as e:
+        print("can't read %s: %s" % (path, e), file=sys.stderr)
+        sys.exit(2)
+
+
+def format_ns(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.2f %s" % (ns / scale, unit)
+    return "%.1f ns" % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0, help="percent change that counts (default 10)")
+    args = parser.parse_args()
+
+    baseline, baseline_context = load(args.baseline)
+    current, current_context = load(args.current)
+
+    for key in ("build_type", "num_cpus"):
+        if key in baseline_context and baseline_context.get(key) != current_context.get(key):
+            print("note: %s differs, %s vs %s" % (key, baseline_context[key], current_context.get(key)))
+
+    slower = faster = 0
+    width = max([len(name) for name in baseline] + [len(name) for name in current] + [9])
+    print("%-*s %12s %12s %9s" % (width, "benchmark", "baseline", "current", "change"))
+    for name in list(baseline) + [n for n in current if n not in baseline]:
+        old, new = baseline.get(name), current.get(name)
+        if old is None or new is None:
+            print("%-*s %12s %12s %9s" % (width, name, format_ns(old["real_time"]) if old else "-",
+                                          format_ns(new["real_time"]) if new else "-", "only one"))
+            continue
+        change = (new["real_time"] - old["real_time"]) / old["real_time"] * 100.0
+        overlap = new.get("min_time", new["real_time"]) <= old.get("max_time", old["real_time"]) and \
+            old.get("min_time", old["real_time"]) <= new.get("max_time", new["real_time"])
+        verdict = ""
+        if abs(change) > args.threshold and not overlap:
+            verdict = "  SLOWER" if change > 0 else "  faster"
+            slower += change > 0
+            faster += change < 0
+        print("%-*s %12s %12s %+8.1f%%%s" % (width, name, format_ns(old["real_time"]), format_ns(new["real_time"]), change, verdict))
+
+    print("%d slower, %d faster beyond %g%%" % (slower, faster, args.threshold))
+    return 1 if slower else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,27 @@
+// The --bench-micro suite as a program of its own, for machines without the Windows build
+// (CI runners, Linux). It needs no window, display or GL context: glad.c only provides the entry
+// points, which stay unloaded because none of the benchmarks calls into GL. From the repo root:
+//
+//   g++ -O2 -std=c++14 -I Libraries/include -I . tools/microbench.cpp stb.cpp glad.c -ldl -pthread -o microbench
+//   ./microbench --json bench.json
+//   python3 tools/bench_compare.py baseline.json bench.json
+#include "MicroBench.h"
+
+// Model.h includes assimp's IOSystem.hpp, whose inline destructor makes every includer emit the
+// IOSystem vtable. Nothing here imports a model, so the two library functions it points to are
+// only needed to link without assimp.
+bool Assimp::IOSystem::ComparePaths(const char* one, const char* second) const
+{
+    return std::string(one) == second;
+}
+
+const std::string& Assimp::IOSystem::CurrentDirectory() const
+{
+    static const std::string none;
+    return none;
+}
+
+int main(int argc, char** argv)
+{
+    return MicroBench::Run(argc, argv, 1);
+}
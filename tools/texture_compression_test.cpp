@@ -0,0 +1,131 @@
+// Round trips of the block encoders in TextureCompression.h and of the KTX2 container. Needs no
+// window or GL context. From the repo root:
+//
+//   g++ -O2 -std=c++14 -I Libraries/include -I . tools/texture_compression_test.cpp glad.c -ldl -pthread -o texture_compression_test
+//   ./texture_compression_test
+//
+// Exits with 1 when a case fails.
+#include "TextureCompression.h"
+
+#include <cstdio>
+#include <functional>
+
+using namespace TextureCompression;
+
+namespace {
+
+    int failures = 0;
+
+    void Expect(bool condition, const char* name, const char* detail)
+    {
+        std::printf("%-4s %s%s%s\n", condition ? "ok" : "FAIL", name, detail[0] ? ": " : "", detail);
+        failures += !condition;
+    }
+
+    RgbaImage MakeImage(int width, int height, const std::function<void(int, int, unsigned char*)>& pixel)
+    {
+        RgbaImage image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                pixel(x, y, image.at(x, y));
+        return image;
+    }
+
+    double RoundTripPsnr(const RgbaImage& image, Format format, bool alpha)
+    {
+        std::vector<unsigned char> level = EncodeLevel(image, format);
+        return Psnr(image, DecodeLevel(level, image.width, image.height, format), alpha);
+    }
+
+    // Colors that differ only across the grey axis, where the principal axis has to be found
+    // from the covariance rather than from a fixed start
+    void CheckerboardAcrossGrey()
+    {
+        RgbaImage image = MakeImage(8, 8, [](int x, int y, unsigned char* texel) {
+            bool red = (x + y) % 2 == 0;
+            texel[0] = red ? 255 : 0;
+            texel[1] = red ? 0 : 255;
+            texel[2] = 0;
+            texel[3] = 255;
+        });
+        for (Format format : { Format::BC1, Format::BC3, Format::BC7 })
+        {
+            char detail[64];
+            double psnr = RoundTripPsnr(image, format, false);
+            std::snprintf(detail, sizeof(detail), "%.1f dB", psnr);
+            Expect(psnr > 40.0, (std::string("red/green checkerboard ") + Info(format).name).c_str(), detail);
+        }
+    }
+
+    void Gradients()
+    {
+        // odd size so the edge blocks repeat texels
+        RgbaImage image = MakeImage(37, 21, [](int x, int y, unsigned char* texel) {
+            texel[0] = static_cast<unsigned char>(x * 255 / 36);
+            texel[1] = static_cast<unsigned char>(y * 255 / 20);
+            texel[2] = static_cast<unsigned char>((x + y) * 255 / 56);
+            texel[3] = static_cast<unsigned char>(255 - y * 255 / 20);
+        });
+        for (int i = 0; i < static_cast<int>(Format::Count); i++)
+        {
+            Format format = static_cast<Format>(i);
+            char detail[64];
+            double psnr = RoundTripPsnr(image, format, Info(format).alpha);
+            std::snprintf(detail, sizeof(detail), "%.1f dB", psnr);
+            Expect(psnr > 30.0, (std::string("gradient ") + Info(format).name).c_str(), detail);
+        }
+    }
+
+    void FlatBlocks()
+    {
+        RgbaImage image = MakeImage(4, 4, [](int, int, unsigned char* texel) {
+            texel[0] = 200;
+            texel[1] = 100;
+            texel[2] = 50;
+            texel[3] = 128;
+        });
+        char detail[64];
+        double psnr = RoundTripPsnr(image, Format::BC7, true);
+        std::snprintf(detail, sizeof(detail), "%.1f dB", psnr);
+        Expect(psnr > 45.0, "flat block bc7", detail);
+        psnr = RoundTripPsnr(image, Format::ETC2RGBA, true);
+        std::snprintf(detail, sizeof(detail), "%.1f dB", psnr);
+        Expect(psnr > 35.0, "flat block etc2a", detail);
+    }
+
+    void Container()
+    {
+        RgbaImage image = MakeImage(20, 12, [](int x, int y, unsigned char* texel) {
+            texel[0] = static_cast<unsigned char>(x * 12);
+            texel[1] = static_cast<unsigned char>(y * 20);
+            texel[2] = 77;
+            texel[3] = 255;
+        });
+        CompressedTexture texture = Compress(image, Format::BC1);
+        Ktx2::Image written;
+        written.vkFormat = Info(Format::BC1).vkFormat;
+        written.width = 20;
+        written.height = 12;
+        written.dfd = Descriptor(Format::BC1);
+        written.keyValues = { { "KTXorientation", "ru" }, { SourceKey, "1 2" } };
+        written.levels = texture.levels;
+        Ktx2::Image read;
+        bool parsed = Ktx2::Parse(Ktx2::Serialize(written, Info(Format::BC1).blockBytes), read);
+        Expect(parsed && read.vkFormat == written.vkFormat && read.width == 20 && read.height == 12, "ktx2 header", "");
+        Expect(parsed && read.levels == written.levels && texture.levels.size() == 5, "ktx2 levels", "");
+        Expect(parsed && read.dfd == written.dfd && read.value(SourceKey) == "1 2", "ktx2 descriptor and key/values", "");
+    }
+}
+
+int main()
+{
+    CheckerboardAcrossGrey();
+    Gradients();
+    FlatBlocks();
+    Container();
+    std::printf("%d failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}